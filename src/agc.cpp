@@ -0,0 +1,175 @@
+#include <agc.h>
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+
+#define AGC_TARGET_DBFS         -20.0   // RMS level the loop settles at
+#define AGC_PEAK_LIMIT_DBFS     -3.0    // Gain comes down right away above this peak
+#define AGC_HYSTERESIS_DB       3.0     // RMS error tolerated before changing anything
+#define AGC_MAX_STEP_DB         6       // Largest increase per change, decreases are not limited
+#define AGC_MIN_INTERVAL_MS     100     // Rate limit on gain writes
+#define AGC_SETTLE_WINDOWS      1       // Windows thrown away after a change
+#define AGC_POLL_MS             10      // How often the worker looks for a finished window
+
+// Stage ranges of the bladeRF x40/x115 RX chain, as offered by the manual sliders
+#define AGC_LNA_STEP            3
+#define AGC_LNA_MAX             6
+#define AGC_VGA1_MIN            5
+#define AGC_VGA1_MAX            30
+#define AGC_VGA2_MAX            30
+
+// Full scale of a 12 bit component
+#define AGC_FULL_SCALE          2048.0
+
+static uint64_t agcNowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+Agc::~Agc() {
+    stop();
+}
+
+void Agc::start(BladeRFDevice* dev, bladerf_channel ch, const Gains& initial, uint64_t windowSamples) {
+    if (running) { return; }
+    this->dev = dev;
+    channel = ch;
+    current = initial;
+    lna = current.lna;
+    rxvga1 = current.rxvga1;
+    rxvga2 = current.rxvga2;
+    rms = -100.0f;
+    peak = -100.0f;
+    changeCount = 0;
+    lastChange = 0;
+    window = std::max<uint64_t>(windowSamples, 1);
+    acc = convert::IqStats();
+    ready = false;
+    skip = AGC_SETTLE_WINDOWS;
+    running = true;
+    workerThread = std::thread(worker, this);
+}
+
+void Agc::stop() {
+    {
+        std::lock_guard<std::mutex> lck(mtx);
+        if (!running) { return; }
+        running = false;
+    }
+    cnd.notify_all();
+    workerThread.join();
+    dev = NULL;
+}
+
+// Never blocks, a window completed while the previous one is still unclaimed is dropped
+void Agc::feed(const convert::IqStats& stats) {
+    acc.add(stats);
+    if (acc.count < window) { return; }
+    if (!ready.load(std::memory_order_acquire)) {
+        pending = acc;
+        ready.store(true, std::memory_order_release);
+    }
+    acc = convert::IqStats();
+}
+
+Agc::Gains Agc::gains() {
+    Gains g;
+    g.lna = lna;
+    g.rxvga1 = rxvga1;
+    g.rxvga2 = rxvga2;
+    return g;
+}
+
+// The LNA gets gain first and gives it up last, then rxVGA1, then rxVGA2
+Agc::Gains Agc::distribute(int total) {
+    Gains g;
+    total = std::clamp<int>(total, AGC_VGA1_MIN, AGC_LNA_MAX + AGC_VGA1_MAX + AGC_VGA2_MAX);
+    g.lna = std::clamp<int>(((total - AGC_VGA1_MIN) / AGC_LNA_STEP) * AGC_LNA_STEP, 0, AGC_LNA_MAX);
+    g.rxvga1 = std::clamp<int>(total - g.lna, AGC_VGA1_MIN, AGC_VGA1_MAX);
+    g.rxvga2 = std::clamp<int>(total - g.lna - g.rxvga1, 0, AGC_VGA2_MAX);
+    return g;
+}
+
+void Agc::worker(Agc* _this) {
+    std::unique_lock<std::mutex> lck(_this->mtx);
+    while (_this->running) {
+        _this->cnd.wait_for(lck, std::chrono::milliseconds(AGC_POLL_MS), [&]{ return !_this->running; });
+        if (!_this->running) { break; }
+        if (!_this->ready.load(std::memory_order_acquire)) { continue; }
+        convert::IqStats stats = _this->pending;
+        _this->ready.store(false, std::memory_order_release);
+
+        // Gain writes can take a while, stop() must not wait on the lock for them
+        lck.unlock();
+        _this->step(stats);
+        lck.lock();
+    }
+}
+
+void Agc::step(const convert::IqStats& stats) {
+    if (stats.count == 0) { return; }
+    if (skip > 0) {
+        skip--;
+        return;
+    }
+
+    // DC is left out, it's not signal and the IQ correction takes it away anyway
+    double n = (double)stats.count;
+    double mI = stats.sumI / n;
+    double mQ = stats.sumQ / n;
+    double power = ((stats.sumII / n) - (mI * mI)) + ((stats.sumQQ / n) - (mQ * mQ));
+    double rmsDb = 10.0 * log10(std::max<double>(power, 1e-3) / (AGC_FULL_SCALE * AGC_FULL_SCALE));
+    double peakDb = 20.0 * log10(std::max<double>(stats.peak, 0.5) / AGC_FULL_SCALE);
+    rms = rmsDb;
+    peak = peakDb;
+
+    double delta;
+    if (peakDb > AGC_PEAK_LIMIT_DBFS) {
+        // Fast attack, clipping costs more than a moment of low gain
+        delta = std::min<double>(AGC_TARGET_DBFS - rmsDb, AGC_PEAK_LIMIT_DBFS - peakDb - AGC_HYSTERESIS_DB);
+    }
+    else {
+        delta = AGC_TARGET_DBFS - rmsDb;
+        if (fabs(delta) < AGC_HYSTERESIS_DB) { return; }
+        // Strong peaks on a weak average (bursts) must not be pushed into clipping
+        delta = std::min<double>(delta, AGC_PEAK_LIMIT_DBFS - peakDb);
+        delta = std::min<double>(delta, AGC_MAX_STEP_DB);
+    }
+
+    int next = total(current) + (int)lround(delta);
+    Gains g = distribute(next);
+    if (total(g) == total(current)) { return; }
+
+    uint64_t now = agcNowMs();
+    if (now - lastChange < AGC_MIN_INTERVAL_MS) { return; }
+    if (!apply(g)) { return; }
+    lastChange = now;
+    changeCount++;
+    // What is in flight was taken with the old gain
+    skip = AGC_SETTLE_WINDOWS;
+}
+
+bool Agc::apply(const Gains& next) {
+    if (dev == NULL) { return false; }
+    int status = 0;
+    if (next.lna != current.lna) {
+        status = dev->setGainStage(channel, "lna", next.lna);
+        if (status == 0) { current.lna = next.lna; }
+    }
+    if (status == 0 && next.rxvga1 != current.rxvga1) {
+        status = dev->setGainStage(channel, "rxvga1", next.rxvga1);
+        if (status == 0) { current.rxvga1 = next.rxvga1; }
+    }
+    if (status == 0 && next.rxvga2 != current.rxvga2) {
+        status = dev->setGainStage(channel, "rxvga2", next.rxvga2);
+        if (status == 0) { current.rxvga2 = next.rxvga2; }
+    }
+    lna = current.lna;
+    rxvga1 = current.rxvga1;
+    rxvga2 = current.rxvga2;
+    if (status != 0) {
+        spdlog::error("AGC gain set error: {0}", bladerf_strerror(status));
+        return false;
+    }
+    return true;
+}
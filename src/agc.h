@@ -0,0 +1,76 @@
+#pragma once
+#include <bladerf_device.h>
+#include <sample_convert.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <stdint.h>
+
+// Automatic gain control for the LNA / rxVGA1 / rxVGA2 chain.
+//
+// The RX thread hands over the IqStats the conversion kernels gather anyway (mean,
+// power and peak of the raw samples) once per window, without locking. A thread of
+// its own turns each window into an RMS and peak level, picks a new overall gain
+// and spreads it over the stages, LNA first since it sets the noise figure. Gain
+// writes happen only on that thread, at most once per AGC_MIN_INTERVAL_MS and only
+// for the stages that changed, so a slow USB control transfer never holds up RX.
+class Agc {
+public:
+    struct Gains {
+        int lna = 0;
+        int rxvga1 = 5;
+        int rxvga2 = 0;
+    };
+
+    ~Agc();
+
+    // initial is what the stages are set to right now, windowSamples go into each measurement
+    void start(BladeRFDevice* dev, bladerf_channel ch, const Gains& initial, uint64_t windowSamples);
+    void stop();
+    bool isRunning() { return running; }
+
+    // RX thread
+    void feed(const convert::IqStats& stats);
+
+    // Last gains written and the level they were chosen from
+    Gains gains();
+    float rmsDbfs() { return rms; }
+    float peakDbfs() { return peak; }
+    uint64_t changes() { return changeCount; }
+
+    // Stage values that add up to total, clamped to the chain's range
+    static Gains distribute(int total);
+    static int total(const Gains& g) { return g.lna + g.rxvga1 + g.rxvga2; }
+
+private:
+    static void worker(Agc* _this);
+    void step(const convert::IqStats& stats);
+    bool apply(const Gains& next);
+
+    BladeRFDevice* dev = NULL;
+    bladerf_channel channel = BLADERF_CHANNEL_RX(0);
+    std::thread workerThread;
+    std::mutex mtx;
+    std::condition_variable cnd;
+    bool running = false;
+
+    // Worker side state
+    Gains current;
+    int skip = 0;
+    uint64_t lastChange = 0;
+
+    // Published for the menu
+    std::atomic<int> lna = 0;
+    std::atomic<int> rxvga1 = 5;
+    std::atomic<int> rxvga2 = 0;
+    std::atomic<float> rms = -100.0f;
+    std::atomic<float> peak = -100.0f;
+    std::atomic<uint64_t> changeCount = 0;
+
+    // RX side window, handed over through pending once complete
+    uint64_t window = 0;
+    convert::IqStats acc;
+    convert::IqStats pending;
+    std::atomic<bool> ready = false;
+};
@@ -0,0 +1,27 @@
+#pragma once
+#include <stddef.h>
+#include <stdlib.h>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+// Heap blocks with a caller chosen alignment, e.g. whole pages for O_DIRECT
+// writes or cache lines for buffers shared between threads.
+inline void* alignedAlloc(size_t bytes, size_t alignment) {
+#ifdef _WIN32
+    return _aligned_malloc(bytes, alignment);
+#else
+    void* ptr = NULL;
+    if (alignment < sizeof(void*)) { alignment = sizeof(void*); }
+    if (posix_memalign(&ptr, alignment, bytes) != 0) { return NULL; }
+    return ptr;
+#endif
+}
+
+inline void alignedFree(void* ptr) {
+#ifdef _WIN32
+    _aligned_free(ptr);
+#else
+    free(ptr);
+#endif
+}
@@ -0,0 +1,473 @@
+#include <sample_convert.h>
+#include <rx_metrics.h>
+#include <quick_tune.h>
+#include <stream_tune.h>
+#include <aligned_alloc.h>
+#include <mock_device.h>
+#include <dsp/stream.h>
+#include <config.h>
+#include <algorithm>
+#include <fstream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Benchmark of the source's hot path, standalone against the simulated board:
+//   conversion  SC16_Q11 / SC8_Q7 kernels over the buffer sizes stream tuning can pick
+//   handoff     conversion + dsp::stream swap on one thread, a reader flushing on another
+//   retune      host side cost of a full tune and of a cached quick tune (the mock
+//               answers at once, so USB and PLL time are not part of it)
+//   end to end  mock board -> sync RX with metadata -> conversion -> dsp::stream ->
+//               reader, paced at rates up to 61.44 MS/s, then unpaced for the most the
+//               host sustains
+// The reader only flushes, so every number is the source's own cost.
+//
+// bladerf_bench [--quick] [--json <file>] [--save-baseline <file>] [--check <file>] [--tolerance <fraction>]
+//
+// --save-baseline stores the results, --check compares against stored ones and exits
+// with 1 when any got worse by more than the tolerance (default 0.2). Baselines only
+// mean something on the machine and build they were taken with.
+
+#define BENCH_TRIALS        5           // Conversion timings keep the best trial
+#define BENCH_STAMPS        64          // Blocks in flight between writer and reader, at most 2 in practice
+#define BENCH_LATENCY_MS    5.0         // Latency target the module's stream tuning starts from
+#define BENCH_RETUNE_FREQS  64
+#define BENCH_SERIAL        "mock0000"
+#define BENCH_TOLERANCE     0.2
+// Histogram quantiles move in powers of two, one bucket of drift is noise
+#define BENCH_QUANTILE_TOLERANCE    1.0
+
+struct BenchOptions {
+    bool quick = false;
+    double convertSeconds = 0.05;       // Per trial
+    double handoffSeconds = 1.0;
+    double e2eSeconds = 2.0;
+    int retunePasses = 200;
+    std::string jsonPath;
+    std::string savePath;
+    std::string checkPath;
+    double tolerance = BENCH_TOLERANCE;
+};
+
+struct BenchResult {
+    std::string name;
+    double value;
+    bool higherIsBetter;
+    double tolerance;                   // < 0: the one given on the command line
+};
+
+static std::vector<BenchResult> results;
+
+static void report(const std::string& name, double value, bool higherIsBetter, double tolerance = -1.0) {
+    results.push_back({ name, value, higherIsBetter, tolerance });
+}
+
+static std::string rateName(double rate) {
+    char buf[32];
+    sprintf(buf, "%.2f", rate / 1e6);
+    return buf;
+}
+
+// Stands in for the DSP chain: takes each block and hands the buffer back
+class StreamReader {
+public:
+    // handoff gets the time from the producer's stamp, taken right before swap(), to read() returning
+    StreamReader(dsp::stream<dsp::complex_t>* stream, const uint64_t* stamps, LatencyHistogram* handoff) :
+        stream(stream), stamps(stamps), handoff(handoff) {
+        thread = std::thread(run, this);
+    }
+
+    void stop() {
+        stream->stopReader();
+        thread.join();
+    }
+
+private:
+    static void run(StreamReader* _this) {
+        uint64_t seq = 0;
+        while (true) {
+            int count = _this->stream->read();
+            if (count < 0) { break; }
+            _this->handoff->record(metricsNow() - _this->stamps[seq % BENCH_STAMPS]);
+            seq++;
+            _this->stream->flush();
+        }
+    }
+
+    dsp::stream<dsp::complex_t>* stream;
+    const uint64_t* stamps;
+    LatencyHistogram* handoff;
+    std::thread thread;
+};
+
+// Best of several trials, each long enough to swamp the timer resolution
+template <class F>
+static double nsPerSample(F fn, int count, double seconds) {
+    double best = 1e30;
+    for (int t = 0; t < BENCH_TRIALS; t++) {
+        uint64_t reps = 0;
+        uint64_t start = metricsNow();
+        uint64_t elapsed;
+        do {
+            fn();
+            reps++;
+            elapsed = metricsNow() - start;
+        } while (elapsed < seconds * 1e9);
+        best = std::min<double>(best, (double)elapsed / ((double)reps * count));
+    }
+    return best;
+}
+
+static void benchConversion(const BenchOptions& opts, const int16_t* in16, const int8_t* in8, dsp::complex_t* out) {
+    printf("\nConversion, ns/sample (MS/s)\n");
+    printf("%10s %18s %18s %18s %18s\n", "samples", "scalar", convert::sc16q11KernelName(), "corrected", "sc8");
+
+    convert::IqCorrection corr;
+    corr.dcI = 0.01f;
+    corr.dcQ = -0.01f;
+    corr.gain = 1.02f;
+    corr.phase = 0.01f;
+
+    for (int count = 1024; count <= 512 * 1024; count *= 4) {
+        double scalar = nsPerSample([&]{ convert::sc16q11ToComplexScalar(in16, out, count); }, count, opts.convertSeconds);
+        double sc16 = nsPerSample([&]{ convert::sc16q11ToComplex(in16, out, count); }, count, opts.convertSeconds);
+        double corrected = nsPerSample([&]{
+            convert::IqStats stats;
+            convert::sc16q11ToComplexCorrected(in16, out, count, corr, stats);
+        }, count, opts.convertSeconds);
+        double sc8 = nsPerSample([&]{ convert::sc8q7ToComplex(in8, out, count); }, count, opts.convertSeconds);
+
+        printf("%10d %8.3f (%7.0f) %8.3f (%7.0f) %8.3f (%7.0f) %8.3f (%7.0f)\n", count, scalar, 1e3 / scalar, sc16, 1e3 / sc16,
+               corrected, 1e3 / corrected, sc8, 1e3 / sc8);
+
+        std::string size = std::to_string(count);
+        report("convert_sc16_" + size + "_ns", sc16, false);
+        report("convert_sc16_corrected_" + size + "_ns", corrected, false);
+        report("convert_sc8_" + size + "_ns", sc8, false);
+    }
+}
+
+static void benchHandoff(const BenchOptions& opts, const int16_t* in16) {
+    printf("\nConversion + dsp::stream handoff\n");
+    printf("%10s %10s %14s %14s %14s\n", "samples", "MS/s", "swap p99 us", "handoff p50 us", "handoff p99 us");
+
+    for (int count = 4096; count <= 256 * 1024; count *= 4) {
+        dsp::stream<dsp::complex_t> stream;
+        uint64_t stamps[BENCH_STAMPS];
+        LatencyHistogram handoff;
+        LatencyHistogram swapWait;
+        StreamReader reader(&stream, stamps, &handoff);
+
+        uint64_t seq = 0;
+        uint64_t start = metricsNow();
+        uint64_t end = start + (uint64_t)(opts.handoffSeconds * 1e9);
+        while (metricsNow() < end) {
+            convert::sc16q11ToComplex(in16, stream.writeBuf, count);
+            uint64_t now = metricsNow();
+            stamps[seq % BENCH_STAMPS] = now;
+            if (!stream.swap(count)) { break; }
+            swapWait.record(metricsNow() - now);
+            seq++;
+        }
+        double msps = (double)(seq * count) / ((metricsNow() - start) / 1e9) / 1e6;
+        stream.stopWriter();
+        reader.stop();
+
+        printf("%10d %10.1f %14.1f %14.1f %14.1f\n", count, msps, swapWait.quantileNs(0.99) / 1e3,
+               handoff.quantileNs(0.5) / 1e3, handoff.quantileNs(0.99) / 1e3);
+
+        std::string size = std::to_string(count);
+        report("handoff_" + size + "_msps", msps, true);
+        report("handoff_" + size + "_p99_ns", handoff.quantileNs(0.99), false, BENCH_QUANTILE_TOLERANCE);
+    }
+}
+
+// Same steps as applyFrequency() in the module: a full tune that leaves a profile in
+// the cache, then quick tunes from it
+static void benchRetune(const BenchOptions& opts) {
+    mock::Options mo;
+    mo.paced = false;
+    BladeRFDevice* dev = mock::create(mo);
+    if (dev->open(BENCH_SERIAL) != 0) {
+        printf("Could not open the simulated board\n");
+        delete dev;
+        return;
+    }
+
+    bladerf_channel ch = BLADERF_CHANNEL_RX(0);
+    QuickTuneCache cache;
+    LatencyHistogram full;
+    LatencyHistogram quick;
+    for (int pass = 0; pass < opts.retunePasses; pass++) {
+        cache.clear();
+        for (int i = 0; i < BENCH_RETUNE_FREQS; i++) {
+            bladerf_frequency f = 100000000 + (bladerf_frequency)i * 1000000;
+            uint64_t start = metricsNow();
+            if (cache.find(ch, f) == NULL) {
+                dev->setFrequency(ch, f);
+                struct bladerf_quick_tune qt;
+                if (dev->getQuickTune(ch, &qt) == 0) { cache.store(ch, f, qt); }
+            }
+            full.record(metricsNow() - start);
+        }
+        for (int i = 0; i < BENCH_RETUNE_FREQS; i++) {
+            bladerf_frequency f = 100000000 + (bladerf_frequency)i * 1000000;
+            uint64_t start = metricsNow();
+            struct bladerf_quick_tune* qt = cache.find(ch, f);
+            dev->scheduleRetune(ch, BLADERF_RETUNE_NOW, f, qt);
+            quick.record(metricsNow() - start);
+        }
+    }
+    dev->close();
+    delete dev;
+
+    printf("\nRetune call overhead, host side\n");
+    printf("%10s %10s %10s %10s\n", "", "mean ns", "p99 ns", "max ns");
+    printf("%10s %10.0f %10llu %10llu\n", "full", full.meanNs(), (unsigned long long)full.quantileNs(0.99), (unsigned long long)full.maxNs());
+    printf("%10s %10.0f %10llu %10llu\n", "quick", quick.meanNs(), (unsigned long long)quick.quantileNs(0.99), (unsigned long long)quick.maxNs());
+
+    report("retune_full_mean_ns", full.meanNs(), false);
+    report("retune_quick_mean_ns", quick.meanNs(), false);
+    report("retune_quick_p99_ns", quick.quantileNs(0.99), false, BENCH_QUANTILE_TOLERANCE);
+}
+
+struct EndToEnd {
+    double msps = 0;
+    uint64_t blocks = 0;
+    uint64_t overruns = 0;
+    uint64_t lostSamples = 0;
+    uint64_t errors = 0;
+    LatencyHistogram rxWait;
+    LatencyHistogram handoff;
+};
+
+// The worker loop of the module on the simulated board, with the buffers stream tuning would start from
+static bool runEndToEnd(double rate, bool paced, double seconds, EndToEnd& res) {
+    mock::Options mo;
+    mo.paced = paced;
+    BladeRFDevice* dev = mock::create(mo);
+    bladerf_channel ch = BLADERF_CHANNEL_RX(0);
+    streamtune::Params params = streamtune::initial(rate, BENCH_LATENCY_MS);
+    unsigned int timeout = streamtune::timeoutMs(params, rate);
+    int count = params.bufferSize;
+
+    int status = dev->open(BENCH_SERIAL);
+    if (status == 0) { status = dev->setSampleRate(ch, rate, NULL); }
+    if (status == 0) {
+        status = dev->syncConfig(BLADERF_RX_X1, BLADERF_FORMAT_SC16_Q11_META, params.numBuffers, params.bufferSize,
+                                 params.numTransfers, timeout);
+    }
+    if (status == 0) { status = dev->enableModule(ch, true); }
+    if (status != 0) {
+        printf("Could not set up the simulated board at %s MS/s (%d)\n", rateName(rate).c_str(), status);
+        delete dev;
+        return false;
+    }
+
+    int16_t* block = (int16_t*)alignedAlloc(count * 2 * sizeof(int16_t), 4096);
+    dsp::stream<dsp::complex_t> stream;
+    uint64_t stamps[BENCH_STAMPS];
+    StreamReader reader(&stream, stamps, &res.handoff);
+
+    uint64_t seq = 0;
+    uint64_t delivered = 0;
+    uint64_t nextTimestamp = 0;
+    bool haveTimestamp = false;
+    uint64_t start = metricsNow();
+    uint64_t end = start + (uint64_t)(seconds * 1e9);
+    while (metricsNow() < end) {
+        struct bladerf_metadata meta;
+        memset(&meta, 0, sizeof(meta));
+        meta.flags = BLADERF_META_FLAG_RX_NOW;
+        uint64_t rxStart = metricsNow();
+        status = dev->syncRx(block, count, &meta, timeout);
+        res.rxWait.record(metricsNow() - rxStart);
+        if (status != 0) {
+            res.errors++;
+            continue;
+        }
+        res.blocks++;
+        if (haveTimestamp && meta.timestamp > nextTimestamp) { res.lostSamples += meta.timestamp - nextTimestamp; }
+        if (meta.status & BLADERF_META_STATUS_OVERRUN) { res.overruns++; }
+        nextTimestamp = meta.timestamp + meta.actual_count;
+        haveTimestamp = true;
+
+        convert::sc16q11ToComplex(block, stream.writeBuf, meta.actual_count);
+        stamps[seq % BENCH_STAMPS] = metricsNow();
+        if (!stream.swap(meta.actual_count)) { break; }
+        seq++;
+        delivered += meta.actual_count;
+    }
+    res.msps = (double)delivered / ((metricsNow() - start) / 1e9) / 1e6;
+
+    stream.stopWriter();
+    reader.stop();
+    dev->enableModule(ch, false);
+    dev->close();
+    delete dev;
+    alignedFree(block);
+    return true;
+}
+
+static void benchEndToEnd(const BenchOptions& opts) {
+    printf("\nEnd to end on the simulated board\n");
+    printf("%10s %10s %9s %10s %12s %14s %14s %14s %10s\n", "MS/s", "delivered", "overruns", "lost", "rx p99 us",
+           "handoff p50 us", "handoff p99 us", "handoff max us", "");
+
+    const double rates[] = { 1.92e6, 7.68e6, 15.36e6, 30.72e6, 61.44e6 };
+    for (double rate : rates) {
+        EndToEnd res;
+        if (!runEndToEnd(rate, true, opts.e2eSeconds, res)) { continue; }
+        bool sustained = res.overruns == 0 && res.errors == 0;
+        printf("%10.2f %10.2f %9llu %10llu %12.1f %14.1f %14.1f %14.1f %10s\n", rate / 1e6, res.msps, (unsigned long long)res.overruns,
+               (unsigned long long)res.lostSamples, res.rxWait.quantileNs(0.99) / 1e3, res.handoff.quantileNs(0.5) / 1e3,
+               res.handoff.quantileNs(0.99) / 1e3, res.handoff.maxNs() / 1e3, sustained ? "ok" : "DROPS");
+
+        // A run is a few hundred blocks, too few for its tail latency to be compared between runs
+        report("e2e_" + rateName(rate) + "_sustained", sustained ? 1.0 : 0.0, true);
+    }
+
+    // Unpaced the board produces as fast as it is read, what comes out is the most the host keeps up with
+    EndToEnd res;
+    if (runEndToEnd(61.44e6, false, opts.e2eSeconds, res)) {
+        printf("Max sustainable: %.1f MS/s (simulated board's copy included)\n", res.msps);
+        report("e2e_max_msps", res.msps, true);
+    }
+}
+
+static json resultsJson(const BenchOptions& opts) {
+    json out = json({});
+    out["kernels"]["sc16"] = convert::sc16q11KernelName();
+    out["kernels"]["sc16_corrected"] = convert::sc16q11CorrectedKernelName();
+    out["kernels"]["sc8"] = convert::sc8q7KernelName();
+    out["quick"] = opts.quick;
+    out["results"] = json({});
+    for (auto& r : results) {
+        out["results"][r.name] = r.value;
+    }
+    return out;
+}
+
+static bool writeJson(const std::string& path, const json& data) {
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        fprintf(stderr, "Could not write %s\n", path.c_str());
+        return false;
+    }
+    file << data.dump(4) << std::endl;
+    return true;
+}
+
+// Every result also in the baseline has to be within the tolerance of it
+static bool checkBaseline(const BenchOptions& opts) {
+    json base;
+    std::ifstream file(opts.checkPath);
+    if (!file.is_open()) {
+        fprintf(stderr, "Could not open baseline %s\n", opts.checkPath.c_str());
+        return false;
+    }
+    try {
+        file >> base;
+    }
+    catch (std::exception& e) {
+        fprintf(stderr, "Could not parse baseline %s: %s\n", opts.checkPath.c_str(), e.what());
+        return false;
+    }
+    if (!base.contains("results")) {
+        fprintf(stderr, "Baseline %s has no results\n", opts.checkPath.c_str());
+        return false;
+    }
+
+    printf("\nAgainst baseline %s\n", opts.checkPath.c_str());
+    if (base.contains("kernels") && base["kernels"]["sc16"] != convert::sc16q11KernelName()) {
+        printf("Warning: baseline was taken with the %s kernel, this run uses %s\n",
+               base["kernels"]["sc16"].get<std::string>().c_str(), convert::sc16q11KernelName());
+    }
+    if (base.contains("quick") && base["quick"] != opts.quick) {
+        printf("Warning: baseline and this run differ in --quick\n");
+    }
+
+    int checked = 0;
+    int regressions = 0;
+    for (auto& r : results) {
+        if (!base["results"].contains(r.name)) { continue; }
+        double ref = base["results"][r.name];
+        double tolerance = (r.tolerance >= 0) ? r.tolerance : opts.tolerance;
+        bool regressed = r.higherIsBetter ? (r.value < ref * (1.0 - tolerance)) : (r.value > ref * (1.0 + tolerance));
+        checked++;
+        if (!regressed) { continue; }
+        regressions++;
+        printf("REGRESSION %-36s %14.3f, baseline %14.3f\n", r.name.c_str(), r.value, ref);
+    }
+
+    if (checked == 0) {
+        printf("No result of this run is in the baseline\n");
+        return false;
+    }
+    printf("%d of %d results regressed past %.0f%%\n", regressions, checked, opts.tolerance * 100.0);
+    return regressions == 0;
+}
+
+static void usage() {
+    printf("bladerf_bench [--quick] [--json <file>] [--save-baseline <file>] [--check <file>] [--tolerance <fraction>]\n");
+}
+
+int main(int argc, char* argv[]) {
+    BenchOptions opts;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = (i + 1 < argc);
+        if (arg == "--quick") {
+            opts.quick = true;
+            opts.convertSeconds = 0.01;
+            opts.handoffSeconds = 0.25;
+            opts.e2eSeconds = 0.5;
+            opts.retunePasses = 50;
+        }
+        else if (arg == "--json" && hasValue) { opts.jsonPath = argv[++i]; }
+        else if (arg == "--save-baseline" && hasValue) { opts.savePath = argv[++i]; }
+        else if (arg == "--check" && hasValue) { opts.checkPath = argv[++i]; }
+        else if (arg == "--tolerance" && hasValue) { opts.tolerance = atof(argv[++i]); }
+        else {
+            usage();
+            return 2;
+        }
+    }
+
+    printf("Kernels: sc16 %s, corrected %s, sc8 %s\n", convert::sc16q11KernelName(), convert::sc16q11CorrectedKernelName(),
+           convert::sc8q7KernelName());
+
+    // Full scale Q11 noise, random so no kernel benefits from repeating data
+    int maxCount = 512 * 1024;
+    int16_t* in16 = (int16_t*)alignedAlloc(maxCount * 2 * sizeof(int16_t), 4096);
+    int8_t* in8 = (int8_t*)alignedAlloc(maxCount * 2 * sizeof(int8_t), 4096);
+    dsp::complex_t* out = (dsp::complex_t*)alignedAlloc(maxCount * sizeof(dsp::complex_t), 4096);
+    std::mt19937 rng(1234);
+    std::uniform_int_distribution<int> q11(-2048, 2047);
+    for (int i = 0; i < maxCount * 2; i++) {
+        in16[i] = q11(rng);
+        in8[i] = in16[i] >> 4;
+    }
+
+    benchConversion(opts, in16, in8, out);
+    benchHandoff(opts, in16);
+    benchRetune(opts);
+    benchEndToEnd(opts);
+
+    alignedFree(in16);
+    alignedFree(in8);
+    alignedFree(out);
+
+    json data = resultsJson(opts);
+    if (!opts.jsonPath.empty()) { writeJson(opts.jsonPath, data); }
+    if (!opts.savePath.empty()) {
+        if (!writeJson(opts.savePath, data)) { return 1; }
+        printf("\nBaseline saved to %s\n", opts.savePath.c_str());
+    }
+    if (!opts.checkPath.empty() && !checkBaseline(opts)) { return 1; }
+    return 0;
+}
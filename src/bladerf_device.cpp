@@ -0,0 +1,179 @@
+#include <bladerf_device.h>
+#include <replay_device.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#ifdef BLADERF_MOCK
+#include <mock_device.h>
+#endif
+
+// How long an enumeration is reused by instances asking for the list
+#define DEVICE_LIST_MAX_AGE_MS  2000
+
+class HardwareBladeRFDevice : public BladeRFDevice {
+public:
+    ~HardwareBladeRFDevice() {
+        close();
+    }
+
+    int open(const std::string& serial) {
+        struct bladerf_devinfo devInfo;
+
+        /* Initialize the information used to identify the desired device
+         * to all wildcard (i.e., "any device") values */
+        bladerf_init_devinfo(&devInfo);
+        strncpy(devInfo.serial, serial.c_str(), sizeof(devInfo.serial) - 1);
+        int status = bladerf_open_with_devinfo(&dev, &devInfo);
+        if (status != 0) { dev = NULL; }
+        return status;
+    }
+
+    void close() {
+        deinitStream();
+        if (dev != NULL) {
+            bladerf_close(dev);
+            dev = NULL;
+        }
+    }
+
+    int loadFpga(const char* path) { return bladerf_load_fpga(dev, path); }
+    int isFpgaConfigured() { return bladerf_is_fpga_configured(dev); }
+    int getFpgaSize(bladerf_fpga_size* size) { return bladerf_get_fpga_size(dev, size); }
+    int fpgaVersion(std::string& version) {
+        struct bladerf_version ver;
+        int status = bladerf_fpga_version(dev, &ver);
+        if (status == 0) { version = ver.describe; }
+        return status;
+    }
+    std::string boardName() { return bladerf_get_board_name(dev); }
+
+    int getSampleRateRange(bladerf_channel ch, const struct bladerf_range** range) { return bladerf_get_sample_rate_range(dev, ch, range); }
+    int getBandwidthRange(bladerf_channel ch, const struct bladerf_range** range) { return bladerf_get_bandwidth_range(dev, ch, range); }
+    int setSampleRate(bladerf_channel ch, bladerf_sample_rate rate, bladerf_sample_rate* actual) { return bladerf_set_sample_rate(dev, ch, rate, actual); }
+    int setBandwidth(bladerf_channel ch, bladerf_bandwidth bandwidth, bladerf_bandwidth* actual) { return bladerf_set_bandwidth(dev, ch, bandwidth, actual); }
+    int setFrequency(bladerf_channel ch, bladerf_frequency frequency) { return bladerf_set_frequency(dev, ch, frequency); }
+    int getQuickTune(bladerf_channel ch, struct bladerf_quick_tune* quickTune) { return bladerf_get_quick_tune(dev, ch, quickTune); }
+    int scheduleRetune(bladerf_channel ch, bladerf_timestamp timestamp, bladerf_frequency frequency, struct bladerf_quick_tune* quickTune) {
+        return bladerf_schedule_retune(dev, ch, timestamp, frequency, quickTune);
+    }
+    int cancelScheduledRetunes(bladerf_channel ch) { return bladerf_cancel_scheduled_retunes(dev, ch); }
+    int getRxTimestamp(bladerf_timestamp* timestamp) { return bladerf_get_timestamp(dev, BLADERF_RX, timestamp); }
+    int setGainStage(bladerf_channel ch, const char* stage, bladerf_gain gain) { return bladerf_set_gain_stage(dev, ch, stage, gain); }
+    int setGain(bladerf_channel ch, bladerf_gain gain) { return bladerf_set_gain(dev, ch, gain); }
+    int setGainMode(bladerf_channel ch, bladerf_gain_mode mode) { return bladerf_set_gain_mode(dev, ch, mode); }
+    int enableModule(bladerf_channel ch, bool enable) { return bladerf_enable_module(dev, ch, enable); }
+    int setCorrection(bladerf_channel ch, bladerf_correction corr, bladerf_correction_value value) {
+        return bladerf_set_correction(dev, ch, corr, value);
+    }
+
+    int expansionAttach(bladerf_xb xb) { return bladerf_expansion_attach(dev, xb); }
+    int xb200SetPath(bladerf_channel ch, bladerf_xb200_path path) { return bladerf_xb200_set_path(dev, ch, path); }
+    int xb200SetFilterbank(bladerf_channel ch, bladerf_xb200_filter filter) { return bladerf_xb200_set_filterbank(dev, ch, filter); }
+
+    int syncConfig(bladerf_channel_layout layout, bladerf_format format, unsigned int numBuffers,
+                   unsigned int bufferSize, unsigned int numTransfers, unsigned int timeout) {
+        return bladerf_sync_config(dev, layout, format, numBuffers, bufferSize, numTransfers, timeout);
+    }
+
+    int syncRx(void* samples, unsigned int numSamples, struct bladerf_metadata* meta, unsigned int timeout) {
+        return bladerf_sync_rx(dev, samples, numSamples, meta, timeout);
+    }
+
+    int initStream(bladerf_stream_cb callback, void*** buffers, size_t numBuffers, bladerf_format format,
+                   size_t samplesPerBuffer, size_t numTransfers, void* userData) {
+        int status = bladerf_init_stream(&stream, dev, callback, buffers, numBuffers, format, samplesPerBuffer, numTransfers, userData);
+        if (status != 0) { stream = NULL; }
+        return status;
+    }
+
+    int setStreamTimeout(unsigned int timeout) { return bladerf_set_stream_timeout(dev, BLADERF_RX, timeout); }
+    int runStream(bladerf_channel_layout layout) { return bladerf_stream(stream, layout); }
+
+    void deinitStream() {
+        if (stream != NULL) {
+            bladerf_deinit_stream(stream);
+            stream = NULL;
+        }
+    }
+
+private:
+    struct bladerf* dev = NULL;
+    struct bladerf_stream* stream = NULL;
+};
+
+namespace bladerfdev {
+    static std::mutex listMtx;
+    static std::vector<std::string> cachedList;
+    static std::chrono::steady_clock::time_point cachedAt;
+    static bool haveList = false;
+
+    static std::mutex claimsMtx;
+    static std::map<std::string, std::string> claims;
+    static std::atomic<uint64_t> claimsVer = 0;
+
+    static std::vector<std::string> enumerate() {
+        std::vector<std::string> serials;
+
+        struct bladerf_devinfo* devInfo;
+        int n = bladerf_get_device_list(&devInfo);
+        for (int i = 0; i < n; i++) {
+            serials.push_back(devInfo[i].serial);
+        }
+        if (n > 0) { bladerf_free_device_list(devInfo); }
+
+#ifdef BLADERF_MOCK
+        std::vector<std::string> simulated = mock::listDevices();
+        serials.insert(serials.end(), simulated.begin(), simulated.end());
+#endif
+        return serials;
+    }
+
+    // Enumeration opens every board's USB descriptors, instances created together share one pass
+    std::vector<std::string> listDevices(bool force) {
+        std::lock_guard<std::mutex> lck(listMtx);
+        auto now = std::chrono::steady_clock::now();
+        if (force || !haveList || now - cachedAt > std::chrono::milliseconds(DEVICE_LIST_MAX_AGE_MS)) {
+            cachedList = enumerate();
+            cachedAt = now;
+            haveList = true;
+        }
+        return cachedList;
+    }
+
+    bool claim(const std::string& serial, const std::string& owner) {
+        std::lock_guard<std::mutex> lck(claimsMtx);
+        auto it = claims.find(serial);
+        if (it != claims.end()) { return it->second == owner; }
+        claims[serial] = owner;
+        claimsVer++;
+        return true;
+    }
+
+    void release(const std::string& serial, const std::string& owner) {
+        std::lock_guard<std::mutex> lck(claimsMtx);
+        auto it = claims.find(serial);
+        if (it == claims.end() || it->second != owner) { return; }
+        claims.erase(it);
+        claimsVer++;
+    }
+
+    std::string ownerOf(const std::string& serial) {
+        std::lock_guard<std::mutex> lck(claimsMtx);
+        auto it = claims.find(serial);
+        return (it != claims.end()) ? it->second : "";
+    }
+
+    uint64_t claimsVersion() {
+        return claimsVer;
+    }
+
+    BladeRFDevice* create(const std::string& serial) {
+        if (replay::isReplaySerial(serial)) { return replay::create(serial, replay::Options()); }
+#ifdef BLADERF_MOCK
+        if (mock::isMockSerial(serial)) { return mock::create(); }
+#endif
+        return new HardwareBladeRFDevice();
+    }
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <libbladeRF.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Thin layer over the libbladeRF calls made by the source module, so the
+// module can run against real hardware or a simulated board alike.
+// Every method returns libbladeRF status codes.
+class BladeRFDevice {
+public:
+    virtual ~BladeRFDevice() {}
+
+    virtual int open(const std::string& serial) = 0;
+    virtual void close() = 0;
+
+    virtual int loadFpga(const char* path) = 0;
+    virtual int isFpgaConfigured() = 0;
+    virtual int getFpgaSize(bladerf_fpga_size* size) = 0;
+    virtual int fpgaVersion(std::string& version) = 0;
+    virtual std::string boardName() = 0;
+
+    virtual int getSampleRateRange(bladerf_channel ch, const struct bladerf_range** range) = 0;
+    virtual int getBandwidthRange(bladerf_channel ch, const struct bladerf_range** range) = 0;
+    virtual int setSampleRate(bladerf_channel ch, bladerf_sample_rate rate, bladerf_sample_rate* actual) = 0;
+    virtual int setBandwidth(bladerf_channel ch, bladerf_bandwidth bandwidth, bladerf_bandwidth* actual) = 0;
+    virtual int setFrequency(bladerf_channel ch, bladerf_frequency frequency) = 0;
+    virtual int getQuickTune(bladerf_channel ch, struct bladerf_quick_tune* quickTune) = 0;
+    // quickTune may be NULL, timestamp may be BLADERF_RETUNE_NOW
+    virtual int scheduleRetune(bladerf_channel ch, bladerf_timestamp timestamp, bladerf_frequency frequency,
+                               struct bladerf_quick_tune* quickTune) = 0;
+    virtual int cancelScheduledRetunes(bladerf_channel ch) = 0;
+    // Current value of the RX sample counter the metadata timestamps are based on
+    virtual int getRxTimestamp(bladerf_timestamp* timestamp) = 0;
+    virtual int setGainStage(bladerf_channel ch, const char* stage, bladerf_gain gain) = 0;
+    virtual int setGain(bladerf_channel ch, bladerf_gain gain) = 0;
+    virtual int setGainMode(bladerf_channel ch, bladerf_gain_mode mode) = 0;
+    virtual int enableModule(bladerf_channel ch, bool enable) = 0;
+    virtual int setCorrection(bladerf_channel ch, bladerf_correction corr, bladerf_correction_value value) = 0;
+
+    virtual int expansionAttach(bladerf_xb xb) = 0;
+    virtual int xb200SetPath(bladerf_channel ch, bladerf_xb200_path path) = 0;
+    virtual int xb200SetFilterbank(bladerf_channel ch, bladerf_xb200_filter filter) = 0;
+
+    // Sync interface
+    virtual int syncConfig(bladerf_channel_layout layout, bladerf_format format, unsigned int numBuffers,
+                           unsigned int bufferSize, unsigned int numTransfers, unsigned int timeout) = 0;
+    virtual int syncRx(void* samples, unsigned int numSamples, struct bladerf_metadata* meta, unsigned int timeout) = 0;
+
+    // Async interface, the device owns the stream between initStream() and deinitStream()
+    virtual int initStream(bladerf_stream_cb callback, void*** buffers, size_t numBuffers, bladerf_format format,
+                           size_t samplesPerBuffer, size_t numTransfers, void* userData) = 0;
+    virtual int setStreamTimeout(unsigned int timeout) = 0;
+    virtual int runStream(bladerf_channel_layout layout) = 0;
+    virtual void deinitStream() = 0;
+};
+
+namespace bladerfdev {
+    // Serials of every device available, hardware and (when built in) simulated.
+    // The list is shared by all module instances, a call shortly after another
+    // returns the same list without enumerating the bus again unless forced.
+    std::vector<std::string> listDevices(bool force = false);
+
+    // A board is used by one module instance at a time. claim() succeeds when the
+    // serial is free or already held by owner.
+    bool claim(const std::string& serial, const std::string& owner);
+    void release(const std::string& serial, const std::string& owner);
+    std::string ownerOf(const std::string& serial);
+    // Changes whenever a claim is taken or released, for menus showing ownership
+    uint64_t claimsVersion();
+
+    // Create an unopened device for the given serial
+    BladeRFDevice* create(const std::string& serial);
+}
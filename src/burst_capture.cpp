@@ -0,0 +1,291 @@
+#include <burst_capture.h>
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <math.h>
+#include <string.h>
+#include <time.h>
+#include <utility>
+#include <vector>
+
+#define BURST_HEADROOM_S        1.0     // Arena beyond the pre-trigger window, what the disk may lag by
+#define BURST_MIN_ARENA         (16 * 1024 * 1024)
+#define BURST_CHUNK_BYTES       (1024 * 1024)
+#define BURST_POLL_MS           5       // How often the writer looks for a trigger or new data
+#define BURST_FULL_SCALE        2048.0
+
+BurstCapture::~BurstCapture() {
+    stop();
+}
+
+size_t BurstCapture::arenaBytes(double sampleRate, int sampleBytes, double preSeconds) {
+    size_t bytes = (preSeconds + BURST_HEADROOM_S) * sampleRate * sampleBytes;
+    bytes = std::max<size_t>(bytes, BURST_MIN_ARENA);
+    return (bytes + 4095) / 4096 * 4096;
+}
+
+bool BurstCapture::start(const std::string& basePath, const Info& info, int sampleBytes, const Settings& settings, uint8_t* arena, size_t arenaBytes) {
+    if (enabled) { return true; }
+    if (arena == NULL) {
+        spdlog::error("Burst capture: no buffer for the pre-trigger window");
+        return false;
+    }
+    this->basePath = basePath;
+    this->info = info;
+    this->sampleBytes = sampleBytes;
+    this->settings = settings;
+    this->arena = arena;
+    // Whole samples, so positions stay sample aligned across the wrap
+    capacity = arenaBytes / sampleBytes * sampleBytes;
+
+    frequency = info.frequency;
+    head = 0;
+    writeStart = 0;
+    state = STATE_ARMED;
+    flushing = false;
+    level = -100.0f;
+    burstCount = 0;
+    missedCount = 0;
+    lostCount = 0;
+
+    enabled = true;
+    writerThread = std::thread(writer, this);
+    spdlog::info("Burst capture armed at {0:.1f} dBFS, {1:.1f} s before, {2:.1f} s after, {3} MB window", settings.thresholdDbfs,
+                 settings.preSeconds, settings.postSeconds, capacity >> 20);
+    return true;
+}
+
+void BurstCapture::stop() {
+    if (!enabled) { return; }
+    enabled = false;
+    while (producerActive || feederActive) { std::this_thread::yield(); }
+
+    // A burst still going is cut at what has been received
+    if (flushing && flushEnd == UINT64_MAX) { flushEnd = head.load(); }
+    writerThread.join();
+    arena = NULL;
+    spdlog::info("Burst capture: {0} bursts written, {1} missed", (uint64_t)burstCount, (uint64_t)missedCount);
+}
+
+double BurstCapture::powerDbfs(const convert::IqStats& stats) {
+    // Same measure as the AGC, without DC
+    double n = (double)stats.count;
+    double mI = stats.sumI / n;
+    double mQ = stats.sumQ / n;
+    double power = ((stats.sumII / n) - (mI * mI)) + ((stats.sumQQ / n) - (mQ * mQ));
+    return 10.0 * log10(std::max<double>(power, 1e-3) / (BURST_FULL_SCALE * BURST_FULL_SCALE));
+}
+
+uint64_t BurstCapture::write(const void* data, int count) {
+    producerActive = true;
+    if (!enabled) {
+        producerActive = false;
+        return 0;
+    }
+
+    size_t bytes = (size_t)count * sampleBytes;
+    const uint8_t* in = (const uint8_t*)data;
+    uint64_t h = head.load(std::memory_order_relaxed);
+    // Announce the region being overwritten before touching it, the writer checks this after reading
+    writeStart.store(h + bytes, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    while (bytes > 0) {
+        size_t off = h % capacity;
+        size_t n = std::min<size_t>(bytes, capacity - off);
+        memcpy(arena + off, in, n);
+        in += n;
+        h += n;
+        bytes -= n;
+    }
+    head.store(h, std::memory_order_release);
+    producerActive = false;
+    return h;
+}
+
+void BurstCapture::feed(const convert::IqStats& stats, uint64_t blockEnd) {
+    feederActive = true;
+    if (!enabled || stats.count == 0) {
+        feederActive = false;
+        return;
+    }
+
+    double db = powerDbfs(stats);
+    level = db;
+    // Where the block was written, head may be up to the pipeline's ring ahead. Blocks
+    // queued before a restart carry positions of the last capture, they can't be past head.
+    uint64_t h = std::min<uint64_t>(blockEnd, head.load(std::memory_order_acquire));
+    uint64_t blockBytes = stats.count * sampleBytes;
+    uint64_t blockStart = (h >= blockBytes) ? h - blockBytes : 0;
+    double release = settings.thresholdDbfs - settings.hysteresisDb;
+
+    if (state == STATE_ARMED) {
+        if (db >= settings.thresholdDbfs) {
+            if (flushing.load(std::memory_order_acquire)) {
+                // The last burst is still going to disk
+                missedCount++;
+            }
+            else {
+                uint64_t pre = (uint64_t)(settings.preSeconds * info.sampleRate) * sampleBytes;
+                flushFrom = (blockStart > pre) ? blockStart - pre : 0;
+                triggerPos = blockStart;
+                aboveEnd = h;
+                flushEnd = UINT64_MAX;
+                peakDbfs = db;
+                triggerFreq = frequency;
+                triggerTime = time(NULL);
+                flushing.store(true, std::memory_order_release);
+                state = STATE_ABOVE;
+            }
+        }
+    }
+    else if (db >= release) {
+        // Still or again above the release level, the burst goes on
+        if (db > peakDbfs) { peakDbfs = db; }
+        aboveEnd = h;
+        state = STATE_ABOVE;
+    }
+    else if (state == STATE_ABOVE) {
+        state = STATE_POST;
+        releasePos = blockStart;
+    }
+    else {
+        uint64_t post = (uint64_t)(settings.postSeconds * info.sampleRate) * sampleBytes;
+        if (h - releasePos >= post) {
+            flushEnd.store(releasePos + post, std::memory_order_release);
+            state = STATE_ARMED;
+        }
+    }
+    feederActive = false;
+}
+
+bool BurstCapture::overwritten(uint64_t pos) {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return writeStart.load(std::memory_order_relaxed) > pos + capacity;
+}
+
+void BurstCapture::writer(BurstCapture* _this) {
+    while (true) {
+        if (!_this->flushing.load(std::memory_order_acquire)) {
+            if (!_this->enabled) { break; }
+            std::this_thread::sleep_for(std::chrono::milliseconds(BURST_POLL_MS));
+            continue;
+        }
+        _this->writeBurst();
+        _this->flushing.store(false, std::memory_order_release);
+    }
+}
+
+void BurstCapture::writeBurst() {
+    char stamp[64];
+    strftime(stamp, sizeof(stamp), "%Y%m%dT%H%M%SZ", gmtime(&triggerTime));
+    std::string path = basePath + "-" + stamp + "-" + std::to_string(burstCount + 1);
+    FILE* file = fopen((path + ".sigmf-data").c_str(), "wb");
+    if (file == NULL) {
+        spdlog::error("Could not open {0}.sigmf-data for a burst", path);
+    }
+
+    // Arena position of each capture segment's first sample, to place the annotation in the file
+    std::vector<std::pair<uint64_t, uint64_t>> segments;
+    json captures = json::array();
+    auto addCapture = [&](uint64_t pos, uint64_t fileSample) {
+        json cap = json({});
+        cap["core:sample_start"] = fileSample;
+        cap["core:frequency"] = triggerFreq;
+        if (fileSample == 0) {
+            char buf[64];
+            strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%SZ", gmtime(&triggerTime));
+            cap["core:datetime"] = std::string(buf);
+        }
+        captures.push_back(cap);
+        segments.push_back({ pos, fileSample });
+    };
+
+    // Copied out before writing, so a block overwritten mid-copy never reaches the file
+    std::vector<uint8_t> bounce(BURST_CHUNK_BYTES);
+    uint64_t from = flushFrom;
+    uint64_t fileBytes = 0;
+    addCapture(from, 0);
+    while (true) {
+        uint64_t end = flushEnd.load(std::memory_order_acquire);
+        uint64_t avail = std::min<uint64_t>(head.load(std::memory_order_acquire), end);
+        if (from >= avail) {
+            if (end != UINT64_MAX) { break; }
+            std::this_thread::sleep_for(std::chrono::milliseconds(BURST_POLL_MS));
+            continue;
+        }
+
+        size_t off = from % capacity;
+        size_t chunk = std::min<uint64_t>(std::min<uint64_t>(avail - from, capacity - off), BURST_CHUNK_BYTES);
+        memcpy(bounce.data(), arena + off, chunk);
+        if (overwritten(from)) {
+            // The disk fell a whole window behind, resume a quarter window ahead of the RX thread
+            uint64_t next = writeStart.load() - capacity + capacity / 4;
+            next -= next % sampleBytes;
+            lostCount += next - from;
+            from = next;
+            addCapture(from, fileBytes / sampleBytes);
+            spdlog::warn("Burst capture: disk too slow, {0} bytes lost", (uint64_t)lostCount);
+            continue;
+        }
+        if (file != NULL && fwrite(bounce.data(), 1, chunk, file) != chunk) {
+            spdlog::error("Burst capture write failed");
+            fclose(file);
+            file = NULL;
+        }
+        fileBytes += chunk;
+        from += chunk;
+    }
+
+    if (file == NULL) { return; }
+    fclose(file);
+
+    // Arena positions to samples in the file, positions skipped over map to the next segment
+    auto toFileSample = [&](uint64_t pos) {
+        uint64_t sample = 0;
+        for (auto& seg : segments) {
+            if (seg.first > pos) { break; }
+            sample = seg.second + (pos - seg.first) / sampleBytes;
+        }
+        return std::min<uint64_t>(sample, fileBytes / sampleBytes);
+    };
+    uint64_t trigger = toFileSample(std::max<uint64_t>(triggerPos, flushFrom));
+    uint64_t above = toFileSample(aboveEnd);
+    writeMeta(path, captures, trigger, std::max<uint64_t>(above, trigger));
+    burstCount++;
+    spdlog::info("Burst {0} written to {1}.sigmf-data, {2} samples, peak {3:.1f} dBFS", (uint64_t)burstCount, path,
+                 fileBytes / sampleBytes, (float)peakDbfs);
+}
+
+void BurstCapture::writeMeta(const std::string& path, const json& captures, uint64_t triggerSample, uint64_t endSample) {
+    json meta = json({});
+    meta["global"]["core:datatype"] = info.datatype;
+    meta["global"]["core:sample_rate"] = info.sampleRate;
+    meta["global"]["core:version"] = "1.0.0";
+    meta["global"]["core:num_channels"] = 1;
+    meta["global"]["core:recorder"] = "sdrpp bladerf_source";
+    meta["global"]["core:hw"] = "bladeRF";
+    for (auto& item : info.hardware.items()) {
+        meta["global"]["bladerf:" + item.key()] = item.value();
+    }
+    meta["global"]["bladerf:threshold_dbfs"] = settings.thresholdDbfs;
+    meta["global"]["bladerf:hysteresis_db"] = settings.hysteresisDb;
+    meta["global"]["bladerf:pre_trigger_s"] = settings.preSeconds;
+    meta["global"]["bladerf:post_trigger_s"] = settings.postSeconds;
+    meta["captures"] = captures;
+
+    json ann = json({});
+    ann["core:sample_start"] = triggerSample;
+    ann["core:sample_count"] = endSample - triggerSample;
+    ann["core:label"] = "burst";
+    ann["bladerf:peak_dbfs"] = (float)peakDbfs;
+    meta["annotations"] = json::array();
+    meta["annotations"].push_back(ann);
+
+    std::ofstream file(path + ".sigmf-meta");
+    if (!file.is_open()) {
+        spdlog::error("Could not write {0}.sigmf-meta", path);
+        return;
+    }
+    file << meta.dump(4) << std::endl;
+}
@@ -0,0 +1,112 @@
+#pragma once
+#include <sample_convert.h>
+#include <config.h>
+#include <atomic>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <thread>
+
+// Power triggered capture of raw sample blocks, including what came before the trigger.
+//
+// The RX thread keeps copying its blocks into a circular arena holding the pre-trigger
+// window plus some headroom. The conversion thread hands over the IqStats it gathers
+// anyway; each block's power is compared against the threshold, and once it rises above
+// it a writer thread starts streaming the arena to disk from preSeconds before that
+// block. The burst ends postSeconds after the power has dropped hysteresisDb below the
+// threshold. Neither RX side call ever waits: when the disk falls a whole arena behind,
+// the writer skips to the oldest data still held and starts a new capture segment.
+//
+// Each burst becomes its own SigMF recording, <base>-<n>.sigmf-data / .sigmf-meta, with
+// an annotation covering the part above the threshold. In the decoupled pipeline the
+// power of a block is known only once it has left the ring, so feed() is told where the
+// block was written and the trigger is placed there; the decision itself comes late by up
+// to the ring's fill, which the arena's headroom covers.
+class BurstCapture {
+public:
+    struct Settings {
+        double thresholdDbfs = -30.0;
+        double hysteresisDb = 6.0;
+        double preSeconds = 1.0;
+        double postSeconds = 0.5;
+    };
+
+    struct Info {
+        std::string datatype;       // SigMF type, "ci16_le" or "ci8"
+        double sampleRate;
+        double frequency;
+        json hardware;              // Stored under "bladerf:" in the global object
+    };
+
+    ~BurstCapture();
+
+    // arena must hold at least arenaBytes(...) bytes and outlive the capture
+    bool start(const std::string& basePath, const Info& info, int sampleBytes, const Settings& settings, uint8_t* arena, size_t arenaBytes);
+    void stop();
+    bool isRunning() { return enabled; }
+
+    static size_t arenaBytes(double sampleRate, int sampleBytes, double preSeconds);
+
+    // RX thread, count is in samples. Returns the arena position just past the block, for feed()
+    uint64_t write(const void* data, int count);
+    // Conversion thread, moments of the raw samples of a block and what write() returned for it
+    void feed(const convert::IqStats& stats, uint64_t blockEnd);
+
+    // Any thread, takes effect with the next block
+    void setFrequency(double freq) { frequency = freq; }
+
+    bool triggered() { return state != STATE_ARMED; }
+    float levelDbfs() { return level; }
+    uint64_t bursts() { return burstCount; }
+    uint64_t missed() { return missedCount; }
+    uint64_t lostBytes() { return lostCount; }
+
+    static double powerDbfs(const convert::IqStats& stats);
+
+private:
+    enum State {
+        STATE_ARMED,
+        STATE_ABOVE,    // Power above the release level
+        STATE_POST      // Below it, waiting out the post-trigger time
+    };
+
+    static void writer(BurstCapture* _this);
+    void writeBurst();
+    bool overwritten(uint64_t pos);
+    void writeMeta(const std::string& path, const json& captures, uint64_t triggerSample, uint64_t endSample);
+
+    uint8_t* arena = NULL;
+    size_t capacity = 0;
+    std::atomic<uint64_t> head = 0;         // Bytes written so far
+    std::atomic<uint64_t> writeStart = 0;   // End of the block being copied in
+
+    std::thread writerThread;
+    std::atomic<bool> enabled = false;
+    std::atomic<bool> producerActive = false;  // In write()
+    std::atomic<bool> feederActive = false;    // In feed(), another thread in the decoupled pipeline
+
+    std::string basePath;
+    Info info;
+    Settings settings;
+    int sampleBytes = 4;
+    std::atomic<double> frequency = 0.0;
+
+    // Conversion side trigger state
+    State state = STATE_ARMED;
+    uint64_t releasePos = 0;
+
+    // Handed from the trigger to the writer
+    std::atomic<bool> flushing = false;
+    std::atomic<uint64_t> flushFrom = 0;
+    std::atomic<uint64_t> triggerPos = 0;
+    std::atomic<uint64_t> aboveEnd = 0;     // Where the power last dropped below the release level
+    std::atomic<uint64_t> flushEnd = UINT64_MAX;
+    std::atomic<float> peakDbfs = -100.0f;
+    double triggerFreq = 0.0;
+    time_t triggerTime = 0;
+
+    std::atomic<float> level = -100.0f;
+    std::atomic<uint64_t> burstCount = 0;
+    std::atomic<uint64_t> missedCount = 0;
+    std::atomic<uint64_t> lostCount = 0;
+};
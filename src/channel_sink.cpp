@@ -0,0 +1,57 @@
+#include <channel_sink.h>
+#include <spdlog/spdlog.h>
+
+ChannelFileSink::~ChannelFileSink() {
+    stop();
+}
+
+bool ChannelFileSink::start(const std::string& path, int blockSize, int depth) {
+    if (running) { return true; }
+    file = fopen(path.c_str(), "wb");
+    if (file == NULL) {
+        spdlog::error("Could not open {0} for writing", path);
+        return false;
+    }
+    ring.init(depth, blockSize);
+    written = 0;
+    running = true;
+    writerThread = std::thread(writer, this);
+    return true;
+}
+
+void ChannelFileSink::stop() {
+    if (!running) { return; }
+    running = false;
+    ring.stop();
+    writerThread.join();
+    fclose(file);
+    file = NULL;
+}
+
+dsp::complex_t* ChannelFileSink::writeSlot() {
+    if (!running) { return NULL; }
+    return ring.writeSlot();
+}
+
+void ChannelFileSink::commit(int count) {
+    ring.commitWrite(count);
+}
+
+void ChannelFileSink::drop() {
+    ring.drop();
+}
+
+void ChannelFileSink::writer(ChannelFileSink* _this) {
+    int count;
+    while (true) {
+        dsp::complex_t* block = _this->ring.readSlot(count);
+        if (block == NULL) { break; }
+        size_t n = fwrite(block, sizeof(dsp::complex_t), count, _this->file);
+        _this->ring.commitRead();
+        _this->written += n * sizeof(dsp::complex_t);
+        if (n != (size_t)count) {
+            spdlog::error("Channel sink write failed, stopping");
+            break;
+        }
+    }
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <dsp/types.h>
+#include <spsc_ring.h>
+#include <stdio.h>
+#include <string>
+#include <thread>
+
+// Writes one channel of complex float32 samples to a file from its own thread.
+// The RX path fills ring slots directly and never waits: when the writer can't
+// keep up the block is dropped and counted instead.
+class ChannelFileSink {
+public:
+    ~ChannelFileSink();
+
+    bool start(const std::string& path, int blockSize, int depth);
+    void stop();
+    bool isRunning() { return running; }
+
+    // Returns NULL when not running or full, the caller then converts into scratch and calls drop()
+    dsp::complex_t* writeSlot();
+    void commit(int count);
+    void drop();
+
+    uint64_t dropped() { return ring.dropped; }
+    uint64_t bytesWritten() { return written; }
+
+private:
+    static void writer(ChannelFileSink* _this);
+
+    SPSCBlockRing<dsp::complex_t> ring;
+    FILE* file = NULL;
+    std::thread writerThread;
+    bool running = false;
+    std::atomic<uint64_t> written = 0;
+};
@@ -0,0 +1,118 @@
+#include <decimator.h>
+#include <algorithm>
+#include <string.h>
+#include <math.h>
+#include <stdlib.h>
+
+// Prototype length per unit of max(interp, decim), sets the transition band width
+#define DECIMATOR_TAPS_PER_RATIO    24
+// Cutoff as a fraction of the output Nyquist frequency
+#define DECIMATOR_PASSBAND          0.9
+
+// Q11 samples times Q15 taps
+#define DECIMATOR_SCALE     (1.0f / (4096.0f * 32768.0f))
+
+void Decimator::init(int interp, int decim, int maxBlock) {
+    _interp = std::max<int>(interp, 1);
+    _decim = std::max<int>(decim, 1);
+    _maxBlock = maxBlock;
+    fir = convert::firInt16x2Kernel();
+
+    // Branches are padded to a multiple of 16 taps so the SIMD kernels never hit their scalar tail
+    int ratio = std::max<int>(_interp, _decim);
+    int protoLen = DECIMATOR_TAPS_PER_RATIO * ratio;
+    _tapsPerPhase = (((protoLen + _interp - 1) / _interp) + 15) / 16 * 16;
+    int len = _tapsPerPhase * _interp;
+
+    // Windowed sinc at the upsampled rate, Blackman window
+    std::vector<double> proto(len);
+    double fc = DECIMATOR_PASSBAND * 0.5 / (double)ratio;
+    double center = (double)(len - 1) / 2.0;
+    double sum = 0;
+    for (int n = 0; n < len; n++) {
+        double x = (double)n - center;
+        double sinc = (x == 0.0) ? 2.0 * fc : sin(2.0 * M_PI * fc * x) / (M_PI * x);
+        double w = 0.42 - 0.5 * cos(2.0 * M_PI * n / (len - 1)) + 0.08 * cos(4.0 * M_PI * n / (len - 1));
+        proto[n] = sinc * w;
+        sum += proto[n];
+    }
+
+    // Unity gain at DC per branch, the zero stuffing of the interpolation takes away a factor interp
+    taps.assign(len, 0);
+    for (int p = 0; p < _interp; p++) {
+        for (int m = 0; m < _tapsPerPhase; m++) {
+            double h = proto[p + (m * _interp)] * (double)_interp / sum;
+            taps[(p * _tapsPerPhase) + (_tapsPerPhase - 1 - m)] = (int16_t)std::clamp<double>(round(h * 32768.0), -32768, 32767);
+        }
+    }
+
+    histFirst.assign(_tapsPerPhase - 1 + maxBlock, 0);
+    histSecond.assign(_tapsPerPhase - 1 + maxBlock, 0);
+    phase = 0;
+}
+
+void Decimator::reset() {
+    std::fill(histFirst.begin(), histFirst.end(), 0);
+    std::fill(histSecond.begin(), histSecond.end(), 0);
+    phase = 0;
+}
+
+int Decimator::process(const int16_t* in, dsp::complex_t* out, int count, convert::IqStats* stats) {
+    int16_t* first = &histFirst[_tapsPerPhase - 1];
+    int16_t* second = &histSecond[_tapsPerPhase - 1];
+    for (int i = 0; i < count; i++) {
+        first[i] = in[i * 2];
+        second[i] = in[(i * 2) + 1];
+    }
+    return run(out, count, stats);
+}
+
+// Q7 is widened to Q11 on the way into the history so both formats share the taps and scale
+int Decimator::process(const int8_t* in, dsp::complex_t* out, int count, convert::IqStats* stats) {
+    int16_t* first = &histFirst[_tapsPerPhase - 1];
+    int16_t* second = &histSecond[_tapsPerPhase - 1];
+    for (int i = 0; i < count; i++) {
+        first[i] = (int16_t)in[i * 2] * 16;
+        second[i] = (int16_t)in[(i * 2) + 1] * 16;
+    }
+    return run(out, count, stats);
+}
+
+int Decimator::run(dsp::complex_t* out, int count, convert::IqStats* stats) {
+    if (stats != NULL) {
+        // The rails are in cache right after being split, q is the first word as everywhere else
+        const int16_t* q = &histFirst[_tapsPerPhase - 1];
+        const int16_t* i = &histSecond[_tapsPerPhase - 1];
+        convert::IqStats st;
+        for (int k = 0; k < count; k++) {
+            st.sumI += i[k];
+            st.sumQ += q[k];
+            st.sumII += (int32_t)i[k] * i[k];
+            st.sumQQ += (int32_t)q[k] * q[k];
+            st.sumIQ += (int32_t)i[k] * q[k];
+            st.peak = std::max<int32_t>(st.peak, std::max<int32_t>(abs(i[k]), abs(q[k])));
+        }
+        st.count = count;
+        stats->add(st);
+    }
+
+    int n = 0;
+    int64_t limit = (int64_t)count * _interp;
+    while (phase < limit) {
+        int64_t base = phase / _interp;
+        int branch = phase % _interp;
+        int32_t acc0, acc1;
+        fir(&taps[branch * _tapsPerPhase], &histFirst[base], &histSecond[base], _tapsPerPhase, &acc0, &acc1);
+        // First word to .q, second to .i, like the conversion kernels
+        out[n].q = (float)acc0 * DECIMATOR_SCALE;
+        out[n].i = (float)acc1 * DECIMATOR_SCALE;
+        n++;
+        phase += _decim;
+    }
+    phase -= limit;
+
+    // Keep the tail of this block as history for the next one
+    memmove(histFirst.data(), &histFirst[count], (_tapsPerPhase - 1) * sizeof(int16_t));
+    memmove(histSecond.data(), &histSecond[count], (_tapsPerPhase - 1) * sizeof(int16_t));
+    return n;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <sample_convert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// Rational polyphase resampler (output rate = input rate * interp / decim) fused with
+// the SC16_Q11 / SC8_Q7 conversion. Raw samples are split into int16 I and Q rails
+// while being appended to the filter history, each output sample is then one SIMD
+// int16 dot product per rail over the taps of a single polyphase branch, so only the
+// outputs that are kept get computed and the float samples are written once.
+// Output scaling and I/Q ordering match the plain conversion kernels.
+class Decimator {
+public:
+    // maxBlock is the largest input block process() will be given
+    void init(int interp, int decim, int maxBlock);
+    void reset();
+
+    bool isEnabled() { return _decim > 1 || _interp > 1; }
+    int interp() { return _interp; }
+    int decim() { return _decim; }
+    int tapsPerPhase() { return _tapsPerPhase; }
+
+    // Number of output samples for count input samples, ignoring the fractional phase
+    uint64_t outputCount(uint64_t count) { return count * _interp / _decim; }
+
+    // Returns the number of samples written to out. When stats is given the moments of
+    // the input are added to it, gathered while splitting the rails.
+    int process(const int16_t* in, dsp::complex_t* out, int count, convert::IqStats* stats = NULL);
+    int process(const int8_t* in, dsp::complex_t* out, int count, convert::IqStats* stats = NULL);
+
+private:
+    int run(dsp::complex_t* out, int count, convert::IqStats* stats);
+
+    int _interp = 1;
+    int _decim = 1;
+    int _tapsPerPhase = 0;
+    int _maxBlock = 0;
+
+    // _interp branches of _tapsPerPhase taps, each stored reversed so the dot product walks forward
+    std::vector<int16_t> taps;
+    // Last _tapsPerPhase - 1 input samples followed by the current block
+    std::vector<int16_t> histFirst;
+    std::vector<int16_t> histSecond;
+    // Position of the next output in the upsampled domain, relative to the current block
+    int64_t phase = 0;
+
+    convert::firInt16x2Kernel_t fir = NULL;
+};
@@ -0,0 +1,65 @@
+#include <device_caps.h>
+
+bool DeviceCaps::operator==(const DeviceCaps& b) const {
+    return sampleRateMin == b.sampleRateMin && sampleRateMax == b.sampleRateMax &&
+           bandwidthMin == b.bandwidthMin && bandwidthMax == b.bandwidthMax &&
+           fpgaSize == b.fpgaSize && boardName == b.boardName;
+}
+
+namespace devcaps {
+    int probe(BladeRFDevice* dev, bladerf_channel ch, DeviceCaps& caps) {
+        const struct bladerf_range* range;
+        int status = dev->getSampleRateRange(ch, &range);
+        if (status != 0) { return status; }
+        caps.sampleRateMin = range->min;
+        caps.sampleRateMax = range->max;
+
+        status = dev->getBandwidthRange(ch, &range);
+        if (status != 0) { return status; }
+        caps.bandwidthMin = range->min;
+        caps.bandwidthMax = range->max;
+
+        // Not fatal, the FPGA size is informative only
+        bladerf_fpga_size size = BLADERF_FPGA_UNKNOWN;
+        dev->getFpgaSize(&size);
+        caps.fpgaSize = size;
+        caps.boardName = dev->boardName();
+        return 0;
+    }
+
+    int probe(const std::string& serial, bladerf_channel ch, DeviceCaps& caps) {
+        BladeRFDevice* dev = bladerfdev::create(serial);
+        int status = dev->open(serial);
+        if (status == 0) {
+            status = probe(dev, ch, caps);
+        }
+        delete dev;
+        return status;
+    }
+
+    json toJson(const DeviceCaps& caps) {
+        json j = json({});
+        j["sampleRateMin"] = caps.sampleRateMin;
+        j["sampleRateMax"] = caps.sampleRateMax;
+        j["bandwidthMin"] = caps.bandwidthMin;
+        j["bandwidthMax"] = caps.bandwidthMax;
+        j["fpgaSize"] = caps.fpgaSize;
+        j["boardName"] = caps.boardName;
+        return j;
+    }
+
+    bool fromJson(const json& j, DeviceCaps& caps) {
+        const char* keys[] = { "sampleRateMin", "sampleRateMax", "bandwidthMin", "bandwidthMax", "fpgaSize", "boardName" };
+        for (const char* key : keys) {
+            if (!j.contains(key)) { return false; }
+        }
+        caps.sampleRateMin = j["sampleRateMin"];
+        caps.sampleRateMax = j["sampleRateMax"];
+        caps.bandwidthMin = j["bandwidthMin"];
+        caps.bandwidthMax = j["bandwidthMax"];
+        caps.fpgaSize = j["fpgaSize"];
+        caps.boardName = j["boardName"].get<std::string>();
+        // Guard against a hand edited entry making the list loops divide by zero
+        return caps.sampleRateMin > 0 && caps.bandwidthMin > 0;
+    }
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <bladerf_device.h>
+#include <config.h>
+#include <stdint.h>
+#include <string>
+
+// What the module needs to know about a board to build its menus. Kept per
+// serial in the config so selecting a device doesn't have to open it; start()
+// checks the cached copy against the hardware once the board is open anyway.
+struct DeviceCaps {
+    int64_t sampleRateMin   = 160000;      // bladeRF x40/x115 until the board says otherwise
+    int64_t sampleRateMax   = 40000000;
+    int64_t bandwidthMin    = 1500000;
+    int64_t bandwidthMax    = 28000000;
+    int fpgaSize            = BLADERF_FPGA_UNKNOWN;
+    std::string boardName   = "";
+
+    bool operator==(const DeviceCaps& b) const;
+    bool operator!=(const DeviceCaps& b) const { return !(*this == b); }
+};
+
+namespace devcaps {
+    // Query an open device
+    int probe(BladeRFDevice* dev, bladerf_channel ch, DeviceCaps& caps);
+
+    // Open the device just long enough to probe it
+    int probe(const std::string& serial, bladerf_channel ch, DeviceCaps& caps);
+
+    json toJson(const DeviceCaps& caps);
+
+    // Returns false when the entry is missing fields, i.e. written by an older version
+    bool fromJson(const json& j, DeviceCaps& caps);
+}
@@ -0,0 +1,171 @@
+#include <fpga_loader.h>
+#include <bladerf_device.h>
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <stdio.h>
+
+#define HASH_CHUNK  (1024 * 1024)
+
+FpgaLoader::~FpgaLoader() {
+    if (workerThread.joinable()) { workerThread.join(); }
+}
+
+void FpgaLoader::start(const std::string& serial, const std::string& path, const Record& previous) {
+    if (running) { return; }
+    if (workerThread.joinable()) { workerThread.join(); }
+    {
+        std::lock_guard<std::mutex> lck(mtx);
+        _serial = serial;
+        this->path = path;
+        this->previous = previous;
+        result = Record();
+        collected = false;
+    }
+    hashProgress = 0.0f;
+    _state = FPGA_LOADER_HASHING;
+    running = true;
+    workerThread = std::thread(&FpgaLoader::worker, this);
+}
+
+const char* FpgaLoader::stateText() {
+    switch (state()) {
+        case FPGA_LOADER_HASHING:   return "Hashing bitstream";
+        case FPGA_LOADER_CHECKING:  return "Checking board";
+        case FPGA_LOADER_LOADING:   return "Loading FPGA";
+        case FPGA_LOADER_DONE:      return "FPGA loaded";
+        case FPGA_LOADER_SKIPPED:   return "FPGA already up to date";
+        case FPGA_LOADER_FAILED:    return "FPGA load failed";
+        default:                    return "";
+    }
+}
+
+std::string FpgaLoader::serial() {
+    std::lock_guard<std::mutex> lck(mtx);
+    return _serial;
+}
+
+float FpgaLoader::progress() {
+    switch (state()) {
+        case FPGA_LOADER_HASHING:
+            return 0.1f * hashProgress;
+        case FPGA_LOADER_CHECKING:
+            return 0.1f;
+        case FPGA_LOADER_LOADING: {
+            std::lock_guard<std::mutex> lck(mtx);
+            // Without history assume the typical few seconds of a USB 3 load
+            double expectedMs = (previous.loadMs > 0) ? previous.loadMs : 5000.0;
+            double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - loadStart).count();
+            return 0.1f + 0.85f * (float)std::min<double>(elapsedMs / expectedMs, 1.0);
+        }
+        case FPGA_LOADER_DONE:
+        case FPGA_LOADER_SKIPPED:
+            return 1.0f;
+        default:
+            return 0.0f;
+    }
+}
+
+bool FpgaLoader::collect(std::string& serial, Record& record, State& state) {
+    if (running) { return false; }
+    std::lock_guard<std::mutex> lck(mtx);
+    if (collected) { return false; }
+    collected = true;
+    serial = _serial;
+    record = result;
+    state = this->state();
+    return true;
+}
+
+// 64 bit FNV-1a over the whole file, only used to tell images apart
+bool FpgaLoader::hashFile(std::string& hash) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == NULL) { return false; }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    uint64_t h = 0xcbf29ce484222325ULL;
+    uint8_t* buf = new uint8_t[HASH_CHUNK];
+    long done = 0;
+    size_t n;
+    while ((n = fread(buf, 1, HASH_CHUNK, file)) > 0) {
+        for (size_t i = 0; i < n; i++) {
+            h = (h ^ buf[i]) * 0x100000001b3ULL;
+        }
+        done += n;
+        hashProgress = (size > 0) ? (float)done / (float)size : 1.0f;
+    }
+    delete[] buf;
+    fclose(file);
+
+    char str[17];
+    sprintf(str, "%016llx", (unsigned long long)h);
+    hash = str;
+    return true;
+}
+
+void FpgaLoader::worker() {
+    std::string hash;
+    if (!hashFile(hash)) {
+        spdlog::error("Could not read bitstream {0}", path);
+        _state = FPGA_LOADER_FAILED;
+        running = false;
+        return;
+    }
+
+    _state = FPGA_LOADER_CHECKING;
+    BladeRFDevice* dev = bladerfdev::create(_serial);
+    int status = dev->open(_serial);
+    if (status != 0) {
+        spdlog::error("Could not open bladeRF {0} to load its FPGA", _serial);
+        spdlog::error(bladerf_strerror(status));
+        delete dev;
+        _state = FPGA_LOADER_FAILED;
+        running = false;
+        return;
+    }
+
+    // Same image as last time and the board still reports the version it had then
+    std::string version;
+    bool configured = (dev->isFpgaConfigured() == 1);
+    if (configured) { dev->fpgaVersion(version); }
+    if (configured && hash == previous.hash && version == previous.version) {
+        spdlog::info("bladeRF {0} already runs {1}, not reloading", _serial, path);
+        {
+            std::lock_guard<std::mutex> lck(mtx);
+            result = previous;
+        }
+        delete dev;
+        _state = FPGA_LOADER_SKIPPED;
+        running = false;
+        return;
+    }
+
+    spdlog::info("Loading bitstream: {0}", path);
+    {
+        std::lock_guard<std::mutex> lck(mtx);
+        loadStart = std::chrono::steady_clock::now();
+    }
+    _state = FPGA_LOADER_LOADING;
+    status = dev->loadFpga(path.c_str());
+    if (status != 0) {
+        spdlog::error("Error loading bitstream - bladeRF {0}", _serial);
+        spdlog::error(bladerf_strerror(status));
+        delete dev;
+        _state = FPGA_LOADER_FAILED;
+        running = false;
+        return;
+    }
+
+    dev->fpgaVersion(version);
+    {
+        std::lock_guard<std::mutex> lck(mtx);
+        result.hash = hash;
+        result.version = version;
+        result.loadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - loadStart).count();
+        spdlog::info("bladeRF {0}: FPGA {1} loaded in {2:.0f} ms", _serial, version, result.loadMs);
+    }
+    delete dev;
+    _state = FPGA_LOADER_DONE;
+    running = false;
+}
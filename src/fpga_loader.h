@@ -0,0 +1,67 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <thread>
+
+// Loads an FPGA bitstream from a background thread, on its own device handle,
+// so the UI never waits on the several seconds bladerf_load_fpga takes.
+// The image is identified by a hash of its contents: when the board is already
+// configured with the same image (same hash and same reported FPGA version as
+// the last load), loading is skipped entirely.
+class FpgaLoader {
+public:
+    // What is remembered per serial about the last image loaded
+    struct Record {
+        std::string hash = "";
+        std::string version = "";
+        double loadMs = 0;
+    };
+
+    enum State {
+        FPGA_LOADER_IDLE,
+        FPGA_LOADER_HASHING,
+        FPGA_LOADER_CHECKING,
+        FPGA_LOADER_LOADING,
+        FPGA_LOADER_DONE,
+        FPGA_LOADER_SKIPPED,
+        FPGA_LOADER_FAILED
+    };
+
+    ~FpgaLoader();
+
+    // Nothing happens if a load is already in progress. The module must not hold
+    // a handle on the board until the loader is done.
+    void start(const std::string& serial, const std::string& path, const Record& previous);
+
+    bool busy() { return running; }
+    State state() { return (State)_state.load(); }
+    const char* stateText();
+    std::string serial();
+
+    // 0..1. Loading progress is estimated from how long the previous load took,
+    // libbladeRF doesn't report any.
+    float progress();
+
+    // Hand out the outcome once the loader is done, false until then or if already taken
+    bool collect(std::string& serial, Record& record, State& state);
+
+private:
+    void worker();
+    bool hashFile(std::string& hash);
+
+    std::thread workerThread;
+    std::mutex mtx;
+    std::atomic<bool> running = false;
+    std::atomic<int> _state = FPGA_LOADER_IDLE;
+    std::atomic<float> hashProgress = 0.0f;
+    bool collected = true;
+
+    std::string _serial;
+    std::string path;
+    Record previous;
+    Record result;
+    std::chrono::steady_clock::time_point loadStart;
+};
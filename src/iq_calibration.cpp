@@ -0,0 +1,223 @@
+#include <iq_calibration.h>
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <string>
+#include <math.h>
+
+#define IQ_CAL_BAND_HZ          5e6     // Width of the bands coefficients are cached for
+#define IQ_CAL_SMOOTHING        0.25    // Weight of a new estimate in software only mode
+#define IQ_CAL_SETTLE_WINDOWS   1       // Windows thrown away after a retune or a hardware change
+#define IQ_CAL_MIN_VARIANCE     1e-9    // Below this there is no signal to estimate from
+
+static const bladerf_correction hwAxes[4] = { BLADERF_CORR_DCOFF_I, BLADERF_CORR_DCOFF_Q, BLADERF_CORR_PHASE, BLADERF_CORR_GAIN };
+static const int hwLimits[4] = { 2048, 2048, 4096, 4096 };
+
+void IqCalibrator::load(const json& j) {
+    cache.clear();
+    for (auto& item : j.items()) {
+        const json& e = item.value();
+        if (!e.contains("dcI") || !e.contains("dcQ") || !e.contains("gain") || !e.contains("phase")) { continue; }
+        Entry entry;
+        entry.soft.dcI = e["dcI"];
+        entry.soft.dcQ = e["dcQ"];
+        entry.soft.gain = e["gain"];
+        entry.soft.phase = e["phase"];
+        if (e.contains("hw") && e["hw"].size() == 4) {
+            for (int i = 0; i < 4; i++) { entry.hw[i] = e["hw"][i]; }
+            entry.hwValid = true;
+        }
+        cache[std::stoll(item.key())] = entry;
+    }
+    bands = cache.size();
+}
+
+json IqCalibrator::save() {
+    json j = json({});
+    for (auto& [key, entry] : cache) {
+        json e;
+        e["dcI"] = entry.soft.dcI;
+        e["dcQ"] = entry.soft.dcQ;
+        e["gain"] = entry.soft.gain;
+        e["phase"] = entry.soft.phase;
+        if (entry.hwValid) {
+            for (int i = 0; i < 4; i++) { e["hw"].push_back(entry.hw[i]); }
+        }
+        j[std::to_string(key)] = e;
+    }
+    return j;
+}
+
+void IqCalibrator::clear() {
+    cache.clear();
+    bands = 0;
+    soft = convert::IqCorrection();
+    publish(soft);
+}
+
+void IqCalibrator::begin(BladeRFDevice* dev, bladerf_channel ch, double freq, bool hardware, uint64_t windowSamples) {
+    this->dev = dev;
+    channel = ch;
+    this->hardware = hardware;
+    window = std::max<uint64_t>(windowSamples, 1);
+    acc = convert::IqStats();
+    ready = false;
+    for (int i = 0; i < 4; i++) { axes[i] = Axis(); }
+    // Start from the band's cache entry, otherwise from whatever was in use last
+    band = -1;
+    retune(freq);
+}
+
+void IqCalibrator::end() {
+    dev = NULL;
+}
+
+convert::IqCorrection IqCalibrator::correction() {
+    convert::IqCorrection corr;
+    uint32_t s1, s2;
+    do {
+        s1 = seq.load(std::memory_order_acquire);
+        corr = published;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        s2 = seq.load(std::memory_order_relaxed);
+    } while (s1 != s2 || (s1 & 1));
+    return corr;
+}
+
+void IqCalibrator::publish(const convert::IqCorrection& corr) {
+    uint32_t s = seq.load(std::memory_order_relaxed);
+    seq.store(s + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    published = corr;
+    seq.store(s + 2, std::memory_order_release);
+}
+
+// Never blocks, a window completed while the previous one is still unclaimed is dropped
+void IqCalibrator::feed(const convert::IqStats& stats) {
+    acc.add(stats);
+    if (acc.count < window) { return; }
+    if (!ready.load(std::memory_order_acquire)) {
+        pending = acc;
+        ready.store(true, std::memory_order_release);
+    }
+    acc = convert::IqStats();
+}
+
+void IqCalibrator::retune(double freq) {
+    int64_t newBand = llround(freq / IQ_CAL_BAND_HZ);
+    if (newBand == band) { return; }
+    band = newBand;
+
+    // Whatever is waiting or accumulating belongs, at least in part, to the old frequency
+    ready.store(false, std::memory_order_release);
+    skip = IQ_CAL_SETTLE_WINDOWS;
+
+    auto it = cache.find(band);
+    if (it == cache.end()) { return; }
+    soft = it->second.soft;
+    publish(soft);
+    if (hardware && it->second.hwValid) {
+        for (int i = 0; i < 4; i++) {
+            axes[i] = Axis();
+            axes[i].value = it->second.hw[i];
+        }
+        pushHardware();
+    }
+}
+
+void IqCalibrator::service() {
+    if (!ready.load(std::memory_order_acquire)) { return; }
+    convert::IqStats stats = pending;
+    ready.store(false, std::memory_order_release);
+    if (skip > 0) {
+        skip--;
+        return;
+    }
+
+    convert::IqCorrection est;
+    if (!estimate(stats, est)) { return; }
+
+    // In hardware mode each window is measured fresh since the raw signal changes with every step
+    double a = hardware ? 1.0 : IQ_CAL_SMOOTHING;
+    soft.dcI += a * (est.dcI - soft.dcI);
+    soft.dcQ += a * (est.dcQ - soft.dcQ);
+    soft.gain += a * (est.gain - soft.gain);
+    soft.phase += a * (est.phase - soft.phase);
+    publish(soft);
+
+    if (hardware) { stepHardware(est); }
+
+    Entry& entry = cache[band];
+    entry.soft = soft;
+    if (hardware) {
+        for (int i = 0; i < 4; i++) { entry.hw[i] = axes[i].value; }
+        entry.hwValid = true;
+    }
+    bands = cache.size();
+}
+
+// Choose q' = gain * q + phase * i so that q' has the power of i and no correlation with it
+bool IqCalibrator::estimate(const convert::IqStats& stats, convert::IqCorrection& corr) {
+    if (stats.count == 0) { return false; }
+    double n = (double)stats.count;
+    double s = 1.0 / 4096.0;
+    double mI = stats.sumI * s / n;
+    double mQ = stats.sumQ * s / n;
+    double vI = (stats.sumII * s * s / n) - (mI * mI);
+    double vQ = (stats.sumQQ * s * s / n) - (mQ * mQ);
+    double c = (stats.sumIQ * s * s / n) - (mI * mQ);
+    if (vI < IQ_CAL_MIN_VARIANCE || vQ < IQ_CAL_MIN_VARIANCE) { return false; }
+    double orth = vQ - (c * c / vI);
+    if (orth < IQ_CAL_MIN_VARIANCE) { return false; }
+
+    corr.dcI = mI;
+    corr.dcQ = mQ;
+    corr.gain = sqrt(vI / orth);
+    corr.phase = -corr.gain * c / vI;
+    return true;
+}
+
+// Residuals are what software still has to correct, in the units of each register:
+// DC in Q11 counts, gain as the deviation from 1, phase as the cross term
+void IqCalibrator::stepHardware(const convert::IqCorrection& corr) {
+    double residuals[4] = { corr.dcI * 4096.0, corr.dcQ * 4096.0, corr.phase, corr.gain - 1.0 };
+    // Nominal response per register step: 1 count, 10 degrees / 4096, 1.0 / 4096
+    double slopes[4] = { -1.0, -1.0, -(10.0 * M_PI / 180.0) / 4096.0, -1.0 / 4096.0 };
+    double deadbands[4] = { 1.0, 1.0, 1e-3, 1e-3 };
+
+    bool changed = false;
+    for (int i = 0; i < 4; i++) {
+        int prev = axes[i].value;
+        stepAxis(axes[i], residuals[i], slopes[i], deadbands[i], hwLimits[i]);
+        changed |= (axes[i].value != prev);
+    }
+    if (!changed) { return; }
+    pushHardware();
+    skip = IQ_CAL_SETTLE_WINDOWS;
+}
+
+int IqCalibrator::stepAxis(Axis& axis, double residual, double nominalSlope, double deadband, int limit) {
+    if (fabs(residual) < deadband) { return axis.value; }
+    double slope = nominalSlope;
+    if (axis.havePrev && axis.value != axis.prevValue) {
+        // The measured slope wins when it's plausible, its sign included
+        double measured = (residual - axis.prevResidual) / (double)(axis.value - axis.prevValue);
+        if (fabs(measured) > fabs(nominalSlope) * 0.1 && fabs(measured) < fabs(nominalSlope) * 10.0) { slope = measured; }
+    }
+    axis.prevValue = axis.value;
+    axis.prevResidual = residual;
+    axis.havePrev = true;
+    axis.value = std::clamp<long>(lround(axis.value - (residual / slope)), -limit, limit);
+    return axis.value;
+}
+
+void IqCalibrator::pushHardware() {
+    if (dev == NULL) { return; }
+    for (int i = 0; i < 4; i++) {
+        int status = dev->setCorrection(channel, hwAxes[i], (bladerf_correction_value)axes[i].value);
+        if (status != 0) {
+            spdlog::warn("Hardware IQ correction not available ({0}), correcting in software only", bladerf_strerror(status));
+            hardware = false;
+            return;
+        }
+    }
+}
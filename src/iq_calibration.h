@@ -0,0 +1,81 @@
+#pragma once
+#include <bladerf_device.h>
+#include <sample_convert.h>
+#include <config.h>
+#include <atomic>
+#include <map>
+#include <stdint.h>
+
+// Blind DC offset / IQ imbalance estimation for the corrected conversion kernels.
+//
+// The RX thread gathers IqStats while converting and hands a window of them over
+// without locking; the control thread (the retune thread) turns them into a new
+// IqCorrection, which the RX thread picks up through a sequence lock on its next
+// block. Results are cached per frequency band, so a retune to a band seen before
+// starts out corrected. Optionally the estimate is also pushed into the FPGA with
+// bladerf_set_correction, converging by secant steps since the scale and sign of
+// the hardware registers differ between boards; software then only removes what
+// the hardware left.
+class IqCalibrator {
+public:
+    struct Entry {
+        convert::IqCorrection soft;
+        int16_t hw[4] = { 0, 0, 0, 0 };     // DCOFF_I, DCOFF_Q, PHASE, GAIN
+        bool hwValid = false;
+    };
+
+    // Cache as stored per serial in the config
+    void load(const json& j);
+    json save();
+    void clear();
+    int bandCount() { return bands; }
+
+    // Before RX starts, windowSamples go into each estimate
+    void begin(BladeRFDevice* dev, bladerf_channel ch, double freq, bool hardware, uint64_t windowSamples);
+    void end();
+
+    // RX thread
+    convert::IqCorrection correction();
+    void feed(const convert::IqStats& stats);
+
+    // Control thread
+    void retune(double freq);
+    void service();
+
+    bool hardwareActive() { return hardware; }
+
+private:
+    struct Axis {
+        int value = 0;
+        int prevValue = 0;
+        double prevResidual = 0;
+        bool havePrev = false;
+    };
+
+    void publish(const convert::IqCorrection& corr);
+    bool estimate(const convert::IqStats& stats, convert::IqCorrection& corr);
+    void stepHardware(const convert::IqCorrection& corr);
+    void pushHardware();
+    int stepAxis(Axis& axis, double residual, double nominalSlope, double deadband, int limit);
+
+    std::map<int64_t, Entry> cache;
+    std::atomic<int> bands = 0;
+
+    BladeRFDevice* dev = NULL;
+    bladerf_channel channel = BLADERF_CHANNEL_RX(0);
+    int64_t band = 0;
+    bool hardware = false;
+    Axis axes[4];
+    convert::IqCorrection soft;
+    int skip = 0;
+
+    // RX side window, handed over through pending once complete
+    uint64_t window = 0;
+    convert::IqStats acc;
+    convert::IqStats pending;
+    std::atomic<bool> ready = false;
+
+    // Sequence lock around the correction the RX thread applies
+    std::atomic<uint32_t> seq = 0;
+    convert::IqCorrection published;
+};
@@ -0,0 +1,574 @@
+#include <iq_server.h>
+#include <aligned_alloc.h>
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <chrono>
+#include <string.h>
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <netdb.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+#define IQ_SERVER_MAX_CLIENTS   32
+#define IQ_SERVER_MAX_IOV       16          // Blocks gathered into one TCP send
+#define IQ_SERVER_SNDBUF        (4 * 1024 * 1024)
+#define IQ_SERVER_MIN_DEPTH     8
+#define IQ_SERVER_MAX_DEPTH     1024
+#define IQ_SERVER_SLOT_ALIGN    64
+
+#ifdef _WIN32
+typedef WSABUF iovec_t;
+typedef WSAPOLLFD pollfd_t;
+#else
+typedef struct iovec iovec_t;
+typedef struct pollfd pollfd_t;
+#endif
+
+namespace {
+    void setIov(iovec_t& v, const void* ptr, size_t bytes) {
+#ifdef _WIN32
+        v.buf = (char*)ptr;
+        v.len = (ULONG)bytes;
+#else
+        v.iov_base = (void*)ptr;
+        v.iov_len = bytes;
+#endif
+    }
+
+    // Scatter-gather send, to addr when given (UDP). Returns the bytes sent or -1.
+    long sendVec(intptr_t fd, iovec_t* iov, int count, const void* addr, int addrLen, bool& wouldBlock) {
+#ifdef _WIN32
+        DWORD sent = 0;
+        int err = (addr != NULL) ? WSASendTo((SOCKET)fd, iov, count, &sent, 0, (const sockaddr*)addr, addrLen, NULL, NULL)
+                                 : WSASend((SOCKET)fd, iov, count, &sent, 0, NULL, NULL);
+        wouldBlock = (err != 0 && WSAGetLastError() == WSAEWOULDBLOCK);
+        return (err == 0) ? (long)sent : -1;
+#else
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_name = (void*)addr;
+        msg.msg_namelen = addrLen;
+        msg.msg_iov = iov;
+        msg.msg_iovlen = count;
+        ssize_t n = sendmsg((int)fd, &msg, MSG_NOSIGNAL);
+        wouldBlock = (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK));
+        return n;
+#endif
+    }
+
+    void setNonBlocking(intptr_t fd) {
+#ifdef _WIN32
+        u_long on = 1;
+        ioctlsocket((SOCKET)fd, FIONBIO, &on);
+#else
+        fcntl((int)fd, F_SETFL, fcntl((int)fd, F_GETFL) | O_NONBLOCK);
+#endif
+    }
+
+    void closeSocket(intptr_t fd) {
+        if (fd < 0) { return; }
+#ifdef _WIN32
+        closesocket((SOCKET)fd);
+#else
+        close((int)fd);
+#endif
+    }
+
+    int pollSockets(pollfd_t* fds, int count, int timeoutMs) {
+#ifdef _WIN32
+        return WSAPoll(fds, count, timeoutMs);
+#else
+        return poll(fds, count, timeoutMs);
+#endif
+    }
+
+    bool netInit() {
+#ifdef _WIN32
+        static bool done = false;
+        if (done) { return true; }
+        WSADATA wsa;
+        done = (WSAStartup(MAKEWORD(2, 2), &wsa) == 0);
+        return done;
+#else
+        return true;
+#endif
+    }
+
+    uint64_t nowMs() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+}
+
+IqServer::~IqServer() {
+    stop();
+    if (arena != NULL) { alignedFree(arena); }
+}
+
+bool IqServer::start(const std::string& host, int port, Protocol protocol, SlowPolicy policy) {
+    if (running) { return true; }
+    if (!netInit()) {
+        spdlog::error("IQ server: could not initialize networking");
+        return false;
+    }
+    this->protocol = protocol;
+    this->policy = policy;
+
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = (protocol == PROTOCOL_TCP) ? SOCK_STREAM : SOCK_DGRAM;
+    hints.ai_flags = AI_PASSIVE;
+    struct addrinfo* res = NULL;
+    std::string portStr = std::to_string(port);
+    if (getaddrinfo(host.empty() ? NULL : host.c_str(), portStr.c_str(), &hints, &res) != 0 || res == NULL) {
+        spdlog::error("IQ server: could not resolve {0}", host);
+        return false;
+    }
+    listenFd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+    int on = 1;
+    if (listenFd >= 0) { setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, (const char*)&on, sizeof(on)); }
+    bool ok = (listenFd >= 0 && bind(listenFd, res->ai_addr, res->ai_addrlen) == 0);
+    freeaddrinfo(res);
+    if (ok && protocol == PROTOCOL_TCP) { ok = (listen(listenFd, 8) == 0); }
+    if (!ok) {
+        spdlog::error("IQ server: could not listen on {0}:{1}", host, port);
+        closeSocket(listenFd);
+        listenFd = -1;
+        return false;
+    }
+    setNonBlocking(listenFd);
+    if (protocol == PROTOCOL_UDP) {
+        int buf = IQ_SERVER_SNDBUF;
+        setsockopt(listenFd, SOL_SOCKET, SO_SNDBUF, (const char*)&buf, sizeof(buf));
+    }
+
+    // The sender sleeps in poll(), a datagram to itself is the portable way to interrupt that
+    struct sockaddr_in loop;
+    memset(&loop, 0, sizeof(loop));
+    loop.sin_family = AF_INET;
+    loop.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    loop.sin_port = 0;
+    wakeFd = socket(AF_INET, SOCK_DGRAM, 0);
+    socklen_t len = sizeof(wakeAddr);
+    if (wakeFd < 0 || bind(wakeFd, (struct sockaddr*)&loop, sizeof(loop)) != 0 ||
+        getsockname(wakeFd, (struct sockaddr*)wakeAddr, &len) != 0) {
+        spdlog::error("IQ server: could not create wake-up socket");
+        closeSocket(wakeFd);
+        closeSocket(listenFd);
+        wakeFd = -1;
+        listenFd = -1;
+        return false;
+    }
+    wakeAddrLen = len;
+    setNonBlocking(wakeFd);
+
+    bytesSent = 0;
+    blocksSkipped = 0;
+    clientsDropped = 0;
+    running = true;
+    workerThread = std::thread(serverThread, this);
+    // Started while streaming, serve the stream from here on
+    if (haveStream) { openRing(); }
+    spdlog::info("IQ server listening on {0}:{1} ({2})", host.empty() ? "*" : host, port, protocol == PROTOCOL_TCP ? "TCP" : "UDP");
+    return true;
+}
+
+void IqServer::stop() {
+    if (!running) { return; }
+    closeRing();
+    running = false;
+    wake();
+    workerThread.join();
+
+    for (Client& c : clients) {
+        if (protocol == PROTOCOL_TCP) { closeSocket(c.fd); }
+    }
+    clients.clear();
+    clientCount = 0;
+    closeSocket(listenFd);
+    closeSocket(wakeFd);
+    listenFd = -1;
+    wakeFd = -1;
+    spdlog::info("IQ server stopped, {0} bytes sent, {1} blocks skipped", (uint64_t)bytesSent, (uint64_t)blocksSkipped);
+}
+
+void IqServer::beginStream(int blockBytes, double sampleRate, int format, int channels, double bufferSeconds) {
+    this->blockBytes = blockBytes;
+    this->sampleRate = sampleRate;
+    this->format = format;
+    this->channels = channels;
+    this->bufferSeconds = bufferSeconds;
+    sampleBytes = (format == IQ_SERVER_FORMAT_SC8_Q7) ? 2 : 4;
+    haveStream = true;
+    if (running) { openRing(); }
+}
+
+void IqServer::endStream() {
+    closeRing();
+    haveStream = false;
+}
+
+void IqServer::openRing() {
+    std::lock_guard<std::mutex> lck(ringMtx);
+    stride = (sizeof(IqServerHeader) + blockBytes + IQ_SERVER_SLOT_ALIGN - 1) / IQ_SERVER_SLOT_ALIGN * IQ_SERVER_SLOT_ALIGN;
+    double bytesPerSecond = sampleRate * channels * sampleBytes;
+    depth = std::clamp<int>((bytesPerSecond * bufferSeconds) / blockBytes, IQ_SERVER_MIN_DEPTH, IQ_SERVER_MAX_DEPTH);
+    if (stride * depth > arenaBytes) {
+        if (arena != NULL) { alignedFree(arena); }
+        arenaBytes = stride * depth;
+        arena = (uint8_t*)alignedAlloc(arenaBytes, IQ_SERVER_SLOT_ALIGN);
+        if (arena == NULL) {
+            spdlog::error("IQ server: could not allocate {0} MB of buffers", arenaBytes >> 20);
+            arenaBytes = 0;
+            depth = 0;
+            return;
+        }
+    }
+
+    // Clients pick up the new stream from its first block
+    writeStart = 0;
+    writeEnd = 0;
+    sampleIndex = 0;
+    generation++;
+    streaming = true;
+}
+
+void IqServer::closeRing() {
+    // Wait out a block the RX thread may be in the middle of copying, the arena stays for the next stream
+    streaming = false;
+    while (producerActive) { std::this_thread::yield(); }
+}
+
+void IqServer::publish(const void* data, int count, uint64_t timestamp, bool discontinuity) {
+    producerActive = true;
+    if (!streaming) {
+        producerActive = false;
+        return;
+    }
+    uint64_t perChannel = count / channels;
+    // Nobody to serve, skip the copy. Clients start at the newest block so nothing stale is sent.
+    if (clientCount.load(std::memory_order_relaxed) == 0) {
+        sampleIndex += perChannel;
+        producerActive = false;
+        return;
+    }
+
+    uint64_t w = writeEnd.load(std::memory_order_relaxed);
+    // Announce the slot is being reused before touching it, senders check this after reading
+    writeStart.store(w + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    uint8_t* s = slot(w);
+    size_t bytes = std::min<size_t>((size_t)count * sampleBytes, stride - sizeof(IqServerHeader));
+    IqServerHeader* hdr = (IqServerHeader*)s;
+    hdr->magic = IQ_SERVER_MAGIC;
+    hdr->version = IQ_SERVER_VERSION;
+    hdr->headerBytes = sizeof(IqServerHeader);
+    hdr->format = format;
+    hdr->channels = channels;
+    hdr->flags = discontinuity ? IQ_SERVER_FLAG_DISCONTINUITY : 0;
+    hdr->payloadBytes = bytes;
+    hdr->fragmentOffset = 0;
+    hdr->fragmentBytes = bytes;
+    hdr->sequence = w;
+    hdr->sampleIndex = sampleIndex;
+    hdr->timestamp = timestamp;
+    hdr->sampleRate = sampleRate;
+    hdr->frequency = frequency;
+    memcpy(s + sizeof(IqServerHeader), data, bytes);
+    sampleIndex += perChannel;
+
+    writeEnd.store(w + 1, std::memory_order_seq_cst);
+    if (sleeping.load(std::memory_order_seq_cst)) { wake(); }
+    producerActive = false;
+}
+
+IqServer::Stats IqServer::stats() {
+    Stats s;
+    s.clients = clientCount;
+    s.bytesSent = bytesSent;
+    s.blocksSkipped = blocksSkipped;
+    s.clientsDropped = clientsDropped;
+    return s;
+}
+
+bool IqServer::overwritten(uint64_t block) {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return writeStart.load(std::memory_order_relaxed) > block + depth;
+}
+
+void IqServer::wake() {
+    char b = 0;
+    sendto(wakeFd, &b, 1, 0, (const struct sockaddr*)wakeAddr, wakeAddrLen);
+}
+
+void IqServer::serverThread(IqServer* _this) {
+    std::vector<pollfd_t> fds;
+    char scratch[256];
+
+    while (_this->running) {
+        uint64_t end;
+        bool caughtUp = false;
+        fds.clear();
+        {
+            std::lock_guard<std::mutex> lck(_this->ringMtx);
+            end = _this->writeEnd.load(std::memory_order_acquire);
+            for (Client& c : _this->clients) {
+                if (!c.blocked && !_this->service(c, end)) { c.dead = true; }
+                if (!c.dead && !c.blocked) { caughtUp = true; }
+            }
+
+            pollfd_t p;
+            memset(&p, 0, sizeof(p));
+            p.fd = _this->wakeFd;
+            p.events = POLLIN;
+            fds.push_back(p);
+            p.fd = _this->listenFd;
+            fds.push_back(p);
+            if (_this->protocol == PROTOCOL_TCP) {
+                for (Client& c : _this->clients) {
+                    p.fd = c.fd;
+                    p.events = POLLIN | (c.blocked ? POLLOUT : 0);
+                    fds.push_back(p);
+                }
+            }
+        }
+
+        // Only a client waiting for data needs the producer to wake us, a blocked one waits on its socket
+        if (caughtUp) {
+            _this->sleeping.store(true, std::memory_order_seq_cst);
+            if (_this->writeEnd.load(std::memory_order_seq_cst) != end) {
+                _this->sleeping = false;
+                continue;
+            }
+        }
+        pollSockets(fds.data(), fds.size(), 1000);
+        _this->sleeping = false;
+        if (!_this->running) { break; }
+
+        std::lock_guard<std::mutex> lck(_this->ringMtx);
+        if (fds[0].revents & POLLIN) {
+            while (recv(_this->wakeFd, scratch, sizeof(scratch), 0) > 0);
+        }
+        if (_this->protocol == PROTOCOL_TCP) {
+            for (int i = 0; i < (int)_this->clients.size() && i + 2 < (int)fds.size(); i++) {
+                Client& c = _this->clients[i];
+                short ev = fds[i + 2].revents;
+                if (ev & POLLOUT) { c.blocked = false; }
+                if (ev & (POLLERR | POLLHUP | POLLNVAL)) { c.dead = true; }
+                if (ev & POLLIN) {
+                    // Clients have nothing to say, reading only tells whether they hung up
+                    int n = recv(c.fd, scratch, sizeof(scratch), 0);
+                    if (n == 0) { c.dead = true; }
+                }
+            }
+            if (fds[1].revents & POLLIN) { _this->acceptClients(); }
+        }
+        else {
+            if (fds[1].revents & POLLIN) { _this->receiveUdp(); }
+            uint64_t now = nowMs();
+            for (Client& c : _this->clients) {
+                if (now - c.lastSeenMs > IQ_SERVER_UDP_TIMEOUT_S * 1000) { c.dead = true; }
+            }
+        }
+
+        auto it = std::remove_if(_this->clients.begin(), _this->clients.end(), [&](Client& c) {
+            if (!c.dead) { return false; }
+            if (_this->protocol == PROTOCOL_TCP) { closeSocket(c.fd); }
+            return true;
+        });
+        if (it != _this->clients.end()) {
+            _this->clients.erase(it, _this->clients.end());
+            _this->clientCount = _this->clients.size();
+            spdlog::info("IQ server: client left, {0} connected", _this->clients.size());
+        }
+    }
+}
+
+void IqServer::acceptClients() {
+    while (true) {
+        struct sockaddr_storage addr;
+        socklen_t len = sizeof(addr);
+        intptr_t fd = accept(listenFd, (struct sockaddr*)&addr, &len);
+        if (fd < 0) { return; }
+        if (clients.size() >= IQ_SERVER_MAX_CLIENTS) {
+            spdlog::warn("IQ server: refusing client, {0} already connected", clients.size());
+            closeSocket(fd);
+            continue;
+        }
+        setNonBlocking(fd);
+        int buf = IQ_SERVER_SNDBUF;
+        setsockopt(fd, SOL_SOCKET, SO_SNDBUF, (const char*)&buf, sizeof(buf));
+#ifdef SO_NOSIGPIPE
+        int on = 1;
+        setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+        addClient(fd, &addr, len);
+    }
+}
+
+void IqServer::receiveUdp() {
+    char scratch[256];
+    while (true) {
+        struct sockaddr_storage addr;
+        socklen_t len = sizeof(addr);
+        if (recvfrom(listenFd, scratch, sizeof(scratch), 0, (struct sockaddr*)&addr, &len) < 0) { return; }
+        auto it = std::find_if(clients.begin(), clients.end(), [&](Client& c) {
+            return c.addrLen == (int)len && memcmp(c.addr, &addr, len) == 0;
+        });
+        if (it != clients.end()) {
+            it->lastSeenMs = nowMs();
+            continue;
+        }
+        if (clients.size() >= IQ_SERVER_MAX_CLIENTS) { continue; }
+        addClient(listenFd, &addr, len);
+    }
+}
+
+void IqServer::addClient(intptr_t fd, const void* addr, int addrLen) {
+    Client c;
+    c.fd = fd;
+    c.addrLen = std::min<int>(addrLen, sizeof(c.addr));
+    memcpy(c.addr, addr, c.addrLen);
+    c.lastSeenMs = nowMs();
+    c.generation = generation;
+    // Counted first so publish() starts copying before the cursor is taken
+    clientCount = clients.size() + 1;
+    c.cursor = writeEnd.load(std::memory_order_seq_cst);
+    clients.push_back(c);
+    spdlog::info("IQ server: client connected, {0} connected", clients.size());
+}
+
+bool IqServer::service(Client& c, uint64_t end) {
+    if (c.generation != generation) {
+        // A new stream started, a TCP client part way through a block of the old one can't be resynced
+        if (c.sent != 0) { return false; }
+        c.generation = generation;
+        c.cursor = 0;
+    }
+    if (depth == 0) { return true; }
+    return (protocol == PROTOCOL_TCP) ? sendTcp(c, end) : sendUdp(c, end);
+}
+
+// At a block boundary, move a client that fell too far behind up to the newest block
+bool IqServer::catchUp(Client& c, uint64_t end) {
+    uint64_t lag = end - c.cursor;
+    if (lag <= (uint64_t)depth / 2) { return true; }
+    if (policy == SLOW_DISCONNECT) {
+        spdlog::warn("IQ server: dropping client {0} blocks behind", lag);
+        clientsDropped++;
+        return false;
+    }
+    blocksSkipped += lag - 1;
+    c.cursor = end - 1;
+    return true;
+}
+
+bool IqServer::sendTcp(Client& c, uint64_t end) {
+    while (c.cursor < end) {
+        if (c.sent == 0 && !catchUp(c, end)) { return false; }
+
+        // Gather consecutive blocks, header and payload of each are contiguous in their slot
+        iovec_t iov[IQ_SERVER_MAX_IOV];
+        size_t totals[IQ_SERVER_MAX_IOV];
+        int n = 0;
+        uint64_t first = c.cursor;
+        size_t offset = c.sent;
+        for (uint64_t b = first; b < end && n < IQ_SERVER_MAX_IOV; b++) {
+            uint8_t* s = slot(b);
+            totals[n] = std::min<size_t>(sizeof(IqServerHeader) + ((IqServerHeader*)s)->payloadBytes, stride);
+            setIov(iov[n], s + offset, totals[n] - offset);
+            offset = 0;
+            n++;
+        }
+
+        bool wouldBlock;
+        long sent = sendVec(c.fd, iov, n, NULL, 0, wouldBlock);
+        if (sent < 0) {
+            if (wouldBlock) {
+                c.blocked = true;
+                return true;
+            }
+            return false;
+        }
+        if (overwritten(first)) {
+            // Part of what went out may already belong to a newer block
+            spdlog::warn("IQ server: client fell a full ring behind mid-block, dropping it");
+            clientsDropped++;
+            return false;
+        }
+        bytesSent += sent;
+
+        for (int i = 0; i < n && sent > 0; i++) {
+            size_t rem = totals[i] - c.sent;
+            if ((size_t)sent >= rem) {
+                sent -= rem;
+                c.cursor++;
+                c.sent = 0;
+            }
+            else {
+                c.sent += sent;
+                sent = 0;
+            }
+        }
+        // A short write means the socket buffer is full
+        if (c.sent != 0) {
+            c.blocked = true;
+            return true;
+        }
+    }
+    return true;
+}
+
+bool IqServer::sendUdp(Client& c, uint64_t end) {
+    while (c.cursor < end) {
+        if (!catchUp(c, end)) { return false; }
+
+        // Each datagram is copied out before it is checked and sent, so none mixes two blocks:
+        // unlike a TCP stream, the receiver couldn't tell from its header
+        if (udpBounce.empty()) { udpBounce.resize(sizeof(IqServerHeader) + IQ_SERVER_UDP_PAYLOAD); }
+        uint8_t* s = slot(c.cursor);
+        IqServerHeader hdr;
+        memcpy(&hdr, s, sizeof(hdr));
+        uint32_t payload = std::min<size_t>(hdr.payloadBytes, stride - sizeof(IqServerHeader));
+        for (uint32_t off = 0; off < payload; off += IQ_SERVER_UDP_PAYLOAD) {
+            hdr.fragmentOffset = off;
+            hdr.fragmentBytes = std::min<uint32_t>(payload - off, IQ_SERVER_UDP_PAYLOAD);
+            memcpy(udpBounce.data(), &hdr, sizeof(hdr));
+            memcpy(udpBounce.data() + sizeof(hdr), s + sizeof(IqServerHeader) + off, hdr.fragmentBytes);
+            if (overwritten(c.cursor)) {
+                // The writer got to the slot while it was copied, give the rest of the block up
+                blocksSkipped++;
+                break;
+            }
+            iovec_t iov[1];
+            setIov(iov[0], udpBounce.data(), sizeof(hdr) + hdr.fragmentBytes);
+            bool wouldBlock;
+            long sent = sendVec(listenFd, iov, 1, c.addr, c.addrLen, wouldBlock);
+            if (sent < 0) {
+                // Datagrams are best effort, the rest of the block is given up rather than waited for
+                if (wouldBlock) {
+                    blocksSkipped++;
+                    break;
+                }
+                return false;
+            }
+            bytesSent += sent;
+        }
+        c.cursor++;
+    }
+    return true;
+}
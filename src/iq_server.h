@@ -0,0 +1,164 @@
+#pragma once
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+
+#define IQ_SERVER_MAGIC         0x51495242  // "BRIQ" in little endian
+#define IQ_SERVER_VERSION       1
+#define IQ_SERVER_NO_TIMESTAMP  UINT64_MAX
+#define IQ_SERVER_UDP_PAYLOAD   8192        // Largest datagram payload, IP fragments it on a 1500 byte MTU
+#define IQ_SERVER_UDP_TIMEOUT_S 5           // UDP clients not heard from for this long are forgotten
+
+// Precedes every block (TCP) or fragment of a block (UDP), all fields little endian.
+// sampleIndex counts samples per channel since the stream started, so a jump in it
+// means blocks were skipped for this client; timestamp is the board's when known.
+#pragma pack(push, 1)
+struct IqServerHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t headerBytes;
+    uint8_t  format;            // IQ_SERVER_FORMAT_*
+    uint8_t  channels;          // Interleaved sample by sample, as in BLADERF_RX_X2
+    uint16_t flags;             // IQ_SERVER_FLAG_*
+    uint32_t payloadBytes;      // Of the whole block
+    uint32_t fragmentOffset;    // Where this datagram's payload starts in the block, 0 over TCP
+    uint32_t fragmentBytes;     // Payload in this datagram, payloadBytes over TCP
+    uint64_t sequence;          // Block number
+    uint64_t sampleIndex;
+    uint64_t timestamp;
+    double   sampleRate;
+    double   frequency;
+};
+#pragma pack(pop)
+
+enum {
+    IQ_SERVER_FORMAT_SC16_Q11,
+    IQ_SERVER_FORMAT_SC8_Q7
+};
+
+#define IQ_SERVER_FLAG_DISCONTINUITY    (1 << 0)    // The board lost samples right before this block
+
+// Serves the raw blocks the RX thread reads to any number of TCP or UDP clients.
+//
+// The RX thread copies each block once into a shared ring, next to its header, and
+// moves on: it never waits on the network. Each client has its own read cursor into
+// that ring and a single sender thread writes header and payload straight out of the
+// ring slot with scatter-gather sends, so there is no copy per client. A client that
+// falls more than half the ring behind is skipped to the newest block (its
+// sampleIndex jumps), or disconnected when that policy is chosen. A block that gets
+// overwritten while a TCP client is still part way through it can't be finished
+// cleanly, so that client is disconnected.
+//
+// UDP clients register by sending any datagram to the server port and have to repeat
+// it at least every IQ_SERVER_UDP_TIMEOUT_S seconds. Blocks are split into datagrams
+// of at most IQ_SERVER_UDP_PAYLOAD bytes, each with its own header.
+class IqServer {
+public:
+    enum Protocol {
+        PROTOCOL_TCP,
+        PROTOCOL_UDP
+    };
+
+    enum SlowPolicy {
+        SLOW_SKIP,
+        SLOW_DISCONNECT
+    };
+
+    struct Stats {
+        int clients = 0;
+        uint64_t bytesSent = 0;
+        uint64_t blocksSkipped = 0;
+        uint64_t clientsDropped = 0;
+    };
+
+    ~IqServer();
+
+    bool start(const std::string& host, int port, Protocol protocol, SlowPolicy policy);
+    void stop();
+    bool isRunning() { return running; }
+
+    // Called before the RX thread starts and after it stopped. While both a stream and
+    // the server run, the ring holds bufferSeconds worth of blocks of up to blockBytes;
+    // it is only reallocated when it has to grow.
+    void beginStream(int blockBytes, double sampleRate, int format, int channels, double bufferSeconds);
+    void endStream();
+
+    // RX thread only. count is in samples of all channels.
+    void publish(const void* data, int count, uint64_t timestamp, bool discontinuity);
+
+    // Any thread, takes effect with the next block
+    void setFrequency(double freq) { frequency = freq; }
+
+    Stats stats();
+
+private:
+    struct Client {
+        intptr_t fd = -1;
+        uint8_t addr[128];          // UDP peer, a sockaddr_storage
+        int addrLen = 0;
+        uint64_t lastSeenMs = 0;
+        uint64_t cursor = 0;        // Next block to send
+        size_t sent = 0;            // Bytes of the current block already out, TCP
+        uint64_t generation = 0;    // Stream the cursor belongs to
+        bool blocked = false;       // Socket buffer full, waiting for POLLOUT
+        bool dead = false;
+    };
+
+    static void serverThread(IqServer* _this);
+    void acceptClients();
+    void receiveUdp();
+    void addClient(intptr_t fd, const void* addr, int addrLen);
+    bool service(Client& client, uint64_t end);
+    bool catchUp(Client& client, uint64_t end);
+    bool sendTcp(Client& client, uint64_t end);
+    bool sendUdp(Client& client, uint64_t end);
+    uint8_t* slot(uint64_t block) { return arena + (size_t)(block % depth) * stride; }
+    bool overwritten(uint64_t block);
+    void openRing();
+    void closeRing();
+    void wake();
+
+    intptr_t listenFd = -1;
+    intptr_t wakeFd = -1;           // Loopback UDP socket publish() pokes when the sender sleeps
+    uint8_t wakeAddr[128];
+    int wakeAddrLen = 0;
+    Protocol protocol = PROTOCOL_TCP;
+    SlowPolicy policy = SLOW_SKIP;
+    std::thread workerThread;
+    std::atomic<bool> running = false;
+    std::atomic<bool> sleeping = false;
+
+    // Ring, resized by beginStream() under ringMtx while the sender isn't looking
+    std::mutex ringMtx;
+    uint8_t* arena = NULL;
+    size_t arenaBytes = 0;
+    size_t stride = 0;
+    int depth = 0;
+    std::atomic<uint64_t> writeStart = 0;   // Block being written + 1
+    std::atomic<uint64_t> writeEnd = 0;     // Blocks complete
+    std::atomic<bool> streaming = false;       // publish() may use the ring
+    std::atomic<bool> producerActive = false;
+    uint64_t generation = 0;
+
+    // Stream description, RX side
+    bool haveStream = false;
+    int blockBytes = 0;
+    double bufferSeconds = 0;
+    double sampleRate = 0;
+    int format = IQ_SERVER_FORMAT_SC16_Q11;
+    int channels = 1;
+    int sampleBytes = 4;
+    std::atomic<double> frequency = 0.0;
+    uint64_t sampleIndex = 0;
+
+    // Sender side
+    std::vector<Client> clients;
+    std::atomic<int> clientCount = 0;
+    std::atomic<uint64_t> bytesSent = 0;
+    std::atomic<uint64_t> blocksSkipped = 0;
+    std::atomic<uint64_t> clientsDropped = 0;
+    std::vector<uint8_t> udpBounce;         // One datagram, header and fragment
+};
@@ -8,24 +8,86 @@
 #include <config.h>
 #include <options.h>
 #include <libbladeRF.h>
+#include <bladerf_device.h>
 #include <gui/widgets/stepped_slider.h>
 #include <gui/widgets/file_select.h>
+#include <sample_convert.h>
+#include <spsc_ring.h>
+#include <stream_tune.h>
+#include <rx_metrics.h>
+#include <channel_sink.h>
+#include <quick_tune.h>
+#include <sweep.h>
+#include <device_caps.h>
+#include <fpga_loader.h>
+#include <raw_recorder.h>
+#include <replay_device.h>
+#include <decimator.h>
+#include <iq_calibration.h>
+#include <agc.h>
+#include <thread_sched.h>
+#include <sample_pool.h>
+#include <iq_server.h>
+#include <burst_capture.h>
+#include <algorithm>
+#include <fstream>
+#include <set>
 
 #define CONCAT(a, b) ((std::string(a) + b).c_str())
 
+// Sweep scheduling
+#define SWEEP_MAX_HOPS          256     // Quick-tune profiles the bladeRF 2.0 can hold
+#define SWEEP_QUEUE_AHEAD       8       // Retunes kept queued in the FPGA (it holds 16)
+#define SWEEP_LEAD_S            0.02    // Margin between the board's clock and the first scheduled hop
+#define SWEEP_MARGIN_S          0.002   // A retune closer than this to the board's clock may be applied late
+#define SWEEP_DEFAULT_STEP      0.75    // Fraction of the sample rate kept per hop when no step is set
+
+// DC / IQ correction
+#define IQ_CAL_WINDOW_S         0.1     // Samples that go into one estimate
+#define IQ_CAL_POLL_MS          50      // How often the retune thread looks for a finished window
+
+// AGC
+#define AGC_WINDOW_S            0.02    // Samples that go into one level measurement
+
+// Network server
+#define IQ_SERVER_BUFFER_S      0.25    // Raw samples kept for clients to catch up from
+#define IQ_SERVER_DEFAULT_PORT  5560
+
 SDRPP_MOD_INFO {
     /* Name:            */ "bladerf_source",
     /* Description:     */ "bladeRF source module for SDR++",
     /* Author:          */ "txjacob",
     /* Version:         */ 0, 0, 1,
-    /* Max instances    */ 1
+    /* Max instances    */ -1
 };
 
 ConfigManager config;
 
+// Shared by all instances, each one binds a board of its own
+static std::set<std::string> sourceNames;
+static std::atomic<int> streamingInstances = 0;
+static std::mutex metricsFileMtx;
+
 const char* AGG_MODES_STR = "Off\0On\0";
 const char* XB_BOARD_STR = "None\0XB-100\0XB-200\0XB-300\0";
 const char* XB_200_STR = "50M\000144M\000222M\0CUSTOM\0AUTO_1DB\0AUTO_3DB\0";
+const char* RX_CHANNEL_STR = "RX1\0RX2\0";
+const char* SAMPLE_FORMAT_STR = "16 bit (SC16_Q11)\0" "8 bit (SC8_Q7)\0";
+const char* RX_PRIORITY_STR = "Normal\0High\0Real-time (SCHED_FIFO)\0";
+const char* SWEEP_FFT_STR = "256\0" "512\0" "1024\0" "2048\0" "4096\0" "8192\0";
+const char* IQ_SERVER_PROTOCOL_STR = "TCP\0UDP\0";
+const char* IQ_SERVER_POLICY_STR = "Skip ahead\0Disconnect\0";
+
+// In-plugin resampling ratios (interp, decim) offered below the lowest hardware rate
+const int LOW_RATE_RATIOS[][2] = {
+    { 1, 2 }, { 3, 8 }, { 1, 4 }, { 3, 16 }, { 3, 20 }, { 1, 8 },
+    { 3, 25 }, { 1, 16 }, { 3, 50 }, { 1, 32 }, { 3, 100 }, { 1, 64 }
+};
+
+enum {
+    SAMPLE_FORMAT_SC16,
+    SAMPLE_FORMAT_SC8
+};
 
 
 class bladeRFSourceModule : public ModuleManager::Instance {
@@ -44,19 +106,63 @@ public:
         handler.tuneHandler         = tune;
         handler.stream              = &stream;
 
-        refresh();
-
         config.aquire();
-        std::string devSerial = config.conf["device"];
+        if (config.conf.contains("metricsExport")) {
+            metricsExport = config.conf["metricsExport"];
+        }
+        if (config.conf.contains("metricsPath")) {
+            std::string path = config.conf["metricsPath"];
+            strncpy(metricsPath, path.c_str(), sizeof(metricsPath) - 1);
+        }
+        if (config.conf.contains("metricsInterval")) {
+            metricsInterval = config.conf["metricsInterval"];
+        }
+        if (config.conf.contains("replayPath")) {
+            std::string path = config.conf["replayPath"];
+            strncpy(replayPath, path.c_str(), sizeof(replayPath) - 1);
+        }
+        if (config.conf.contains("replayPaced")) {
+            replayOptions.paced = config.conf["replayPaced"];
+        }
+        if (config.conf.contains("replayLoop")) {
+            replayOptions.loop = config.conf["replayLoop"];
+        }
+        // The server belongs to the instance, it keeps serving whichever board is selected
+        json& inst = config.conf["instances"][name];
+        if (inst.contains("serverHost")) {
+            std::string host = inst["serverHost"];
+            strncpy(serverHost, host.c_str(), sizeof(serverHost) - 1);
+        }
+        if (inst.contains("serverPort")) {
+            serverPort = inst["serverPort"];
+        }
+        if (inst.contains("serverProtocol")) {
+            serverProtocol = inst["serverProtocol"];
+        }
+        if (inst.contains("serverPolicy")) {
+            serverPolicy = inst["serverPolicy"];
+        }
+        bool serve = inst.contains("serverEnabled") && inst["serverEnabled"];
         config.release();
-        selectFirst();
+        refresh();
+        selectDefault();
         core::setInputSampleRate(sampleRate);
+        if (serve) { startServer(); }
 
-        sigpath::sourceManager.registerSource("BladeRF", &handler);
+        // The first instance keeps the plain name, so existing setups find their source
+        sourceName = "BladeRF";
+        if (sourceNames.count(sourceName)) { sourceName = "BladeRF (" + name + ")"; }
+        sourceNames.insert(sourceName);
+        sigpath::sourceManager.registerSource(sourceName, &handler);
     }
 
     ~bladeRFSourceModule() {
-        
+        stop(this);
+        iqServer.stop();
+        closeDevice();
+        sigpath::sourceManager.unregisterSource(sourceName);
+        sourceNames.erase(sourceName);
+        if (selectedSerial != "") { bladerfdev::release(selectedSerial, name); }
     }
 
     void enable() {
@@ -71,71 +177,105 @@ public:
         return enabled;
     }
 
-    void refresh() {
-        std::string devSerial;
-        devList.clear();
-        devListTxt = "";
-
-        struct bladerf_devinfo *dev_info;
-        int n = bladerf_get_device_list(&dev_info);
+    void refresh(bool force = false) {
+        devList = bladerfdev::listDevices(force);
+        // A recording to replay shows up as one more board
+        if (replayPath[0] != 0) {
+            devList.push_back(replay::serialFor(replayPath));
+        }
+        buildDevListTxt();
+    }
 
-        for (int i = 0; i < n; i++) {
-            devSerial = dev_info[i].serial;
-            devList.push_back(devSerial);
+    // Boards held by other instances are labelled with their owner
+    void buildDevListTxt() {
+        claimsSeen = bladerfdev::claimsVersion();
+        devListTxt = "";
+        for (const std::string& devSerial : devList) {
+            std::string owner = bladerfdev::ownerOf(devSerial);
             devListTxt += devSerial;
+            if (owner != "" && owner != name) { devListTxt += " (" + owner + ")"; }
+            devListTxt += '\0';
         }
-        bladerf_free_device_list(dev_info);
     }
 
-    void selectFirst() {
-        if (devList.size() != 0) {
-            selectBySerial(devList[0]);
+    // The board this instance used last, otherwise the first one no other instance holds
+    void selectDefault() {
+        config.aquire();
+        std::string saved = "";
+        if (config.conf["instances"].contains(name) && config.conf["instances"][name].contains("device")) {
+            saved = config.conf["instances"][name]["device"].get<std::string>();
         }
-    }
+        else if (config.conf.contains("device")) {
+            // Written by versions with a single instance
+            saved = config.conf["device"].get<std::string>();
+        }
+        config.release();
 
-    void selectBySerial(std::string serial) {
-        struct bladerf_devinfo dev_info;
-
-        /* Initialize the information used to identify the desired device
-         * to all wildcard (i.e., "any device") values */
-        bladerf_init_devinfo(&dev_info);
-        strncpy(dev_info.serial, serial.c_str(), sizeof(dev_info.serial) - 1);
-        try {
-            int err = bladerf_open_with_devinfo(&dev, &dev_info);
-            if (err != 0) {
-                spdlog::error("Could not open bladeRF {0}", serial);
+        std::string owner = bladerfdev::ownerOf(saved);
+        if (saved != "" && std::find(devList.begin(), devList.end(), saved) != devList.end() && (owner == "" || owner == name)) {
+            selectBySerial(saved);
+            return;
+        }
+        for (const std::string& devSerial : devList) {
+            owner = bladerfdev::ownerOf(devSerial);
+            if (owner == "" || owner == name) {
+                selectBySerial(devSerial);
                 return;
             }
         }
-        catch (std::exception e) {
-            spdlog::error("Could not open bladeRF {0}", serial);
-        }
-
-        selectedSerial = serial;
-        const struct bladerf_range* range;
+    }
 
-        // Original bladeRF only has 1 input channel, will need to change argument 2 to a variable for the new bladeRF
-        bladerf_get_sample_rate_range(dev, selectedChannel, &range);
+    void saveSelection() {
+        if (selectedSerial == "") { return; }
+        config.aquire();
+        config.conf["instances"][name]["device"] = selectedSerial;
+        config.release(true);
+    }
 
-        sampleRateList.clear();
-        sampleRateListTxt = "";
-        for (int i = 0; i < range->max / (range->min * 10); i++) {
-            sampleRateList.push_back((range->min + range->min * i) * 10);
-            sampleRateListTxt += getBandwdithScaled((range->min + range->min * i)*10);
-            sampleRateListTxt += '\0';
+    void selectBySerial(std::string serial) {
+        // Each board belongs to a single instance
+        if (!bladerfdev::claim(serial, name)) {
+            spdlog::warn("bladeRF {0} is in use by '{1}'", serial, bladerfdev::ownerOf(serial));
+            auto it = std::find(devList.begin(), devList.end(), selectedSerial);
+            devId = (it != devList.end()) ? (it - devList.begin()) : 0;
+            return;
         }
 
-        bladerf_get_bandwidth_range(dev, selectedChannel, &range);
-
-        bandwidthList.clear();
-        bandwidthTxt = "";
+        // A board kept open for warm restarts is released when switching away or refreshing
+        closeDevice();
+        if (selectedSerial != "" && selectedSerial != serial) {
+            bladerfdev::release(selectedSerial, name);
+            // Buffers belong to the board, the next one may need different sizes
+            bufferPool.clear();
+        }
+        auto it = std::find(devList.begin(), devList.end(), serial);
+        if (it != devList.end()) { devId = it - devList.begin(); }
 
-        for (int i = 0; i < range->max / range->min; i++) {
-            bandwidthList.push_back((range->min + range->min * i));
-            bandwidthTxt += getBandwdithScaled((range->min + range->min * i));
-            bandwidthTxt += '\0';
+        // Capabilities come from the config when this board was seen before, so selecting it needs no USB access
+        DeviceCaps newCaps;
+        bool probed = false;
+        config.aquire();
+        bool cached = config.conf["devices"].contains(serial) && config.conf["devices"][serial].contains("capabilities") &&
+                      devcaps::fromJson(config.conf["devices"][serial]["capabilities"], newCaps);
+        // Decides which rates the list offers, so it's needed before the list is built
+        lowRates = false;
+        if (config.conf["devices"].contains(serial) && config.conf["devices"][serial].contains("lowRates")) {
+            lowRates = config.conf["devices"][serial]["lowRates"];
+        }
+        config.release();
+        if (!cached) {
+            int err = devcaps::probe(serial, selectedChannel, newCaps);
+            if (err != 0) {
+                // Busy or gone, still selectable. start() will correct the lists once it gets the board.
+                spdlog::warn("Could not open bladeRF {0} to read its capabilities, using defaults", serial);
+                newCaps = DeviceCaps();
+            }
+            probed = (err == 0);
         }
 
+        selectedSerial = serial;
+        applyCaps(newCaps);
+
         // Load config here
         config.aquire();
         bool created = false;
@@ -148,6 +288,44 @@ public:
             config.conf["devices"][selectedSerial]["rxvga1"]        = 5;
             config.conf["devices"][selectedSerial]["rxvga2"]        = 0;
             config.conf["devices"][selectedSerial]["xbMode"]        = 0;
+            config.conf["devices"][selectedSerial]["asyncRx"]       = false;
+            config.conf["devices"][selectedSerial]["pipeline"]      = false;
+            config.conf["devices"][selectedSerial]["ringDepth"]     = 32;
+            config.conf["devices"][selectedSerial]["sampleFormat"]  = SAMPLE_FORMAT_SC16;
+            config.conf["devices"][selectedSerial]["lowRates"]      = false;
+            config.conf["devices"][selectedSerial]["iqCorrection"]  = false;
+            config.conf["devices"][selectedSerial]["iqHardware"]    = false;
+            config.conf["devices"][selectedSerial]["mimo"]          = false;
+            config.conf["devices"][selectedSerial]["primaryChannel"] = 0;
+            config.conf["devices"][selectedSerial]["auxPath"]       = "";
+            config.conf["devices"][selectedSerial]["rxGain0"]       = 30;
+            config.conf["devices"][selectedSerial]["rxGain1"]       = 30;
+            config.conf["devices"][selectedSerial]["warmRestart"]   = false;
+            config.conf["devices"][selectedSerial]["sweepMode"]     = false;
+            config.conf["devices"][selectedSerial]["sweepStart"]    = 88.0;
+            config.conf["devices"][selectedSerial]["sweepStop"]     = 108.0;
+            config.conf["devices"][selectedSerial]["sweepStep"]     = 0.0;
+            config.conf["devices"][selectedSerial]["sweepList"]     = "";
+            config.conf["devices"][selectedSerial]["sweepDwellUs"]  = 1000;
+            config.conf["devices"][selectedSerial]["sweepSettleUs"] = 100;
+            config.conf["devices"][selectedSerial]["sweepFftSize"]  = 2;
+            config.conf["devices"][selectedSerial]["sweepPath"]     = "";
+            config.conf["devices"][selectedSerial]["metaRx"]        = false;
+            config.conf["devices"][selectedSerial]["zeroFill"]      = false;
+            config.conf["devices"][selectedSerial]["streamAutoTune"] = true;
+            config.conf["devices"][selectedSerial]["latencyMs"]     = 5;
+            config.conf["devices"][selectedSerial]["numBuffers"]    = 16;
+            config.conf["devices"][selectedSerial]["bufferSize"]    = 4096;
+            config.conf["devices"][selectedSerial]["numTransfers"]  = 8;
+            config.conf["devices"][selectedSerial]["rxPriority"]    = threadsched::PRIORITY_NORMAL;
+            config.conf["devices"][selectedSerial]["rxCore"]        = -1;
+            config.conf["devices"][selectedSerial]["hugePages"]     = false;
+            config.conf["devices"][selectedSerial]["burstArmed"]    = false;
+            config.conf["devices"][selectedSerial]["burstPath"]     = "";
+            config.conf["devices"][selectedSerial]["burstThreshold"] = -30.0;
+            config.conf["devices"][selectedSerial]["burstHysteresis"] = 6.0;
+            config.conf["devices"][selectedSerial]["burstPre"]      = 1.0;
+            config.conf["devices"][selectedSerial]["burstPost"]     = 0.5;
         }
 
         // Load sample rate
@@ -178,7 +356,184 @@ public:
             }
         }
 
+        // Load streaming mode
+        asyncRx = false;
+        if (config.conf["devices"][selectedSerial].contains("asyncRx")) {
+            asyncRx = config.conf["devices"][selectedSerial]["asyncRx"];
+        }
+        pipeline = false;
+        if (config.conf["devices"][selectedSerial].contains("pipeline")) {
+            pipeline = config.conf["devices"][selectedSerial]["pipeline"];
+        }
+        ringDepth = 32;
+        if (config.conf["devices"][selectedSerial].contains("ringDepth")) {
+            ringDepth = config.conf["devices"][selectedSerial]["ringDepth"];
+        }
+
+        sampleFormat = SAMPLE_FORMAT_SC16;
+        if (config.conf["devices"][selectedSerial].contains("sampleFormat")) {
+            sampleFormat = config.conf["devices"][selectedSerial]["sampleFormat"];
+        }
+
+        // Load DC / IQ correction and the coefficients cached for this board
+        iqCorrect = false;
+        if (config.conf["devices"][selectedSerial].contains("iqCorrection")) {
+            iqCorrect = config.conf["devices"][selectedSerial]["iqCorrection"];
+        }
+        iqHardware = false;
+        if (config.conf["devices"][selectedSerial].contains("iqHardware")) {
+            iqHardware = config.conf["devices"][selectedSerial]["iqHardware"];
+        }
+        iqCal.clear();
+        if (config.conf["devices"][selectedSerial].contains("iqCal")) {
+            iqCal.load(config.conf["devices"][selectedSerial]["iqCal"]);
+        }
+        // Load channel setup
+        mimo = false;
+        if (config.conf["devices"][selectedSerial].contains("mimo")) {
+            mimo = config.conf["devices"][selectedSerial]["mimo"];
+        }
+        primaryChannel = 0;
+        if (config.conf["devices"][selectedSerial].contains("primaryChannel")) {
+            primaryChannel = config.conf["devices"][selectedSerial]["primaryChannel"];
+        }
+        selectedChannel = BLADERF_CHANNEL_RX(primaryChannel);
+        auxPath[0] = 0;
+        if (config.conf["devices"][selectedSerial].contains("auxPath")) {
+            std::string path = config.conf["devices"][selectedSerial]["auxPath"];
+            strncpy(auxPath, path.c_str(), sizeof(auxPath) - 1);
+        }
+        if (config.conf["devices"][selectedSerial].contains("rxGain0")) {
+            rxGain[0] = config.conf["devices"][selectedSerial]["rxGain0"];
+        }
+        if (config.conf["devices"][selectedSerial].contains("rxGain1")) {
+            rxGain[1] = config.conf["devices"][selectedSerial]["rxGain1"];
+        }
+
+        // A per board default bitstream is loaded as soon as the board is selected
+        fpgaAutoload = false;
+        if (config.conf["devices"][selectedSerial].contains("bitstream")) {
+            std::string path = config.conf["devices"][selectedSerial]["bitstream"];
+            if (!path.empty()) {
+                fpgaAutoload = true;
+                bitstreamPath = path;
+                fileSelect.setPath(path);
+            }
+        }
+
+        recordPath[0] = 0;
+        if (config.conf["devices"][selectedSerial].contains("recordPath")) {
+            std::string path = config.conf["devices"][selectedSerial]["recordPath"];
+            strncpy(recordPath, path.c_str(), sizeof(recordPath) - 1);
+        }
+
+        warmRestart = false;
+        if (config.conf["devices"][selectedSerial].contains("warmRestart")) {
+            warmRestart = config.conf["devices"][selectedSerial]["warmRestart"];
+        }
+
+        // Load sweep settings
+        sweepMode = false;
+        if (config.conf["devices"][selectedSerial].contains("sweepMode")) {
+            sweepMode = config.conf["devices"][selectedSerial]["sweepMode"];
+        }
+        if (config.conf["devices"][selectedSerial].contains("sweepStart")) {
+            sweepStart = config.conf["devices"][selectedSerial]["sweepStart"];
+        }
+        if (config.conf["devices"][selectedSerial].contains("sweepStop")) {
+            sweepStop = config.conf["devices"][selectedSerial]["sweepStop"];
+        }
+        if (config.conf["devices"][selectedSerial].contains("sweepStep")) {
+            sweepStep = config.conf["devices"][selectedSerial]["sweepStep"];
+        }
+        sweepList[0] = 0;
+        if (config.conf["devices"][selectedSerial].contains("sweepList")) {
+            std::string list = config.conf["devices"][selectedSerial]["sweepList"];
+            strncpy(sweepList, list.c_str(), sizeof(sweepList) - 1);
+        }
+        if (config.conf["devices"][selectedSerial].contains("sweepDwellUs")) {
+            sweepDwellUs = config.conf["devices"][selectedSerial]["sweepDwellUs"];
+        }
+        if (config.conf["devices"][selectedSerial].contains("sweepSettleUs")) {
+            sweepSettleUs = config.conf["devices"][selectedSerial]["sweepSettleUs"];
+        }
+        if (config.conf["devices"][selectedSerial].contains("sweepFftSize")) {
+            sweepFftId = config.conf["devices"][selectedSerial]["sweepFftSize"];
+        }
+        sweepPath[0] = 0;
+        if (config.conf["devices"][selectedSerial].contains("sweepPath")) {
+            std::string path = config.conf["devices"][selectedSerial]["sweepPath"];
+            strncpy(sweepPath, path.c_str(), sizeof(sweepPath) - 1);
+        }
+
+        metaRx = false;
+        if (config.conf["devices"][selectedSerial].contains("metaRx")) {
+            metaRx = config.conf["devices"][selectedSerial]["metaRx"];
+        }
+        zeroFill = false;
+        if (config.conf["devices"][selectedSerial].contains("zeroFill")) {
+            zeroFill = config.conf["devices"][selectedSerial]["zeroFill"];
+        }
+
+        // Load stream buffer tuning
+        if (config.conf["devices"][selectedSerial].contains("streamAutoTune")) {
+            streamAutoTune = config.conf["devices"][selectedSerial]["streamAutoTune"];
+        }
+        if (config.conf["devices"][selectedSerial].contains("latencyMs")) {
+            latencyMs = config.conf["devices"][selectedSerial]["latencyMs"];
+        }
+        if (config.conf["devices"][selectedSerial].contains("numBuffers")) {
+            manualBuffers = config.conf["devices"][selectedSerial]["numBuffers"];
+        }
+        if (config.conf["devices"][selectedSerial].contains("bufferSize")) {
+            manualBufferSize = config.conf["devices"][selectedSerial]["bufferSize"];
+        }
+        if (config.conf["devices"][selectedSerial].contains("numTransfers")) {
+            manualTransfers = config.conf["devices"][selectedSerial]["numTransfers"];
+        }
+
+        // Load RX thread scheduling and buffer backing
+        rxPriority = threadsched::PRIORITY_NORMAL;
+        if (config.conf["devices"][selectedSerial].contains("rxPriority")) {
+            rxPriority = config.conf["devices"][selectedSerial]["rxPriority"];
+        }
+        rxCore = -1;
+        if (config.conf["devices"][selectedSerial].contains("rxCore")) {
+            rxCore = config.conf["devices"][selectedSerial]["rxCore"];
+        }
+        hugePages = false;
+        if (config.conf["devices"][selectedSerial].contains("hugePages")) {
+            hugePages = config.conf["devices"][selectedSerial]["hugePages"];
+        }
+
+        // Load burst capture settings
+        burstArmed = false;
+        if (config.conf["devices"][selectedSerial].contains("burstArmed")) {
+            burstArmed = config.conf["devices"][selectedSerial]["burstArmed"];
+        }
+        burstPath[0] = 0;
+        if (config.conf["devices"][selectedSerial].contains("burstPath")) {
+            std::string path = config.conf["devices"][selectedSerial]["burstPath"];
+            strncpy(burstPath, path.c_str(), sizeof(burstPath) - 1);
+        }
+        if (config.conf["devices"][selectedSerial].contains("burstThreshold")) {
+            burstSettings.thresholdDbfs = config.conf["devices"][selectedSerial]["burstThreshold"];
+        }
+        if (config.conf["devices"][selectedSerial].contains("burstHysteresis")) {
+            burstSettings.hysteresisDb = config.conf["devices"][selectedSerial]["burstHysteresis"];
+        }
+        if (config.conf["devices"][selectedSerial].contains("burstPre")) {
+            burstSettings.preSeconds = config.conf["devices"][selectedSerial]["burstPre"];
+        }
+        if (config.conf["devices"][selectedSerial].contains("burstPost")) {
+            burstSettings.postSeconds = config.conf["devices"][selectedSerial]["burstPost"];
+        }
+
         // Load Gains
+        agcMode = 0;
+        if (config.conf["devices"][selectedSerial].contains("agcMode")) {
+            agcMode = config.conf["devices"][selectedSerial]["agcMode"];
+        }
         if (config.conf["devices"][selectedSerial].contains("xbMode")) {
             xbMode = config.conf["devices"][selectedSerial]["xbMode"];
         }
@@ -192,207 +547,876 @@ public:
             rxvga2 = config.conf["devices"][selectedSerial]["rxvga2"];
         }
 
-        config.release(created);
+        if (probed) {
+            config.conf["devices"][selectedSerial]["capabilities"] = devcaps::toJson(newCaps);
+        }
+
+        config.release(created || probed);
 
-        bladerf_close(dev);
+        if (fpgaAutoload) {
+            startFpgaLoad();
+        }
     }
 
-private:
-    std::string getBandwdithScaled(double bw) {
-        char buf[1024];
-        if (bw >= 1000000.0) {
-            sprintf(buf, "%.1lfMHz", bw / 1000000.0);
+    // Rebuild the sample rate and bandwidth lists offered in the menu
+    void applyCaps(const DeviceCaps& newCaps) {
+        caps = newCaps;
+
+        sampleRateList.clear();
+        sampleRateListTxt = "";
+        streamRates.clear();
+
+        // Rates below what the board does are resampled from its lowest listed rate
+        int64_t baseRate = caps.sampleRateMin * 10;
+        if (lowRates) {
+            int n = sizeof(LOW_RATE_RATIOS) / sizeof(LOW_RATE_RATIOS[0]);
+            for (int i = n - 1; i >= 0; i--) {
+                int interp = LOW_RATE_RATIOS[i][0];
+                int decim = LOW_RATE_RATIOS[i][1];
+                uint32_t rate = baseRate * interp / decim;
+                sampleRateList.push_back(rate);
+                streamRates.push_back({ (uint32_t)baseRate, interp, decim });
+                char ratio[32];
+                if (interp == 1) {
+                    sprintf(ratio, " (/%d)", decim);
+                }
+                else {
+                    sprintf(ratio, " (x%d/%d)", interp, decim);
+                }
+                sampleRateListTxt += getBandwdithScaled(rate) + ratio;
+                sampleRateListTxt += '\0';
+            }
         }
-        else if (bw >= 1000.0) {
-            sprintf(buf, "%.1lfKHz", bw / 1000.0);
+
+        for (int i = 0; i < caps.sampleRateMax / (caps.sampleRateMin * 10); i++) {
+            sampleRateList.push_back((caps.sampleRateMin + caps.sampleRateMin * i) * 10);
+            streamRates.push_back({ (uint32_t)((caps.sampleRateMin + caps.sampleRateMin * i) * 10), 1, 1 });
+            sampleRateListTxt += getBandwdithScaled((caps.sampleRateMin + caps.sampleRateMin * i)*10);
+            sampleRateListTxt += '\0';
         }
-        else {
-            sprintf(buf, "%.1lfHz", bw);
+
+        bandwidthList.clear();
+        bandwidthTxt = "";
+
+        for (int i = 0; i < caps.bandwidthMax / caps.bandwidthMin; i++) {
+            bandwidthList.push_back((caps.bandwidthMin + caps.bandwidthMin * i));
+            bandwidthTxt += getBandwdithScaled((caps.bandwidthMin + caps.bandwidthMin * i));
+            bandwidthTxt += '\0';
         }
-        return std::string(buf);
     }
 
-    static void menuSelected(void* ctx) {
-        bladeRFSourceModule* _this = (bladeRFSourceModule*)ctx;
-        core::setInputSampleRate(_this->sampleRate);
-        spdlog::info("bladeRFSourceModule '{0}': Menu Select!", _this->name);
-    }
+    // Compare the cached capabilities with the open board, fixing the cache and
+    // the current selection when the board turned out to be different
+    void validateCaps() {
+        DeviceCaps actual;
+        if (devcaps::probe(dev, selectedChannel, actual) != 0 || actual == caps) { return; }
 
-    static void menuDeselected(void* ctx) {
-        bladeRFSourceModule* _this = (bladeRFSourceModule*)ctx;
-        spdlog::info("bladeRFSourceModule '{0}': Menu Deselect!", _this->name);
+        spdlog::info("bladeRF {0}: capabilities changed ({1}), updating cache", selectedSerial, actual.boardName);
+        applyCaps(actual);
+
+        // Keep the closest setting the board supports
+        selectNearestRate();
+        bwId = 0;
+        for (int i = 0; i < bandwidthList.size(); i++) {
+            if (fabs((double)bandwidthList[i] - bandwidth) < fabs((double)bandwidthList[bwId] - bandwidth)) { bwId = i; }
+        }
+        bandwidth = bandwidthList[bwId];
+
+        config.aquire();
+        config.conf["devices"][selectedSerial]["capabilities"] = devcaps::toJson(actual);
+        config.release(true);
     }
-    
-    static void start(void* ctx)
-    {
-        bladeRFSourceModule* _this = (bladeRFSourceModule*)ctx;
-        if (_this->running) {
-            return;
+
+    void selectNearestRate() {
+        srId = 0;
+        for (int i = 0; i < sampleRateList.size(); i++) {
+            if (fabs(sampleRateList[i] - sampleRate) < fabs(sampleRateList[srId] - sampleRate)) { srId = i; }
         }
-        if (_this->selectedSerial.empty()) {
-            spdlog::error("Tried to start bladeRF source with null serial");
-            return;
+        if (sampleRate != sampleRateList[srId]) {
+            sampleRate = sampleRateList[srId];
+            core::setInputSampleRate(sampleRate);
         }
+    }
 
-        struct bladerf_devinfo dev_info;
-        int status;
-        
-        /* Initialize the information used to identify the desired device
-         * to all wildcard (i.e., "any device") values */
-        bladerf_init_devinfo(&dev_info);
-        strncpy(dev_info.serial, _this->selectedSerial.c_str(), sizeof(dev_info.serial) - 1);
+    // What the board itself runs at for the selected entry of the rate list
+    uint32_t hwSampleRate() {
+        return streamRates[srId].hwRate;
+    }
+
+    bool isResampled() {
+        return streamRates[srId].interp != 1 || streamRates[srId].decim != 1;
+    }
+
+    void closeDevice() {
+        if (dev != NULL) {
+            delete dev;
+            dev = NULL;
+        }
+    }
 
-        status = bladerf_open_with_devinfo(&(_this->dev), &dev_info);
+    // Open the selected board and make sure it has an FPGA. Cleans up after itself on failure.
+    bool openDevice() {
+        int status;
+        if (replay::isReplaySerial(selectedSerial)) {
+            dev = replay::create(selectedSerial, replayOptions);
+        }
+        else {
+            dev = bladerfdev::create(selectedSerial);
+        }
+        status = dev->open(selectedSerial);
         if (status != 0) {
-            spdlog::error("Could not open bladeRF {0}", _this->selectedSerial);
+            spdlog::error("Could not open bladeRF {0}", selectedSerial);
             spdlog::error(bladerf_strerror(status));
-            return;
+            closeDevice();
+            return false;
         }
 
-        if(!_this->bitstreamPath.empty())
-        {
-            spdlog::info("Loading bitstream: {0}", _this->bitstreamPath);
-            status = bladerf_load_fpga(_this->dev, _this->bitstreamPath.c_str());
-            if (status != 0) {
-                spdlog::error("Error loading bitstream - bladeRF {0}", _this->selectedSerial);
-                spdlog::error(bladerf_strerror(status));
-                return;
+        status = dev->isFpgaConfigured();
+        if (status != 1) {
+            spdlog::error("{0} FPGA NOT LOADED", selectedSerial);
+            closeDevice();
+            if (!bitstreamPath.empty()) {
+                spdlog::info("Loading {0} in the background, start again once it is done", bitstreamPath);
+                startFpgaLoad();
             }
+            return false;
         }
 
-        status = bladerf_is_fpga_configured(_this->dev);
-        if (status != 1) {
-            spdlog::error("{0} FPGA NOT LOADED", _this->selectedSerial);
-            bladerf_close(_this->dev);
-            return;
-        }
+        validateCaps();
+
+        // Quick-tune profiles don't survive reopening the board
+        quickTune.clear();
+        applied = DeviceState();
+        sc8FellBack = false;
+        return true;
+    }
 
-        bladerf_sample_rate actualRate;
+    // Bitstreams are loaded by FpgaLoader on its own handle, skipped when the board already runs the same image
+    void startFpgaLoad() {
+        if (selectedSerial.empty() || bitstreamPath.empty() || fpgaLoader.busy()) { return; }
+        closeDevice();
+        FpgaLoader::Record prev;
+        config.aquire();
+        json& devConf = config.conf["devices"][selectedSerial];
+        if (devConf.contains("fpgaHash")) { prev.hash = devConf["fpgaHash"].get<std::string>(); }
+        if (devConf.contains("fpgaVersion")) { prev.version = devConf["fpgaVersion"].get<std::string>(); }
+        if (devConf.contains("fpgaLoadMs")) { prev.loadMs = devConf["fpgaLoadMs"]; }
+        config.release();
+        fpgaLoader.start(selectedSerial, bitstreamPath, prev);
+    }
 
-        status = bladerf_set_sample_rate(_this->dev, _this->selectedChannel, _this->sampleRateList[_this->srId], &actualRate);
-        if (status != 0) {
-            spdlog::error("Could not set sample rate on bladeRF {0}", _this->selectedSerial);
-            spdlog::error(bladerf_strerror(status));
-            return;
-        }
+    // Remember what the board was loaded with once the loader is done
+    void collectFpgaLoad() {
+        std::string serial;
+        FpgaLoader::Record rec;
+        FpgaLoader::State state;
+        if (!fpgaLoader.collect(serial, rec, state) || state != FpgaLoader::FPGA_LOADER_DONE) { return; }
+        config.aquire();
+        config.conf["devices"][serial]["fpgaHash"] = rec.hash;
+        config.conf["devices"][serial]["fpgaVersion"] = rec.version;
+        config.conf["devices"][serial]["fpgaLoadMs"] = rec.loadMs;
+        config.release(true);
+    }
 
-        spdlog::info("Sample rate set to {0}", actualRate);
+    // The AGC drives the LNA / VGA stages of the primary stream, not the overall gains of 2x RX or a sweep
+    void startAgc() {
+        if (agcMode == 0 || mimo || sweepMode || agc.isRunning()) { return; }
+        Agc::Gains g;
+        g.lna = lna;
+        g.rxvga1 = rxvga1;
+        g.rxvga2 = rxvga2;
+        agc.start(dev, selectedChannel, g, hwSampleRate() * AGC_WINDOW_S);
+        agcActive = true;
+    }
 
-        status = bladerf_set_bandwidth(_this->dev, _this->selectedChannel, _this->bandwidth, NULL);
-        if (status != 0) {
-            fprintf(stderr, "Failed to set bandwidth = %u: %s\n", _this->bandwidth,
-            bladerf_strerror(status));
-            return;
+    void stopAgc() {
+        if (!agc.isRunning()) { return; }
+        agcActive = false;
+        agc.stop();
+
+        // What the AGC left in the hardware becomes the manual setting
+        Agc::Gains g = agc.gains();
+        lna = applied.lna = g.lna;
+        rxvga1 = applied.rxvga1 = g.rxvga1;
+        rxvga2 = applied.rxvga2 = g.rxvga2;
+        spdlog::info("bladeRFSourceModule '{0}': AGC made {1} changes, left LNA {2} dB, rxVGA1 {3} dB, rxVGA2 {4} dB", name,
+                     agc.changes(), g.lna, g.rxvga1, g.rxvga2);
+        if (selectedSerial != "") {
+            config.aquire();
+            config.conf["devices"][selectedSerial]["lna"] = lna;
+            config.conf["devices"][selectedSerial]["rxvga1"] = rxvga1;
+            config.conf["devices"][selectedSerial]["rxvga2"] = rxvga2;
+            config.release(true);
         }
+    }
 
-        status = bladerf_set_frequency(_this->dev, _this->selectedChannel, _this->freq);
-        if (status != 0) {
-            spdlog::error("Could not set frequency rate on bladeRF {0}", _this->selectedSerial);
-            spdlog::error(bladerf_strerror(status));
+    // Like the AGC, the trigger needs the conversion stats only the primary stream produces
+    void startBurst() {
+        if (burstCapture.isRunning()) { return; }
+        if (mimo || sweepMode) {
+            spdlog::error("Burst capture can't be used with sweep mode or 2x RX");
+            return;
+        }
+        if (burstPath[0] == 0) {
+            spdlog::error("Burst capture needs an output path");
             return;
         }
+        BurstCapture::Info info;
+        info.datatype = isSc8Format() ? "ci8" : "ci16_le";
+        info.sampleRate = hwSampleRate();
+        info.frequency = freq;
+        info.hardware = json({});
+        info.hardware["serial"] = selectedSerial;
+        info.hardware["bandwidth"] = bandwidth;
+        info.hardware["format"] = isSc8Format() ? "SC8_Q7" : "SC16_Q11";
+        info.hardware["lna"] = lna;
+        info.hardware["rxvga1"] = rxvga1;
+        info.hardware["rxvga2"] = rxvga2;
+
+        // The pre-trigger window comes from the pool, so re-arming doesn't allocate hundreds of MB again
+        size_t bytes = BurstCapture::arenaBytes(hwSampleRate(), sampleBytes(), burstSettings.preSeconds);
+        uint8_t* arena = (uint8_t*)bufferPool.get(SampleBufferPool::SLOT_BURST_RING, bytes);
+        if (burstCapture.start(burstPath, info, sampleBytes(), burstSettings, arena, bytes)) {
+            burstActive = true;
+        }
+    }
 
-        _this->channel_layout   = BLADERF_RX_X1;
-        _this->format           = BLADERF_FORMAT_SC16_Q11;
-        _this->num_buffers      = 16;
-        _this->buffer_size      = roundf(((float)_this->sampleRateList[_this->srId]/200.0) / 1024) * 1024;
-        _this->num_transfers    = 8;
-        _this->stream_timeout   = 3500; // Milliseconds
+    void stopBurst() {
+        if (!burstCapture.isRunning()) { return; }
+        burstActive = false;
+        burstCapture.stop();
+    }
 
-        bladerf_sync_config(
-            _this->dev,
-            _this->channel_layout,
-            _this->format,
-            _this->num_buffers,
-            _this->buffer_size,
-            _this->num_transfers,
-            _this->stream_timeout);
+    void rememberApplied() {
+        applied.xbMode = xbMode;
+        applied.asyncRx = asyncRx;
+        applied.mimo = mimo;
+        applied.primaryChannel = primaryChannel;
+        applied.sampleRate = hwSampleRate();
+        applied.bandwidth = bandwidth;
+        applied.freq = freq;
+        applied.lna = lna;
+        applied.rxvga1 = rxvga1;
+        applied.rxvga2 = rxvga2;
+        applied.rxGain[0] = rxGain[0];
+        applied.rxGain[1] = rxGain[1];
+        applied.xb200Mode = xb200Mode;
+        applied.layout = channel_layout;
+        applied.format = format;
+        applied.numBuffers = num_buffers;
+        applied.bufferSize = buffer_size;
+        applied.numTransfers = num_transfers;
+        applied.timeout = stream_timeout;
+    }
 
-        status = bladerf_enable_module(_this->dev, _this->selectedChannel, true);
-        if (status != 0) {
+    // Moves a running stream to the rate selected by srId without closing the board. RX is
+    // quiesced, the board and the stream buffers are set up for the new rate and RX resumes,
+    // within a few ms. SDR++ is told about the new rate while nothing is being written, so it
+    // sees a single switch with no block at the old rate after it. Returns false, with the
+    // stream carrying on at the rate of prevSrId, when the new rate can't be used in the mode
+    // streaming or the board refused it.
+    bool changeSampleRate(int prevSrId) {
+        if (sweepMode) {
+            spdlog::error("The sample rate can't be changed while sweeping");
+            return false;
+        }
+        if (isResampled() && mimo) {
+            spdlog::error("Rates below {0} can't be used with 2x RX", getBandwdithScaled(hwSampleRate()));
+            return false;
+        }
+        uint64_t begin = metricsNow();
+        double oldRate = applied.sampleRate;
+        double streamRate = hwSampleRate();
+
+        stopWorkers();
+        saveStreamRun(oldRate);
+        rxBlocks = 0;
+        rxOverruns = 0;
+        rxTimeouts = 0;
+        iqServer.endStream();
+        // Both describe the old rate in their SigMF metadata
+        bool burst = burstCapture.isRunning();
+        stopBurst();
+        if (rawRecorder.isRunning()) {
+            rawRecorder.stop();
+            spdlog::warn("bladeRFSourceModule '{0}': recording stopped by the sample rate change", name);
+        }
+        // Averages over a fixed number of samples, restarted for the new rate
+        stopAgc();
+
+        int status = resumeStreamAt(streamRate);
+        bool switched = (status == 0);
+        if (!switched) {
+            spdlog::error("Could not switch bladeRF {0} to {1}, going back to {2}", selectedSerial, getBandwdithScaled(streamRate),
+                          getBandwdithScaled(oldRate));
             spdlog::error(bladerf_strerror(status));
-            bladerf_deinit_stream(_this->bladerfStream);
-            bladerf_close(_this->dev);
-            return;
+            srId = prevSrId;
+            status = resumeStreamAt(oldRate);
         }
-
-        status = bladerf_set_gain_stage(_this->dev, _this->selectedChannel, "lna", _this->lna);
+        stream.clearWriteStop();
         if (status != 0) {
-            spdlog::error("LNA setrror on bladeRF {0}", _this->selectedSerial);
+            spdlog::error("bladeRF {0} doesn't stream at {1} anymore either, stopping", selectedSerial, getBandwdithScaled(oldRate));
             spdlog::error(bladerf_strerror(status));
-            return;
+            // Through SDR++ so its play button and the rest of the chain stop along with the source
+            gui::mainWindow.setPlayState(false);
+            return false;
+        }
+        if (switched) {
+            // Only once the board is at the new rate, nothing was written since the workers stopped
+            sampleRate = sampleRateList[srId];
+            core::setInputSampleRate(sampleRate);
         }
 
-        status = bladerf_set_gain_stage(_this->dev, _this->selectedChannel, "rxvga1", _this->rxvga1);
-        if (status != 0) {
-            spdlog::error("rxVGA1 set error on bladeRF {0}", _this->selectedSerial);
-            spdlog::error(bladerf_strerror(status));
-            return;
+        rememberApplied();
+        // The board's clock kept running while RX was off, that gap isn't lost samples
+        haveTimestamp = false;
+        initDecimator();
+        beginServerStream();
+        startAgc();
+        if (burst) { startBurst(); }
+        if (!startWorkers()) {
+            // sampleRate is already the one in effect, srId has to stay with it
+            gui::mainWindow.setPlayState(false);
+            return switched;
         }
 
-        status = bladerf_set_gain_stage(_this->dev, _this->selectedChannel, "rxvga2", _this->rxvga2);
+        if (!switched) { return false; }
+        rateChangeMs = (metricsNow() - begin) / 1e6;
+        spdlog::info("bladeRFSourceModule '{0}': Sample rate changed from {1} to {2} in {3:.1f} ms", name, getBandwdithScaled(oldRate),
+                     getBandwdithScaled(streamRate), rateChangeMs);
+        return true;
+    }
+
+    // The analog filter can be moved while samples keep flowing. Returns false, with the
+    // selection back on prevBwId, when the board refused the new bandwidth.
+    bool changeBandwidth(int prevBwId) {
+        int status = dev->setBandwidth(selectedChannel, bandwidth, NULL);
+        if (status == 0 && mimo) {
+            status = dev->setBandwidth(otherChannel(), bandwidth, NULL);
+            // Keep both channels on the same filter
+            if (status != 0) { dev->setBandwidth(selectedChannel, applied.bandwidth, NULL); }
+        }
         if (status != 0) {
-            spdlog::error("rxVGA2 set error on bladeRF {0}", _this->selectedSerial);
+            spdlog::error("Could not set bandwidth on bladeRF {0}", selectedSerial);
             spdlog::error(bladerf_strerror(status));
-            return;
+            bwId = prevBwId;
+            bandwidth = bandwidthList[bwId];
+            return false;
         }
+        applied.bandwidth = bandwidth;
+        return true;
+    }
 
-        if(_this->xbMode == BLADERF_XB_200) {
-            status = bladerf_expansion_attach(_this->dev, BLADERF_XB_200);
-            if (status != 0) {
-                spdlog::error("Expansion add error on bladeRF {0}", _this->selectedSerial);
-                spdlog::error(bladerf_strerror(status));
-                return;
-            }
+private:
+    // Buffer setup for streamRate, from the learned or manual values and shared between the boards streaming
+    void chooseStreamParams(double streamRate, int streams) {
+        streamtune::Params params;
+        if (streamAutoTune) {
+            params = loadTunedParams(streamRate);
+        }
+        else {
+            params = streamtune::sanitize({ (unsigned int)manualBuffers, (unsigned int)manualBufferSize, (unsigned int)manualTransfers });
+        }
+        tunedParams = params;
+        if (streams > 1) {
+            params = streamtune::share(params, streams);
+            spdlog::info("bladeRFSourceModule '{0}': {1} boards streaming, buffers limited to a shared budget", name, streams);
+        }
 
+        num_buffers     = params.numBuffers;
+        buffer_size     = params.bufferSize * channelCount(); // Counts samples of all channels
+        num_transfers   = params.numTransfers;
+        stream_timeout  = streamtune::timeoutMs(params, streamRate); // Milliseconds
 
-            status = bladerf_xb200_set_path(_this->dev, _this->selectedChannel, BLADERF_XB200_MIX);
-            if (status != 0) {
-                spdlog::error("xb200 path error on bladeRF {0}", _this->selectedSerial);
-                spdlog::error(bladerf_strerror(status));
-                return;
-            }
+        spdlog::info("Streaming with {0} buffers of {1} samples, {2} transfers", num_buffers, buffer_size, num_transfers);
+    }
 
-            status = bladerf_xb200_set_filterbank(_this->dev, _this->selectedChannel, (bladerf_xb200_filter)_this->xb200Mode);
-            if (status != 0) {
-                spdlog::error("xb200 filterbank error on bladeRF {0}", _this->selectedSerial);
-                spdlog::error(bladerf_strerror(status));
-                return;
-            }
-        } else {
-            bladerf_xb200_set_path(_this->dev, _this->selectedChannel, BLADERF_XB200_BYPASS);
-        }
+    // Learn from the run that just ended at streamRate
+    void saveStreamRun(double streamRate) {
+        // A run that never got going (a failed rate change) says nothing about the rate, and
+        // neither does one without metadata (async RX), where lost samples go unnoticed
+        if (!streamAutoTune || rxBlocks == 0 || !isMetaFormat()) { return; }
+        streamtune::RunStats stats = { rxBlocks, rxOverruns, rxTimeouts };
+        // From what was learned, not from the share of it this run got
+        streamtune::Params next = streamtune::adapt(tunedParams, streamRate, latencyMs, stats);
+        spdlog::info("Stream run: {0} blocks, {1} overruns, {2} timeouts", stats.blocks, stats.overruns, stats.timeouts);
+        saveTunedParams(streamRate, next);
+    }
 
-        _this->running = true;
-        _this->workerThread = std::thread(worker, _this);
-        spdlog::info("bladeRFSourceModule '{0}': Start!", _this->name);
+    // Sets the quiesced board and the stream buffers up for streamRate and turns RX back on.
+    // RX is turned off first, a failed attempt may have left a channel enabled.
+    int resumeStreamAt(double streamRate) {
+        dev->enableModule(selectedChannel, false);
+        if (mimo) { dev->enableModule(otherChannel(), false); }
+        if (asyncRx) { dev->deinitStream(); }
+
+        int status = dev->setSampleRate(selectedChannel, streamRate, NULL);
+        if (status == 0 && mimo) { status = dev->setSampleRate(otherChannel(), streamRate, NULL); }
+        if (status == 0) {
+            chooseStreamParams(streamRate, streamingInstances);
+            status = configureStream();
+        }
+        if (status == 0) { status = dev->enableModule(selectedChannel, true); }
+        if (status == 0 && mimo) { status = dev->enableModule(otherChannel(), true); }
+        return status;
     }
-    
-    static void stop(void* ctx) {
-        bladeRFSourceModule* _this = (bladeRFSourceModule*)ctx;
-        if (!_this->running) {
-            return;
+
+    void initDecimator() {
+        if (isResampled()) {
+            const StreamRate& sr = streamRates[srId];
+            decimator.init(sr.interp, sr.decim, buffer_size);
+            spdlog::info("bladeRFSourceModule '{0}': Resampling {1} by {2}/{3}, {4} taps per branch, {5} FIR", name,
+                         sr.hwRate, sr.interp, sr.decim, decimator.tapsPerPhase(), convert::firInt16x2KernelName());
+        }
+        else {
+            decimator.init(1, 1, 0);
         }
-        _this->stream.stopWriter();
-        _this->workerThread.join();
-        _this->running = false;
-        bladerf_close(_this->dev);
-        _this->stream.clearWriteStop();
-        spdlog::info("bladeRFSourceModule '{0}': Stop!", _this->name);
+    }
+
+    void beginServerStream() {
+        iqServer.beginStream(buffer_size * sampleBytes(), hwSampleRate(), isSc8Format() ? IQ_SERVER_FORMAT_SC8_Q7 : IQ_SERVER_FORMAT_SC16_Q11,
+                             channelCount(), IQ_SERVER_BUFFER_S);
+    }
+
+    // RX and conversion threads for the stream as currently configured. Returns false, with
+    // nothing started, when the sample buffers can't be allocated.
+    bool startWorkers() {
+        // Reused from the last run when large enough, so restarts don't allocate
+        bufferPool.setHugePages(hugePages);
+        rxBlock = (int16_t*)bufferPool.get(SampleBufferPool::SLOT_RX_BLOCK, buffer_size * 2 * sizeof(int16_t));
+        bool pipelined = pipeline && !sweepMode && !asyncRx;
+        int16_t* ringArena = NULL;
+        if (pipelined) {
+            // Raw blocks are sized for exactly one bladerf_sync_rx call
+            size_t ringBytes = SPSCBlockRing<int16_t>::arenaBytes(ringDepth, buffer_size * 2);
+            ringArena = (int16_t*)bufferPool.get(SampleBufferPool::SLOT_RAW_RING, ringBytes);
+        }
+        if (rxBlock == NULL || (pipelined && ringArena == NULL)) {
+            spdlog::error("bladeRFSourceModule '{0}': Could not allocate the sample buffers", name);
+            return false;
+        }
+        rxSched.priority = (threadsched::Priority)rxPriority;
+        rxSched.core = rxCore;
+
+        acquiring = true;
+        if (sweepMode) {
+            workerThread = std::thread(sweepWorker, this);
+        }
+        else if (asyncRx) {
+            workerThread = std::thread(asyncWorker, this);
+        }
+        else if (pipelined) {
+            rawRing.init(ringDepth, buffer_size * 2, ringArena, 64);
+            acquireThread = std::thread(acquireWorker, this);
+            workerThread = std::thread(convertWorker, this);
+        }
+        else {
+            workerThread = std::thread(worker, this);
+        }
+        return true;
+    }
+
+    // Leaves the stream's writer stopped, clearWriteStop() before starting again
+    void stopWorkers() {
+        acquiring = false;
+        rawRing.stop();
+        stream.stopWriter();
+        if (workerThread.joinable()) { workerThread.join(); }
+        if (acquireThread.joinable()) { acquireThread.join(); }
+    }
+
+
+    // Learned values are kept per sample rate since the right sizing depends on it
+    streamtune::Params loadTunedParams(double rate) {
+        streamtune::Params params = streamtune::initial(rate, latencyMs);
+        std::string rateKey = std::to_string((uint64_t)rate);
+        config.aquire();
+        if (config.conf["devices"][selectedSerial].contains("streamTuning") &&
+            config.conf["devices"][selectedSerial]["streamTuning"].contains(rateKey)) {
+            json learned = config.conf["devices"][selectedSerial]["streamTuning"][rateKey];
+            params.numBuffers = learned["numBuffers"];
+            params.bufferSize = learned["bufferSize"];
+            params.numTransfers = learned["numTransfers"];
+        }
+        config.release();
+        return streamtune::sanitize(params);
+    }
+
+    void saveTunedParams(double rate, const streamtune::Params& params) {
+        std::string rateKey = std::to_string((uint64_t)rate);
+        config.aquire();
+        config.conf["devices"][selectedSerial]["streamTuning"][rateKey]["numBuffers"] = params.numBuffers;
+        config.conf["devices"][selectedSerial]["streamTuning"][rateKey]["bufferSize"] = params.bufferSize;
+        config.conf["devices"][selectedSerial]["streamTuning"][rateKey]["numTransfers"] = params.numTransfers;
+        config.release(true);
+    }
+
+    std::string getBandwdithScaled(double bw) {
+        char buf[1024];
+        if (bw >= 1000000.0) {
+            sprintf(buf, "%.1lfMHz", bw / 1000000.0);
+        }
+        else if (bw >= 1000.0) {
+            sprintf(buf, "%.1lfKHz", bw / 1000.0);
+        }
+        else {
+            sprintf(buf, "%.1lfHz", bw);
+        }
+        return std::string(buf);
+    }
+
+    static void menuSelected(void* ctx) {
+        bladeRFSourceModule* _this = (bladeRFSourceModule*)ctx;
+        core::setInputSampleRate(_this->sampleRate);
+        spdlog::info("bladeRFSourceModule '{0}': Menu Select!", _this->name);
+    }
+
+    static void menuDeselected(void* ctx) {
+        bladeRFSourceModule* _this = (bladeRFSourceModule*)ctx;
+        spdlog::info("bladeRFSourceModule '{0}': Menu Deselect!", _this->name);
     }
     
-    static void tune(double freq, void* ctx) {
+    static void start(void* ctx)
+    {
         bladeRFSourceModule* _this = (bladeRFSourceModule*)ctx;
-        _this->freq = freq;
-        int status;
         if (_this->running) {
-            status = bladerf_set_frequency(_this->dev, 0, _this->freq);
+            return;
+        }
+        if (_this->selectedSerial.empty()) {
+            spdlog::error("Tried to start bladeRF source with null serial");
+            return;
+        }
+        _this->collectFpgaLoad();
+        if (_this->fpgaLoader.busy()) {
+            spdlog::error("bladeRF {0}: FPGA is still loading", _this->fpgaLoader.serial());
+            return;
+        }
+        if (_this->sweepMode && (_this->asyncRx || _this->mimo)) {
+            // Hops are sorted out by timestamp, which needs the sync metadata path on a single channel
+            spdlog::error("Sweep mode can't be combined with async RX or 2x RX");
+            return;
+        }
+        if (_this->isResampled() && (_this->sweepMode || _this->mimo)) {
+            spdlog::error("Rates below {0} can't be used with sweep mode or 2x RX", _this->getBandwdithScaled(_this->hwSampleRate()));
+            return;
+        }
+
+        int status;
+        uint64_t startBegin = metricsNow();
+
+        // A board left open by a warm stop keeps every setting that hasn't changed since. Attaching an
+        // expansion board or switching between sync and async need a fresh handle.
+        bool warm = (_this->dev != NULL) && _this->applied.xbMode == _this->xbMode && _this->applied.asyncRx == _this->asyncRx;
+        if (!warm) {
+            _this->closeDevice();
+            if (!_this->openDevice()) { return; }
+        }
+        // Channel setup changes invalidate everything set per channel
+        bool full = !warm || _this->applied.mimo != _this->mimo || _this->applied.primaryChannel != _this->primaryChannel;
+
+        _this->selectedChannel = BLADERF_CHANNEL_RX(_this->primaryChannel);
+        double streamRate = _this->hwSampleRate();
+
+        if (full || _this->applied.sampleRate != streamRate) {
+            bladerf_sample_rate actualRate;
+
+            status = _this->dev->setSampleRate(_this->selectedChannel, streamRate, &actualRate);
+            if (status != 0) {
+                spdlog::error("Could not set sample rate on bladeRF {0}", _this->selectedSerial);
+                spdlog::error(bladerf_strerror(status));
+                _this->closeDevice();
+                return;
+            }
+
+            spdlog::info("Sample rate set to {0}", actualRate);
+        }
+
+        if (full || _this->applied.bandwidth != _this->bandwidth) {
+            status = _this->dev->setBandwidth(_this->selectedChannel, _this->bandwidth, NULL);
+            if (status != 0) {
+                fprintf(stderr, "Failed to set bandwidth = %u: %s\n", _this->bandwidth,
+                bladerf_strerror(status));
+                _this->closeDevice();
+                return;
+            }
+        }
+
+        if (full || _this->applied.freq != _this->freq) {
+            status = _this->dev->setFrequency(_this->selectedChannel, _this->freq);
             if (status != 0) {
                 spdlog::error("Could not set frequency rate on bladeRF {0}", _this->selectedSerial);
                 spdlog::error(bladerf_strerror(status));
+                _this->closeDevice();
+                return;
+            }
+        }
+
+        if (_this->mimo && (full || _this->applied.sampleRate != streamRate || _this->applied.bandwidth != _this->bandwidth ||
+                            _this->applied.freq != _this->freq)) {
+            // The second channel mirrors the first so both are captured coherently
+            bladerf_channel other = _this->otherChannel();
+            status = _this->dev->setSampleRate(other, streamRate, NULL);
+            if (status == 0) { status = _this->dev->setBandwidth(other, _this->bandwidth, NULL); }
+            if (status == 0) { status = _this->dev->setFrequency(other, _this->freq); }
+            if (status != 0) {
+                spdlog::error("Could not configure second RX channel on bladeRF {0}", _this->selectedSerial);
+                spdlog::error(bladerf_strerror(status));
+                _this->closeDevice();
+                return;
+            }
+        }
+
+        _this->channel_layout   = _this->mimo ? BLADERF_RX_X2 : BLADERF_RX_X1;
+        // Once the open board turned SC8 down, asking again would only cost a warm start its stream
+        _this->format           = _this->wireFormat(_this->sampleFormat == SAMPLE_FORMAT_SC8 && !_this->sc8FellBack);
+        _this->chooseStreamParams(streamRate, streamingInstances + 1);
+
+        _this->rxBlocks = 0;
+        _this->rxOverruns = 0;
+        _this->rxTimeouts = 0;
+        _this->rxLostSamples = 0;
+        _this->rxDiscontinuities = 0;
+        _this->rxTimestamp = 0;
+        _this->haveTimestamp = false;
+        _this->metrics.reset();
+
+        // The sync interface stays configured while the board is open, async streams are set up per run
+        bool sameStream = _this->applied.layout == _this->channel_layout && _this->applied.format == _this->format &&
+                          _this->applied.numBuffers == _this->num_buffers && _this->applied.bufferSize == _this->buffer_size &&
+                          _this->applied.numTransfers == _this->num_transfers && _this->applied.timeout == _this->stream_timeout;
+        if (!warm || _this->asyncRx || !sameStream) {
+            status = _this->configureStream();
+            if (status != 0 && _this->isSc8Format()) {
+                // 8 bit samples need a recent enough FPGA, fall back rather than fail
+                spdlog::warn("bladeRF {0} does not support SC8_Q7 ({1}), using SC16_Q11", _this->selectedSerial, bladerf_strerror(status));
+                _this->format = _this->wireFormat(false);
+                _this->sc8FellBack = true;
+                status = _this->configureStream();
+            }
+            if (status != 0) {
+                spdlog::error("Could not configure stream on bladeRF {0}", _this->selectedSerial);
+                spdlog::error(bladerf_strerror(status));
+                _this->closeDevice();
                 return;
             }
         }
+
+        status = _this->dev->enableModule(_this->selectedChannel, true);
+        if (status == 0 && _this->mimo) {
+            status = _this->dev->enableModule(_this->otherChannel(), true);
+        }
+        if (status != 0) {
+            spdlog::error(bladerf_strerror(status));
+            _this->closeDevice();
+            return;
+        }
+
+        if (_this->mimo) {
+            // bladeRF 2.0 has a single overall gain per channel instead of the LNA/VGA stages
+            for (int i = 0; i < 2; i++) {
+                if (!full && _this->applied.rxGain[i] == _this->rxGain[i]) { continue; }
+                _this->dev->setGainMode(BLADERF_CHANNEL_RX(i), BLADERF_GAIN_MGC);
+                status = _this->dev->setGain(BLADERF_CHANNEL_RX(i), _this->rxGain[i]);
+                if (status != 0) {
+                    spdlog::error("RX{0} gain set error on bladeRF {1}", i + 1, _this->selectedSerial);
+                    spdlog::error(bladerf_strerror(status));
+                    _this->closeDevice();
+                    return;
+                }
+            }
+        }
+        else {
+            if (full || _this->applied.lna != _this->lna) {
+                status = _this->dev->setGainStage(_this->selectedChannel, "lna", _this->lna);
+                if (status != 0) {
+                    spdlog::error("LNA setrror on bladeRF {0}", _this->selectedSerial);
+                    spdlog::error(bladerf_strerror(status));
+                    _this->closeDevice();
+                    return;
+                }
+            }
+
+            if (full || _this->applied.rxvga1 != _this->rxvga1) {
+                status = _this->dev->setGainStage(_this->selectedChannel, "rxvga1", _this->rxvga1);
+                if (status != 0) {
+                    spdlog::error("rxVGA1 set error on bladeRF {0}", _this->selectedSerial);
+                    spdlog::error(bladerf_strerror(status));
+                    _this->closeDevice();
+                    return;
+                }
+            }
+
+            if (full || _this->applied.rxvga2 != _this->rxvga2) {
+                status = _this->dev->setGainStage(_this->selectedChannel, "rxvga2", _this->rxvga2);
+                if (status != 0) {
+                    spdlog::error("rxVGA2 set error on bladeRF {0}", _this->selectedSerial);
+                    spdlog::error(bladerf_strerror(status));
+                    _this->closeDevice();
+                    return;
+                }
+            }
+
+            if(_this->xbMode == BLADERF_XB_200) {
+                if (!warm) {
+                    status = _this->dev->expansionAttach(BLADERF_XB_200);
+                    if (status != 0) {
+                        spdlog::error("Expansion add error on bladeRF {0}", _this->selectedSerial);
+                        spdlog::error(bladerf_strerror(status));
+                        _this->closeDevice();
+                        return;
+                    }
+                }
+
+                if (full) {
+                    status = _this->dev->xb200SetPath(_this->selectedChannel, BLADERF_XB200_MIX);
+                    if (status != 0) {
+                        spdlog::error("xb200 path error on bladeRF {0}", _this->selectedSerial);
+                        spdlog::error(bladerf_strerror(status));
+                        _this->closeDevice();
+                        return;
+                    }
+                }
+
+                if (full || _this->applied.xb200Mode != _this->xb200Mode) {
+                    status = _this->dev->xb200SetFilterbank(_this->selectedChannel, (bladerf_xb200_filter)_this->xb200Mode);
+                    if (status != 0) {
+                        spdlog::error("xb200 filterbank error on bladeRF {0}", _this->selectedSerial);
+                        spdlog::error(bladerf_strerror(status));
+                        _this->closeDevice();
+                        return;
+                    }
+                }
+            } else if (full) {
+                _this->dev->xb200SetPath(_this->selectedChannel, BLADERF_XB200_BYPASS);
+            }
+        }
+
+        _this->rememberApplied();
+
+        if (_this->mimo) {
+            _this->auxScratch.resize(_this->buffer_size / 2);
+            if (_this->auxPath[0] != 0) {
+                _this->auxSink.start(_this->auxPath, _this->buffer_size / 2, 64);
+            }
+            spdlog::info("bladeRFSourceModule '{0}': 2x RX, {1} deinterleave, RX{2} to SDR++", _this->name,
+                         convert::sc16q11X2KernelName(), _this->primaryChannel + 1);
+        }
+
+        spdlog::info("bladeRFSourceModule '{0}': Using {1} sample conversion", _this->name,
+                     _this->isSc8Format() ? convert::sc8q7KernelName() : convert::sc16q11KernelName());
+
+        // The primary stream only, 2x RX and sweeps convert through their own paths
+        _this->iqActive = _this->iqCorrect && !_this->mimo && !_this->sweepMode;
+        if (_this->iqActive) {
+            _this->iqCal.begin(_this->dev, _this->selectedChannel, _this->freq, _this->iqHardware, _this->hwSampleRate() * IQ_CAL_WINDOW_S);
+            spdlog::info("bladeRFSourceModule '{0}': DC / IQ correction on, {1} kernel, {2} bands cached", _this->name,
+                         _this->isSc8Format() ? "scalar" : convert::sc16q11CorrectedKernelName(), _this->iqCal.bandCount());
+        }
+
+        _this->startAgc();
+        if (_this->burstArmed) { _this->startBurst(); }
+
+        _this->initDecimator();
+
+        // Network clients get the blocks as read, before any resampling or correction
+        _this->iqServer.setFrequency(_this->freq);
+        _this->beginServerStream();
+
+        if (_this->metricsExport && _this->metricsPath[0] != 0) {
+            _this->metricsRunning = true;
+            _this->metricsThread = std::thread(metricsWorker, _this);
+        }
+
+        _this->retuneRunning = true;
+        _this->retunePending = false;
+        _this->retuneThread = std::thread(retuneWorker, _this);
+
+        _this->running = true;
+        streamingInstances++;
+        if (!_this->startWorkers()) {
+            // Everything else is up already, stop takes it down again
+            stop(_this);
+            return;
+        }
+        _this->startMs = (metricsNow() - startBegin) / 1e6;
+        _this->startWarm = warm;
+        spdlog::info("bladeRFSourceModule '{0}': Start! ({1} start in {2:.1f} ms)", _this->name, warm ? "warm" : "cold", _this->startMs);
+    }
+    
+    static void stop(void* ctx) {
+        bladeRFSourceModule* _this = (bladeRFSourceModule*)ctx;
+        if (!_this->running) {
+            return;
+        }
+        uint64_t stopBegin = metricsNow();
+        _this->stopWorkers();
+        if (_this->metricsThread.joinable()) {
+            {
+                std::lock_guard<std::mutex> lck(_this->metricsMtx);
+                _this->metricsRunning = false;
+            }
+            _this->metricsCnd.notify_all();
+            _this->metricsThread.join();
+        }
+        {
+            std::lock_guard<std::mutex> lck(_this->retuneMtx);
+            _this->retuneRunning = false;
+        }
+        _this->retuneCnd.notify_all();
+        _this->retuneThread.join();
+        _this->running = false;
+        streamingInstances--;
+        _this->iqServer.endStream();
+        _this->stopBurst();
+        _this->rawRecorder.stop();
+        _this->stopAgc();
+        if (_this->iqActive) {
+            _this->iqCal.end();
+            _this->iqActive = false;
+            config.aquire();
+            config.conf["devices"][_this->selectedSerial]["iqCal"] = _this->iqCal.save();
+            config.release(true);
+        }
+        if (_this->warmRestart) {
+            // Only stop streaming, the board keeps its configuration for the next start
+            _this->dev->enableModule(_this->selectedChannel, false);
+            if (_this->mimo) { _this->dev->enableModule(_this->otherChannel(), false); }
+            if (_this->asyncRx) { _this->dev->deinitStream(); }
+        }
+        else {
+            _this->closeDevice();
+        }
+        _this->stream.clearWriteStop();
+        _this->stopMs = (metricsNow() - stopBegin) / 1e6;
+        if (_this->auxSink.isRunning()) {
+            _this->auxSink.stop();
+            spdlog::info("bladeRF {0}: {1} bytes recorded from RX{2}, {3} blocks dropped", _this->selectedSerial,
+                         _this->auxSink.bytesWritten(), 2 - _this->primaryChannel, _this->auxSink.dropped());
+        }
+
+        if (_this->isMetaFormat()) {
+            spdlog::info("bladeRF {0}: lost {1} samples in {2} discontinuities", _this->selectedSerial, (uint64_t)_this->rxLostSamples, (uint64_t)_this->rxDiscontinuities);
+        }
+
+        _this->saveStreamRun(_this->hwSampleRate());
+
+        spdlog::info("bladeRFSourceModule '{0}': Stop!", _this->name);
+    }
+    
+    static void tune(double freq, void* ctx) {
+        bladeRFSourceModule* _this = (bladeRFSourceModule*)ctx;
+        _this->freq = freq;
+        // While sweeping the tuner belongs to the sweep schedule
+        if (_this->running && !_this->sweepMode) {
+            // Programming the PLL takes milliseconds, leave it to the retune thread so the UI never waits on USB
+            {
+                std::lock_guard<std::mutex> lck(_this->retuneMtx);
+                if (_this->retunePending) { _this->retunesCoalesced++; }
+                _this->retuneFreq = freq;
+                _this->retunePending = true;
+            }
+            _this->retuneCnd.notify_one();
+        }
         spdlog::info("bladeRFSourceModule '{0}': Tune: {1}!", _this->name, freq);
     }
     
@@ -402,50 +1426,74 @@ private:
 
         if (_this->running) { style::beginDisabled(); }
 
+        if (_this->claimsSeen != bladerfdev::claimsVersion()) { _this->buildDevListTxt(); }
         ImGui::SetNextItemWidth(menuWidth);
         if (ImGui::Combo(CONCAT("##_bladeRF_dev_sel_", _this->name), &_this->devId, _this->devListTxt.c_str())) {
             _this->selectBySerial(_this->devList[_this->devId]);
             core::setInputSampleRate(_this->sampleRate);
-            if (_this->selectedSerial != "") {
-                config.aquire();
-                config.conf["device"] = _this->selectedSerial;
-                config.release(true);
-            }
+            _this->saveSelection();
         }
 
+        // Rate and bandwidth are changed in place while streaming, except for the rate of a sweep
+        if (_this->running) { style::endDisabled(); }
+        bool lockRate = _this->running && _this->sweepMode;
+        if (lockRate) { style::beginDisabled(); }
         ImGui::Text("Sample Rate:");
         ImGui::SameLine();
         ImGui::SetNextItemWidth(menuWidth - ImGui::GetCursorPosX());
+        int lastSrId = _this->srId;
         if (ImGui::Combo(CONCAT("##_bladeRF_sr_sel_", _this->name), &_this->srId, _this->sampleRateListTxt.c_str())) {
-            _this->sampleRate = _this->sampleRateList[_this->srId];
-            core::setInputSampleRate(_this->sampleRate);
+            if (!_this->running) {
+                _this->sampleRate = _this->sampleRateList[_this->srId];
+                core::setInputSampleRate(_this->sampleRate);
+            }
+            else if (!_this->changeSampleRate(lastSrId)) {
+                _this->srId = lastSrId;
+            }
+            if (_this->selectedSerial != "") {
+                config.aquire();
+                config.conf["devices"][_this->selectedSerial]["sampleRate"] = _this->sampleRate;
+                config.release(true);
+            }
+        }
+
+        if (lockRate) { style::endDisabled(); }
+
+        // Swaps the whole rate list, only while stopped
+        if (_this->running) { style::beginDisabled(); }
+        if (ImGui::Checkbox(CONCAT("Rates below the hardware minimum##_bladeRF_low_rates_", _this->name), &_this->lowRates)) {
+            _this->applyCaps(_this->caps);
+            _this->selectNearestRate();
             if (_this->selectedSerial != "") {
                 config.aquire();
+                config.conf["devices"][_this->selectedSerial]["lowRates"] = _this->lowRates;
                 config.conf["devices"][_this->selectedSerial]["sampleRate"] = _this->sampleRate;
                 config.release(true);
             }
         }
+        if (_this->running) { style::endDisabled(); }
 
         ImGui::Text("Bandwidth:");
         ImGui::SameLine();
         ImGui::SetNextItemWidth(menuWidth - ImGui::GetCursorPosX());
+        int lastBwId = _this->bwId;
         if (ImGui::Combo(CONCAT("##_bladeRF_bw_sel_", _this->name), &_this->bwId, _this->bandwidthTxt.c_str())) {
             _this->bandwidth = _this->bandwidthList[_this->bwId];
-            if (_this->bandwidthTxt != "") {
+            bool changed = !_this->running || _this->changeBandwidth(lastBwId);
+            if (changed && _this->bandwidthTxt != "") {
                 config.aquire();
                 config.conf["devices"][_this->selectedSerial]["bandwidth"] = _this->bandwidth;
                 config.release(true);
             }
         }
 
+        if (_this->running) { style::beginDisabled(); }
+
         //ImGui::SameLine();
         float refreshBtnWdith = menuWidth - ImGui::GetCursorPosX();
         if (ImGui::Button(CONCAT("Refresh##_bladeRF_refr_", _this->name), ImVec2(refreshBtnWdith, 0))) {
-            _this->refresh();
-            config.aquire();
-            std::string devSerial = config.conf["device"];
-            config.release();
-            _this->selectFirst();;
+            _this->refresh(true);
+            _this->selectDefault();
             core::setInputSampleRate(_this->sampleRate);
         }
 
@@ -455,108 +1503,1460 @@ private:
         if (_this->fileSelect.render("##_FPGA_bitstream_" + _this->name)) {
             if (_this->fileSelect.pathIsValid()) {
                 _this->bitstreamPath = _this->fileSelect.path;
+                _this->startFpgaLoad();
+                if (_this->fpgaAutoload && _this->selectedSerial != "") {
+                    config.aquire();
+                    config.conf["devices"][_this->selectedSerial]["bitstream"] = _this->bitstreamPath;
+                    config.release(true);
+                }
             }
         }
 
-        ImGui::Text("Expansion Board");
-        ImGui::SameLine();
-        ImGui::SetNextItemWidth(menuWidth - ImGui::GetCursorPosX());
-        if (ImGui::Combo(CONCAT("##_bladeRF_xb_", _this->name), &_this->xbMode, XB_BOARD_STR)) {
+        if (ImGui::Checkbox(CONCAT("Autoload FPGA for this board##_bladeRF_fpga_autoload_", _this->name), &_this->fpgaAutoload)) {
             if (_this->selectedSerial != "") {
                 config.aquire();
-                config.conf["devices"][_this->selectedSerial]["xbMode"] = _this->xbMode;
+                config.conf["devices"][_this->selectedSerial]["bitstream"] = _this->fpgaAutoload ? _this->bitstreamPath : "";
                 config.release(true);
             }
         }
 
-        if(_this->xbMode == BLADERF_XB_200)
-        {
-            ImGui::Text("XB-200 Filtering");
-            ImGui::SameLine();
-            ImGui::SetNextItemWidth(menuWidth - ImGui::GetCursorPosX());
-            if (ImGui::Combo(CONCAT("##_bladeRF_xb200_", _this->name), &_this->xb200Mode, XB_200_STR)) {
-                if (_this->selectedSerial != "") {
-                    config.aquire();
-                    config.conf["devices"][_this->selectedSerial]["xbMode"] = _this->xbMode;
-                    config.release(true);
-                }
-            }
+        _this->collectFpgaLoad();
+        if (_this->fpgaLoader.state() != FpgaLoader::FPGA_LOADER_IDLE && _this->fpgaLoader.serial() == _this->selectedSerial) {
+            ImGui::ProgressBar(_this->fpgaLoader.progress(), ImVec2(menuWidth - ImGui::GetCursorPosX(), 0), _this->fpgaLoader.stateText());
         }
 
-        if (_this->running) { style::endDisabled(); }
-
-        ImGui::Text("LNA Gain");
+        ImGui::Text("Expansion Board");
         ImGui::SameLine();
         ImGui::SetNextItemWidth(menuWidth - ImGui::GetCursorPosX());
-        if (ImGui::SliderFloatWithSteps(CONCAT("##_bladeRF_lna_", _this->name), &_this->lna, 0, 6, 3, "%.0f dB")) {
-            if (_this->running) {
-                bladerf_set_gain_stage(_this->dev, _this->selectedChannel, "lna", _this->lna);
-            }
+        if (ImGui::Combo(CONCAT("##_bladeRF_xb_", _this->name), &_this->xbMode, XB_BOARD_STR)) {
             if (_this->selectedSerial != "") {
                 config.aquire();
-                config.conf["devices"][_this->selectedSerial]["lna"] = _this->lna;
+                config.conf["devices"][_this->selectedSerial]["xbMode"] = _this->xbMode;
                 config.release(true);
             }
         }
-        
-        ImGui::Text("rxVGA1 Gain");
+
+        ImGui::Text("Sample format");
         ImGui::SameLine();
         ImGui::SetNextItemWidth(menuWidth - ImGui::GetCursorPosX());
-        if (ImGui::SliderFloatWithSteps(CONCAT("##_bladeRF_rxvga1_", _this->name), &_this->rxvga1, 5, 30, 1, "%.0f dB")) {
-            if (_this->running) {
-                bladerf_set_gain_stage(_this->dev, _this->selectedChannel, "rxvga1", _this->rxvga1);
+        if (ImGui::Combo(CONCAT("##_bladeRF_format_", _this->name), &_this->sampleFormat, SAMPLE_FORMAT_STR)) {
+            if (_this->selectedSerial != "") {
+                config.aquire();
+                config.conf["devices"][_this->selectedSerial]["sampleFormat"] = _this->sampleFormat;
+                config.release(true);
             }
+        }
+
+        if (ImGui::Checkbox(CONCAT("2x RX (MIMO)##_bladeRF_mimo_", _this->name), &_this->mimo)) {
             if (_this->selectedSerial != "") {
                 config.aquire();
-                config.conf["devices"][_this->selectedSerial]["rxvga1"] = _this->rxvga1;
+                config.conf["devices"][_this->selectedSerial]["mimo"] = _this->mimo;
                 config.release(true);
             }
         }
 
-        ImGui::Text("rxVGA2 Gain");
+        ImGui::Text("Channel");
         ImGui::SameLine();
         ImGui::SetNextItemWidth(menuWidth - ImGui::GetCursorPosX());
-        if (ImGui::SliderFloatWithSteps(CONCAT("##_bladeRF_rxvga2_", _this->name), &_this->rxvga2, 0, 30, 1, "%.0f dB")) {
-            if (_this->running) {
-                bladerf_set_gain_stage(_this->dev, _this->selectedChannel, "rxvga2", _this->rxvga2);
-            }
+        if (ImGui::Combo(CONCAT("##_bladeRF_channel_", _this->name), &_this->primaryChannel, RX_CHANNEL_STR)) {
+            _this->selectedChannel = BLADERF_CHANNEL_RX(_this->primaryChannel);
             if (_this->selectedSerial != "") {
                 config.aquire();
-                config.conf["devices"][_this->selectedSerial]["rxvga2"] = _this->rxvga2;
+                config.conf["devices"][_this->selectedSerial]["primaryChannel"] = _this->primaryChannel;
                 config.release(true);
             }
-        }  
-    }
-
-    static void worker(void* ctx) {
-        bladeRFSourceModule* _this = (bladeRFSourceModule*)ctx;
+        }
 
-        int16_t* inBuf = new int16_t[2 * _this->buffer_size * sizeof(int16_t)];
-        int status;
+        if (_this->mimo) {
+            // The channel not shown in SDR++ is recorded as raw complex float32
+            ImGui::Text("Record RX%d", 2 - _this->primaryChannel);
+            ImGui::SameLine();
+            ImGui::SetNextItemWidth(menuWidth - ImGui::GetCursorPosX());
+            if (ImGui::InputText(CONCAT("##_bladeRF_aux_path_", _this->name), _this->auxPath, sizeof(_this->auxPath))) {
+                if (_this->selectedSerial != "") {
+                    config.aquire();
+                    config.conf["devices"][_this->selectedSerial]["auxPath"] = std::string(_this->auxPath);
+                    config.release(true);
+                }
+            }
+        }
 
-        while(true)
-        {
-            status = bladerf_sync_rx(_this->dev, inBuf, _this->buffer_size, NULL, _this->stream_timeout);
-            if (status != 0) {
-                spdlog::error(bladerf_strerror(status));
+        if (ImGui::Checkbox(CONCAT("Keep device open##_bladeRF_warm_", _this->name), &_this->warmRestart)) {
+            if (!_this->warmRestart && !_this->running) {
+                _this->closeDevice();
             }
-            for (int i = 0; i < _this->buffer_size; i++) {
-                _this->stream.writeBuf[i].q = (float)inBuf[i * 2] / (float)4096;
-                _this->stream.writeBuf[i].i = (float)inBuf[(i * 2) + 1] / (float)4096;
+            if (_this->selectedSerial != "") {
+                config.aquire();
+                config.conf["devices"][_this->selectedSerial]["warmRestart"] = _this->warmRestart;
+                config.release(true);
             }
-            if (!_this->stream.swap(_this->buffer_size)) { break; };
         }
-    }
 
-    std::string name;
-    bool enabled = true;
-    dsp::stream<dsp::complex_t> stream;
-    double sampleRate;
-    uint32_t bandwidth;
-    SourceManager::SourceHandler handler;
-    bool running = false;
-    double freq;
-    std::string selectedSerial = "";
+        if (ImGui::Checkbox(CONCAT("Async RX (zero-copy)##_bladeRF_async_", _this->name), &_this->asyncRx)) {
+            if (_this->selectedSerial != "") {
+                config.aquire();
+                config.conf["devices"][_this->selectedSerial]["asyncRx"] = _this->asyncRx;
+                config.release(true);
+            }
+        }
+
+        if (!_this->asyncRx) {
+            if (ImGui::Checkbox(CONCAT("Decoupled RX pipeline##_bladeRF_pipeline_", _this->name), &_this->pipeline)) {
+                if (_this->selectedSerial != "") {
+                    config.aquire();
+                    config.conf["devices"][_this->selectedSerial]["pipeline"] = _this->pipeline;
+                    config.release(true);
+                }
+            }
+
+            if (_this->pipeline) {
+                ImGui::Text("Ring depth");
+                ImGui::SameLine();
+                ImGui::SetNextItemWidth(menuWidth - ImGui::GetCursorPosX());
+                if (ImGui::InputInt(CONCAT("##_bladeRF_ring_depth_", _this->name), &_this->ringDepth, 1, 16)) {
+                    _this->ringDepth = std::clamp<int>(_this->ringDepth, 2, 1024);
+                    if (_this->selectedSerial != "") {
+                        config.aquire();
+                        config.conf["devices"][_this->selectedSerial]["ringDepth"] = _this->ringDepth;
+                        config.release(true);
+                    }
+                }
+            }
+        }
+
+        if (!_this->asyncRx) {
+            if (ImGui::Checkbox(CONCAT("Timestamped RX##_bladeRF_meta_", _this->name), &_this->metaRx)) {
+                if (_this->selectedSerial != "") {
+                    config.aquire();
+                    config.conf["devices"][_this->selectedSerial]["metaRx"] = _this->metaRx;
+                    config.release(true);
+                }
+            }
+
+            if (_this->metaRx || _this->streamAutoTune) {
+                if (ImGui::Checkbox(CONCAT("Zero-fill gaps##_bladeRF_zero_fill_", _this->name), &_this->zeroFill)) {
+                    if (_this->selectedSerial != "") {
+                        config.aquire();
+                        config.conf["devices"][_this->selectedSerial]["zeroFill"] = _this->zeroFill;
+                        config.release(true);
+                    }
+                }
+            }
+        }
+
+        if (ImGui::Checkbox(CONCAT("Auto-tune stream buffers##_bladeRF_autotune_", _this->name), &_this->streamAutoTune)) {
+            if (_this->selectedSerial != "") {
+                config.aquire();
+                config.conf["devices"][_this->selectedSerial]["streamAutoTune"] = _this->streamAutoTune;
+                config.release(true);
+            }
+        }
+
+        if (_this->streamAutoTune) {
+            ImGui::Text("Latency (ms)");
+            ImGui::SameLine();
+            ImGui::SetNextItemWidth(menuWidth - ImGui::GetCursorPosX());
+            if (ImGui::InputInt(CONCAT("##_bladeRF_latency_", _this->name), &_this->latencyMs, 1, 10)) {
+                _this->latencyMs = std::clamp<int>(_this->latencyMs, 1, 1000);
+                if (_this->selectedSerial != "") {
+                    config.aquire();
+                    config.conf["devices"][_this->selectedSerial]["latencyMs"] = _this->latencyMs;
+                    config.release(true);
+                }
+            }
+        }
+        else {
+            ImGui::Text("Buffers");
+            ImGui::SameLine();
+            ImGui::SetNextItemWidth(menuWidth - ImGui::GetCursorPosX());
+            if (ImGui::InputInt(CONCAT("##_bladeRF_num_buffers_", _this->name), &_this->manualBuffers, 1, 8)) {
+                _this->manualBuffers = std::clamp<int>(_this->manualBuffers, 4, 256);
+                if (_this->selectedSerial != "") {
+                    config.aquire();
+                    config.conf["devices"][_this->selectedSerial]["numBuffers"] = _this->manualBuffers;
+                    config.release(true);
+                }
+            }
+
+            ImGui::Text("Buffer size");
+            ImGui::SameLine();
+            ImGui::SetNextItemWidth(menuWidth - ImGui::GetCursorPosX());
+            if (ImGui::InputInt(CONCAT("##_bladeRF_buffer_size_", _this->name), &_this->manualBufferSize, 1024, 16384)) {
+                _this->manualBufferSize = std::clamp<int>((_this->manualBufferSize / 1024) * 1024, 1024, 512 * 1024);
+                if (_this->selectedSerial != "") {
+                    config.aquire();
+                    config.conf["devices"][_this->selectedSerial]["bufferSize"] = _this->manualBufferSize;
+                    config.release(true);
+                }
+            }
+
+            ImGui::Text("Transfers");
+            ImGui::SameLine();
+            ImGui::SetNextItemWidth(menuWidth - ImGui::GetCursorPosX());
+            if (ImGui::InputInt(CONCAT("##_bladeRF_num_transfers_", _this->name), &_this->manualTransfers, 1, 4)) {
+                _this->manualTransfers = std::clamp<int>(_this->manualTransfers, 1, 32);
+                if (_this->selectedSerial != "") {
+                    config.aquire();
+                    config.conf["devices"][_this->selectedSerial]["numTransfers"] = _this->manualTransfers;
+                    config.release(true);
+                }
+            }
+        }
+
+        ImGui::Text("RX priority");
+        ImGui::SameLine();
+        ImGui::SetNextItemWidth(menuWidth - ImGui::GetCursorPosX());
+        if (ImGui::Combo(CONCAT("##_bladeRF_rx_priority_", _this->name), &_this->rxPriority, RX_PRIORITY_STR)) {
+            if (_this->selectedSerial != "") {
+                config.aquire();
+                config.conf["devices"][_this->selectedSerial]["rxPriority"] = _this->rxPriority;
+                config.release(true);
+            }
+        }
+
+        ImGui::Text("RX core (-1: any)");
+        ImGui::SameLine();
+        ImGui::SetNextItemWidth(menuWidth - ImGui::GetCursorPosX());
+        if (ImGui::InputInt(CONCAT("##_bladeRF_rx_core_", _this->name), &_this->rxCore, 1, 1)) {
+            _this->rxCore = std::clamp<int>(_this->rxCore, -1, threadsched::coreCount() - 1);
+            if (_this->selectedSerial != "") {
+                config.aquire();
+                config.conf["devices"][_this->selectedSerial]["rxCore"] = _this->rxCore;
+                config.release(true);
+            }
+        }
+
+        if (ImGui::Checkbox(CONCAT("Huge page sample buffers##_bladeRF_huge_pages_", _this->name), &_this->hugePages)) {
+            if (_this->selectedSerial != "") {
+                config.aquire();
+                config.conf["devices"][_this->selectedSerial]["hugePages"] = _this->hugePages;
+                config.release(true);
+            }
+        }
+
+        if(_this->xbMode == BLADERF_XB_200)
+        {
+            ImGui::Text("XB-200 Filtering");
+            ImGui::SameLine();
+            ImGui::SetNextItemWidth(menuWidth - ImGui::GetCursorPosX());
+            if (ImGui::Combo(CONCAT("##_bladeRF_xb200_", _this->name), &_this->xb200Mode, XB_200_STR)) {
+                if (_this->selectedSerial != "") {
+                    config.aquire();
+                    config.conf["devices"][_this->selectedSerial]["xbMode"] = _this->xbMode;
+                    config.release(true);
+                }
+            }
+        }
+
+        if (_this->running) { style::endDisabled(); }
+
+        if (_this->mimo) {
+            for (int i = 0; i < 2; i++) {
+                ImGui::Text("RX%d Gain", i + 1);
+                ImGui::SameLine();
+                ImGui::SetNextItemWidth(menuWidth - ImGui::GetCursorPosX());
+                if (ImGui::SliderFloatWithSteps(CONCAT("##_bladeRF_rx_gain_" + std::to_string(i) + "_", _this->name), &_this->rxGain[i], -15, 60, 1, "%.0f dB")) {
+                    if (_this->running) {
+                        _this->dev->setGain(BLADERF_CHANNEL_RX(i), _this->rxGain[i]);
+                    }
+                    if (_this->selectedSerial != "") {
+                        config.aquire();
+                        config.conf["devices"][_this->selectedSerial]["rxGain" + std::to_string(i)] = _this->rxGain[i];
+                        config.release(true);
+                    }
+                }
+            }
+        }
+        else {
+            ImGui::Text("AGC");
+            ImGui::SameLine();
+            ImGui::SetNextItemWidth(menuWidth - ImGui::GetCursorPosX());
+            if (ImGui::Combo(CONCAT("##_bladeRF_agc_", _this->name), &_this->agcMode, AGG_MODES_STR)) {
+                if (_this->running) {
+                    if (_this->agcMode) { _this->startAgc(); }
+                    else { _this->stopAgc(); }
+                }
+                if (_this->selectedSerial != "") {
+                    config.aquire();
+                    config.conf["devices"][_this->selectedSerial]["agcMode"] = _this->agcMode;
+                    config.release(true);
+                }
+            }
+
+            // The sliders follow the AGC while it owns the stages
+            bool agcOwned = _this->agcActive;
+            if (agcOwned) {
+                Agc::Gains g = _this->agc.gains();
+                _this->lna = g.lna;
+                _this->rxvga1 = g.rxvga1;
+                _this->rxvga2 = g.rxvga2;
+                style::beginDisabled();
+            }
+
+            ImGui::Text("LNA Gain");
+            ImGui::SameLine();
+            ImGui::SetNextItemWidth(menuWidth - ImGui::GetCursorPosX());
+            if (ImGui::SliderFloatWithSteps(CONCAT("##_bladeRF_lna_", _this->name), &_this->lna, 0, 6, 3, "%.0f dB")) {
+                if (_this->running) {
+                    _this->dev->setGainStage(_this->selectedChannel, "lna", _this->lna);
+                }
+                if (_this->selectedSerial != "") {
+                    config.aquire();
+                    config.conf["devices"][_this->selectedSerial]["lna"] = _this->lna;
+                    config.release(true);
+                }
+            }
+        
+            ImGui::Text("rxVGA1 Gain");
+            ImGui::SameLine();
+            ImGui::SetNextItemWidth(menuWidth - ImGui::GetCursorPosX());
+            if (ImGui::SliderFloatWithSteps(CONCAT("##_bladeRF_rxvga1_", _this->name), &_this->rxvga1, 5, 30, 1, "%.0f dB")) {
+                if (_this->running) {
+                    _this->dev->setGainStage(_this->selectedChannel, "rxvga1", _this->rxvga1);
+                }
+                if (_this->selectedSerial != "") {
+                    config.aquire();
+                    config.conf["devices"][_this->selectedSerial]["rxvga1"] = _this->rxvga1;
+                    config.release(true);
+                }
+            }
+
+            ImGui::Text("rxVGA2 Gain");
+            ImGui::SameLine();
+            ImGui::SetNextItemWidth(menuWidth - ImGui::GetCursorPosX());
+            if (ImGui::SliderFloatWithSteps(CONCAT("##_bladeRF_rxvga2_", _this->name), &_this->rxvga2, 0, 30, 1, "%.0f dB")) {
+                if (_this->running) {
+                    _this->dev->setGainStage(_this->selectedChannel, "rxvga2", _this->rxvga2);
+                }
+                if (_this->selectedSerial != "") {
+                    config.aquire();
+                    config.conf["devices"][_this->selectedSerial]["rxvga2"] = _this->rxvga2;
+                    config.release(true);
+                }
+            }
+
+            if (agcOwned) {
+                style::endDisabled();
+                ImGui::Text("AGC: %.1f dBFS RMS, %.1f dBFS peak, %llu changes", _this->agc.rmsDbfs(), _this->agc.peakDbfs(),
+                            (unsigned long long)_this->agc.changes());
+            }
+        }
+
+        if (_this->running) {
+            ImGui::Text("Stream: %u x %u samples, %u transfers, %s", _this->num_buffers, _this->buffer_size, _this->num_transfers,
+                        _this->isSc8Format() ? "SC8_Q7" : "SC16_Q11");
+            ImGui::Text("Overruns: %llu, timeouts: %llu", (unsigned long long)_this->rxOverruns, (unsigned long long)_this->rxTimeouts);
+            ImGui::Text("Sample buffers: %.1f MB, %d on huge pages", _this->bufferPool.bytesHeld() / 1e6, _this->bufferPool.hugeSlots());
+            if (_this->auxSink.isRunning()) {
+                ImGui::Text("RX%d recorded: %.1f MB, dropped %llu", 2 - _this->primaryChannel, _this->auxSink.bytesWritten() / 1e6,
+                            (unsigned long long)_this->auxSink.dropped());
+            }
+            if (_this->isMetaFormat()) {
+                ImGui::Text("Lost: %llu samples in %llu gaps", (unsigned long long)_this->rxLostSamples, (unsigned long long)_this->rxDiscontinuities);
+                ImGui::Text("Timestamp: %llu", (unsigned long long)_this->rxTimestamp);
+            }
+        }
+
+        if (_this->running && _this->pipeline && !_this->asyncRx) {
+            ImGui::Text("Ring: %d/%d blocks, peak %d", _this->rawRing.fill(), _this->rawRing.depth(), (int)_this->rawRing.highWater);
+            ImGui::Text("Dropped blocks: %llu", (unsigned long long)_this->rawRing.dropped);
+        }
+
+        if (ImGui::CollapsingHeader(CONCAT("Raw recording##_bladeRF_rec_", _this->name))) {
+            bool recording = _this->rawRecorder.isRunning();
+            if (recording) { style::beginDisabled(); }
+            ImGui::Text("Path");
+            ImGui::SameLine();
+            ImGui::SetNextItemWidth(menuWidth - ImGui::GetCursorPosX());
+            if (ImGui::InputText(CONCAT("##_bladeRF_rec_path_", _this->name), _this->recordPath, sizeof(_this->recordPath))) {
+                if (_this->selectedSerial != "") {
+                    config.aquire();
+                    config.conf["devices"][_this->selectedSerial]["recordPath"] = std::string(_this->recordPath);
+                    config.release(true);
+                }
+            }
+            if (recording) { style::endDisabled(); }
+
+            // Recording taps the raw blocks, so it can only run alongside the stream
+            bool canRecord = _this->running && !_this->sweepMode && _this->recordPath[0] != 0;
+            if (!canRecord && !recording) { style::beginDisabled(); }
+            if (ImGui::Button(CONCAT(recording ? "Stop recording##_bladeRF_rec_btn_" : "Record##_bladeRF_rec_btn_", _this->name), ImVec2(menuWidth - ImGui::GetCursorPosX(), 0))) {
+                if (recording) {
+                    _this->rawRecorder.stop();
+                }
+                else {
+                    _this->startRecording();
+                }
+            }
+            if (!canRecord && !recording) { style::endDisabled(); }
+
+            if (_this->rawRecorder.isRunning()) {
+                ImGui::Text("Recorded: %.1f MB, dropped %llu blocks", _this->rawRecorder.bytesWritten() / 1e6,
+                            (unsigned long long)_this->rawRecorder.droppedBlocks());
+            }
+        }
+
+        if (ImGui::CollapsingHeader(CONCAT("Burst capture##_bladeRF_burst_", _this->name))) {
+            bool capturing = _this->burstCapture.isRunning();
+            if (capturing) { style::beginDisabled(); }
+            ImGui::Text("Path");
+            ImGui::SameLine();
+            ImGui::SetNextItemWidth(menuWidth - ImGui::GetCursorPosX());
+            if (ImGui::InputText(CONCAT("##_bladeRF_burst_path_", _this->name), _this->burstPath, sizeof(_this->burstPath))) {
+                if (_this->selectedSerial != "") {
+                    config.aquire();
+                    config.conf["devices"][_this->selectedSerial]["burstPath"] = std::string(_this->burstPath);
+                    config.release(true);
+                }
+            }
+
+            ImGui::Text("Threshold (dBFS)");
+            ImGui::SameLine();
+            ImGui::SetNextItemWidth(menuWidth - ImGui::GetCursorPosX());
+            if (ImGui::InputDouble(CONCAT("##_bladeRF_burst_threshold_", _this->name), &_this->burstSettings.thresholdDbfs, 1, 10, "%.1f")) {
+                _this->burstSettings.thresholdDbfs = std::clamp<double>(_this->burstSettings.thresholdDbfs, -100.0, 0.0);
+                if (_this->selectedSerial != "") {
+                    config.aquire();
+                    config.conf["devices"][_this->selectedSerial]["burstThreshold"] = _this->burstSettings.thresholdDbfs;
+                    config.release(true);
+                }
+            }
+
+            ImGui::Text("Hysteresis (dB)");
+            ImGui::SameLine();
+            ImGui::SetNextItemWidth(menuWidth - ImGui::GetCursorPosX());
+            if (ImGui::InputDouble(CONCAT("##_bladeRF_burst_hysteresis_", _this->name), &_this->burstSettings.hysteresisDb, 1, 3, "%.1f")) {
+                _this->burstSettings.hysteresisDb = std::clamp<double>(_this->burstSettings.hysteresisDb, 0.0, 40.0);
+                if (_this->selectedSerial != "") {
+                    config.aquire();
+                    config.conf["devices"][_this->selectedSerial]["burstHysteresis"] = _this->burstSettings.hysteresisDb;
+                    config.release(true);
+                }
+            }
+
+            ImGui::Text("Pre-trigger (s)");
+            ImGui::SameLine();
+            ImGui::SetNextItemWidth(menuWidth - ImGui::GetCursorPosX());
+            if (ImGui::InputDouble(CONCAT("##_bladeRF_burst_pre_", _this->name), &_this->burstSettings.preSeconds, 0.1, 1, "%.2f")) {
+                _this->burstSettings.preSeconds = std::clamp<double>(_this->burstSettings.preSeconds, 0.0, 10.0);
+                if (_this->selectedSerial != "") {
+                    config.aquire();
+                    config.conf["devices"][_this->selectedSerial]["burstPre"] = _this->burstSettings.preSeconds;
+                    config.release(true);
+                }
+            }
+
+            ImGui::Text("Post-trigger (s)");
+            ImGui::SameLine();
+            ImGui::SetNextItemWidth(menuWidth - ImGui::GetCursorPosX());
+            if (ImGui::InputDouble(CONCAT("##_bladeRF_burst_post_", _this->name), &_this->burstSettings.postSeconds, 0.1, 1, "%.2f")) {
+                _this->burstSettings.postSeconds = std::clamp<double>(_this->burstSettings.postSeconds, 0.0, 60.0);
+                if (_this->selectedSerial != "") {
+                    config.aquire();
+                    config.conf["devices"][_this->selectedSerial]["burstPost"] = _this->burstSettings.postSeconds;
+                    config.release(true);
+                }
+            }
+            if (capturing) { style::endDisabled(); }
+
+            // Armed now when streaming, otherwise with the next start
+            if (ImGui::Checkbox(CONCAT("Armed##_bladeRF_burst_armed_", _this->name), &_this->burstArmed)) {
+                if (_this->running) {
+                    if (_this->burstArmed) { _this->startBurst(); }
+                    else { _this->stopBurst(); }
+                }
+                if (_this->selectedSerial != "") {
+                    config.aquire();
+                    config.conf["devices"][_this->selectedSerial]["burstArmed"] = _this->burstArmed;
+                    config.release(true);
+                }
+            }
+
+            if (_this->burstCapture.isRunning()) {
+                ImGui::Text("Level: %.1f dBFS%s", _this->burstCapture.levelDbfs(), _this->burstCapture.triggered() ? " (triggered)" : "");
+                ImGui::Text("Bursts: %llu, missed %llu, lost %.1f MB", (unsigned long long)_this->burstCapture.bursts(),
+                            (unsigned long long)_this->burstCapture.missed(), _this->burstCapture.lostBytes() / 1e6);
+            }
+        }
+
+        if (ImGui::CollapsingHeader(CONCAT("Network server##_bladeRF_server_", _this->name))) {
+            bool serving = _this->iqServer.isRunning();
+            if (serving) { style::beginDisabled(); }
+            ImGui::Text("Address");
+            ImGui::SameLine();
+            ImGui::SetNextItemWidth(menuWidth - ImGui::GetCursorPosX());
+            if (ImGui::InputText(CONCAT("##_bladeRF_server_host_", _this->name), _this->serverHost, sizeof(_this->serverHost))) {
+                config.aquire();
+                config.conf["instances"][_this->name]["serverHost"] = std::string(_this->serverHost);
+                config.release(true);
+            }
+
+            ImGui::Text("Port");
+            ImGui::SameLine();
+            ImGui::SetNextItemWidth(menuWidth - ImGui::GetCursorPosX());
+            if (ImGui::InputInt(CONCAT("##_bladeRF_server_port_", _this->name), &_this->serverPort, 1, 100)) {
+                _this->serverPort = std::clamp<int>(_this->serverPort, 1, 65535);
+                config.aquire();
+                config.conf["instances"][_this->name]["serverPort"] = _this->serverPort;
+                config.release(true);
+            }
+
+            ImGui::Text("Protocol");
+            ImGui::SameLine();
+            ImGui::SetNextItemWidth(menuWidth - ImGui::GetCursorPosX());
+            if (ImGui::Combo(CONCAT("##_bladeRF_server_proto_", _this->name), &_this->serverProtocol, IQ_SERVER_PROTOCOL_STR)) {
+                config.aquire();
+                config.conf["instances"][_this->name]["serverProtocol"] = _this->serverProtocol;
+                config.release(true);
+            }
+
+            ImGui::Text("Slow clients");
+            ImGui::SameLine();
+            ImGui::SetNextItemWidth(menuWidth - ImGui::GetCursorPosX());
+            if (ImGui::Combo(CONCAT("##_bladeRF_server_policy_", _this->name), &_this->serverPolicy, IQ_SERVER_POLICY_STR)) {
+                config.aquire();
+                config.conf["instances"][_this->name]["serverPolicy"] = _this->serverPolicy;
+                config.release(true);
+            }
+            if (serving) { style::endDisabled(); }
+
+            if (ImGui::Button(CONCAT(serving ? "Stop server##_bladeRF_server_btn_" : "Start server##_bladeRF_server_btn_", _this->name), ImVec2(menuWidth - ImGui::GetCursorPosX(), 0))) {
+                if (serving) {
+                    _this->stopServer();
+                }
+                else {
+                    _this->startServer();
+                }
+            }
+
+            if (_this->iqServer.isRunning()) {
+                IqServer::Stats st = _this->iqServer.stats();
+                ImGui::Text("Clients: %d, sent %.1f MB", st.clients, st.bytesSent / 1e6);
+                ImGui::Text("Skipped: %llu blocks, dropped %llu clients", (unsigned long long)st.blocksSkipped,
+                            (unsigned long long)st.clientsDropped);
+            }
+        }
+
+        if (ImGui::CollapsingHeader(CONCAT("Replay##_bladeRF_replay_", _this->name))) {
+            if (_this->running) { style::beginDisabled(); }
+            ImGui::Text("File");
+            ImGui::SameLine();
+            ImGui::SetNextItemWidth(menuWidth - ImGui::GetCursorPosX());
+            ImGui::InputText(CONCAT("##_bladeRF_replay_path_", _this->name), _this->replayPath, sizeof(_this->replayPath));
+
+            if (ImGui::Checkbox(CONCAT("Real time##_bladeRF_replay_paced_", _this->name), &_this->replayOptions.paced)) {
+                config.aquire();
+                config.conf["replayPaced"] = _this->replayOptions.paced;
+                config.release(true);
+                // Options are taken when the file is opened
+                if (replay::isReplaySerial(_this->selectedSerial)) { _this->closeDevice(); }
+            }
+            ImGui::SameLine();
+            if (ImGui::Checkbox(CONCAT("Loop##_bladeRF_replay_loop_", _this->name), &_this->replayOptions.loop)) {
+                config.aquire();
+                config.conf["replayLoop"] = _this->replayOptions.loop;
+                config.release(true);
+                if (replay::isReplaySerial(_this->selectedSerial)) { _this->closeDevice(); }
+            }
+
+            if (ImGui::Button(CONCAT("Select replay##_bladeRF_replay_sel_", _this->name), ImVec2(menuWidth - ImGui::GetCursorPosX(), 0))) {
+                config.aquire();
+                config.conf["replayPath"] = std::string(_this->replayPath);
+                config.release(true);
+                _this->refresh();
+                if (_this->replayPath[0] != 0) {
+                    _this->devId = _this->devList.size() - 1;
+                    _this->selectBySerial(_this->devList[_this->devId]);
+                    core::setInputSampleRate(_this->sampleRate);
+                    _this->saveSelection();
+                }
+                else {
+                    _this->selectDefault();
+                    core::setInputSampleRate(_this->sampleRate);
+                }
+            }
+            if (_this->running) { style::endDisabled(); }
+        }
+
+        if (ImGui::CollapsingHeader(CONCAT("DC / IQ correction##_bladeRF_iq_", _this->name))) {
+            if (_this->running) { style::beginDisabled(); }
+            if (ImGui::Checkbox(CONCAT("Correct DC offset and IQ imbalance##_bladeRF_iq_on_", _this->name), &_this->iqCorrect)) {
+                if (_this->selectedSerial != "") {
+                    config.aquire();
+                    config.conf["devices"][_this->selectedSerial]["iqCorrection"] = _this->iqCorrect;
+                    config.release(true);
+                }
+            }
+            if (ImGui::Checkbox(CONCAT("Apply in FPGA where supported##_bladeRF_iq_hw_", _this->name), &_this->iqHardware)) {
+                if (_this->selectedSerial != "") {
+                    config.aquire();
+                    config.conf["devices"][_this->selectedSerial]["iqHardware"] = _this->iqHardware;
+                    config.release(true);
+                }
+            }
+            if (ImGui::Button(CONCAT("Forget calibration##_bladeRF_iq_clear_", _this->name), ImVec2(menuWidth - ImGui::GetCursorPosX(), 0))) {
+                _this->iqCal.clear();
+                if (_this->selectedSerial != "") {
+                    config.aquire();
+                    config.conf["devices"][_this->selectedSerial]["iqCal"] = _this->iqCal.save();
+                    config.release(true);
+                }
+            }
+            if (_this->running) { style::endDisabled(); }
+
+            convert::IqCorrection corr = _this->iqCal.correction();
+            ImGui::Text("Cached bands: %d%s", _this->iqCal.bandCount(), _this->iqActive && _this->iqCal.hardwareActive() ? " (FPGA)" : "");
+            ImGui::Text("DC: %.4f / %.4f, gain %.4f, phase %.4f", corr.dcI, corr.dcQ, corr.gain, corr.phase);
+        }
+
+        if (ImGui::CollapsingHeader(CONCAT("Sweep##_bladeRF_sweep_", _this->name))) {
+            if (_this->running) { style::beginDisabled(); }
+            if (ImGui::Checkbox(CONCAT("Sweep mode##_bladeRF_sweep_mode_", _this->name), &_this->sweepMode)) {
+                if (_this->selectedSerial != "") {
+                    config.aquire();
+                    config.conf["devices"][_this->selectedSerial]["sweepMode"] = _this->sweepMode;
+                    config.release(true);
+                }
+            }
+
+            ImGui::Text("Start (MHz)");
+            ImGui::SameLine();
+            ImGui::SetNextItemWidth(menuWidth - ImGui::GetCursorPosX());
+            if (ImGui::InputDouble(CONCAT("##_bladeRF_sweep_start_", _this->name), &_this->sweepStart, 1, 10, "%.3f")) {
+                if (_this->selectedSerial != "") {
+                    config.aquire();
+                    config.conf["devices"][_this->selectedSerial]["sweepStart"] = _this->sweepStart;
+                    config.release(true);
+                }
+            }
+
+            ImGui::Text("Stop (MHz)");
+            ImGui::SameLine();
+            ImGui::SetNextItemWidth(menuWidth - ImGui::GetCursorPosX());
+            if (ImGui::InputDouble(CONCAT("##_bladeRF_sweep_stop_", _this->name), &_this->sweepStop, 1, 10, "%.3f")) {
+                if (_this->selectedSerial != "") {
+                    config.aquire();
+                    config.conf["devices"][_this->selectedSerial]["sweepStop"] = _this->sweepStop;
+                    config.release(true);
+                }
+            }
+
+            ImGui::Text("Step (MHz, 0 = auto)");
+            ImGui::SameLine();
+            ImGui::SetNextItemWidth(menuWidth - ImGui::GetCursorPosX());
+            if (ImGui::InputDouble(CONCAT("##_bladeRF_sweep_step_", _this->name), &_this->sweepStep, 0.1, 1, "%.3f")) {
+                _this->sweepStep = std::max<double>(_this->sweepStep, 0.0);
+                if (_this->selectedSerial != "") {
+                    config.aquire();
+                    config.conf["devices"][_this->selectedSerial]["sweepStep"] = _this->sweepStep;
+                    config.release(true);
+                }
+            }
+
+            // An explicit list of centers (MHz) replaces the range
+            ImGui::Text("List (MHz)");
+            ImGui::SameLine();
+            ImGui::SetNextItemWidth(menuWidth - ImGui::GetCursorPosX());
+            if (ImGui::InputText(CONCAT("##_bladeRF_sweep_list_", _this->name), _this->sweepList, sizeof(_this->sweepList))) {
+                if (_this->selectedSerial != "") {
+                    config.aquire();
+                    config.conf["devices"][_this->selectedSerial]["sweepList"] = std::string(_this->sweepList);
+                    config.release(true);
+                }
+            }
+
+            ImGui::Text("Dwell (us)");
+            ImGui::SameLine();
+            ImGui::SetNextItemWidth(menuWidth - ImGui::GetCursorPosX());
+            if (ImGui::InputInt(CONCAT("##_bladeRF_sweep_dwell_", _this->name), &_this->sweepDwellUs, 100, 1000)) {
+                _this->sweepDwellUs = std::clamp<int>(_this->sweepDwellUs, 50, 1000000);
+                if (_this->selectedSerial != "") {
+                    config.aquire();
+                    config.conf["devices"][_this->selectedSerial]["sweepDwellUs"] = _this->sweepDwellUs;
+                    config.release(true);
+                }
+            }
+
+            ImGui::Text("Settling (us)");
+            ImGui::SameLine();
+            ImGui::SetNextItemWidth(menuWidth - ImGui::GetCursorPosX());
+            if (ImGui::InputInt(CONCAT("##_bladeRF_sweep_settle_", _this->name), &_this->sweepSettleUs, 10, 100)) {
+                _this->sweepSettleUs = std::clamp<int>(_this->sweepSettleUs, 0, 100000);
+                if (_this->selectedSerial != "") {
+                    config.aquire();
+                    config.conf["devices"][_this->selectedSerial]["sweepSettleUs"] = _this->sweepSettleUs;
+                    config.release(true);
+                }
+            }
+
+            ImGui::Text("FFT size");
+            ImGui::SameLine();
+            ImGui::SetNextItemWidth(menuWidth - ImGui::GetCursorPosX());
+            if (ImGui::Combo(CONCAT("##_bladeRF_sweep_fft_", _this->name), &_this->sweepFftId, SWEEP_FFT_STR)) {
+                if (_this->selectedSerial != "") {
+                    config.aquire();
+                    config.conf["devices"][_this->selectedSerial]["sweepFftSize"] = _this->sweepFftId;
+                    config.release(true);
+                }
+            }
+
+            ImGui::Text("Output (CSV)");
+            ImGui::SameLine();
+            ImGui::SetNextItemWidth(menuWidth - ImGui::GetCursorPosX());
+            if (ImGui::InputText(CONCAT("##_bladeRF_sweep_path_", _this->name), _this->sweepPath, sizeof(_this->sweepPath))) {
+                if (_this->selectedSerial != "") {
+                    config.aquire();
+                    config.conf["devices"][_this->selectedSerial]["sweepPath"] = std::string(_this->sweepPath);
+                    config.release(true);
+                }
+            }
+            ImGui::Text("Hop rate: %.0f hops/s max", 1e6 / _this->sweepDwellUs);
+            if (_this->running) { style::endDisabled(); }
+
+            if (_this->running && _this->sweepMode) {
+                ImGui::Text("Sweeps: %llu, %.0f hops/s, %llu hops lost", (unsigned long long)_this->sweepsDone,
+                            _this->hopRate.update(_this->hopsDone), (unsigned long long)_this->hopsLost);
+                std::lock_guard<std::mutex> lck(_this->sweepMtx);
+                if (!_this->sweepDisplay.empty()) {
+                    ImGui::PlotLines(CONCAT("##_bladeRF_sweep_plot_", _this->name), _this->sweepDisplay.data(), _this->sweepDisplay.size(),
+                                     0, NULL, -120.0f, 0.0f, ImVec2(menuWidth, 150));
+                }
+            }
+        }
+
+        if (ImGui::CollapsingHeader(CONCAT("Statistics##_bladeRF_stats_", _this->name))) {
+            RxMetrics& m = _this->metrics;
+            ImGui::Text("Delivered: %.3f MS/s", _this->uiRate.update(m.samples) / 1e6);
+            ImGui::Text("sync_rx wait: %.1f us avg, %.1f us p99", m.rxWait.meanNs() / 1e3, m.rxWait.quantileNs(0.99) / 1e3);
+            ImGui::Text("Conversion: %.3f ns/sample", m.convertNsPerSample());
+            ImGui::Text("Swap wait: %.1f us avg, %.1f us p99", m.swapWait.meanNs() / 1e3, m.swapWait.quantileNs(0.99) / 1e3);
+            ImGui::Text("Timeouts: %llu", (unsigned long long)_this->rxTimeouts);
+            ImGui::Text("Retune: %.1f us avg, %.1f us max", m.retune.meanNs() / 1e3, m.retune.maxNs() / 1e3);
+            ImGui::Text("Start: %.1f ms (%s), stop: %.1f ms", _this->startMs, _this->startWarm ? "warm" : "cold", _this->stopMs);
+            if (_this->rateChangeMs > 0) { ImGui::Text("Last rate change: %.1f ms", _this->rateChangeMs); }
+            ImGui::Text("Quick-tune: %llu hits, %llu misses, %llu coalesced", (unsigned long long)_this->quickTune.hits,
+                        (unsigned long long)_this->quickTune.misses, (unsigned long long)_this->retunesCoalesced);
+
+            if (_this->running) { style::beginDisabled(); }
+            if (ImGui::Checkbox(CONCAT("Export JSON lines##_bladeRF_metrics_export_", _this->name), &_this->metricsExport)) {
+                config.aquire();
+                config.conf["metricsExport"] = _this->metricsExport;
+                config.release(true);
+            }
+            if (_this->metricsExport) {
+                ImGui::SetNextItemWidth(menuWidth - ImGui::GetCursorPosX());
+                if (ImGui::InputText(CONCAT("##_bladeRF_metrics_path_", _this->name), _this->metricsPath, sizeof(_this->metricsPath))) {
+                    config.aquire();
+                    config.conf["metricsPath"] = std::string(_this->metricsPath);
+                    config.release(true);
+                }
+                ImGui::Text("Interval (s)");
+                ImGui::SameLine();
+                ImGui::SetNextItemWidth(menuWidth - ImGui::GetCursorPosX());
+                if (ImGui::InputInt(CONCAT("##_bladeRF_metrics_interval_", _this->name), &_this->metricsInterval)) {
+                    _this->metricsInterval = std::clamp<int>(_this->metricsInterval, 1, 3600);
+                    config.aquire();
+                    config.conf["metricsInterval"] = _this->metricsInterval;
+                    config.release(true);
+                }
+            }
+            if (_this->running) { style::endDisabled(); }
+        }
+    }
+
+    static void worker(void* ctx) {
+        bladeRFSourceModule* _this = (bladeRFSourceModule*)ctx;
+        threadsched::applyToCurrentThread(_this->rxSched, "bladeRF RX thread");
+
+        int16_t* inBuf = _this->rxBlock;
+        int status;
+
+        unsigned int count;
+        uint64_t gap;
+
+        while (_this->acquiring) {
+            status = _this->receive(inBuf, count, gap);
+            if (status != 0) {
+                // Nothing valid was read, don't send the previous contents downstream again
+                continue;
+            }
+            uint64_t burstEnd = _this->recordBlock(inBuf, count);
+            if (gap != 0 && _this->zeroFill) {
+                if (!_this->pushZeros(gap)) { break; }
+            }
+            if (!_this->deliver(inBuf, count, burstEnd)) { break; }
+        }
+    }
+
+    // Convert a raw block into the stream and hand it downstream
+    bool deliver(const void* in, int count, uint64_t burstEnd) {
+        return swapTimed(convertBlock(in, count, burstEnd));
+    }
+
+    // Returns the number of samples written to the stream. In 2x RX mode count covers
+    // both channels, the primary one goes to the stream and the other to the aux sink.
+    // burstEnd is where recordBlock() put the block in the burst capture window.
+    int convertBlock(const void* in, int count, uint64_t burstEnd) {
+        uint64_t start = metricsNow();
+        if (mimo) {
+            count /= 2;
+            dsp::complex_t* aux = auxSink.writeSlot();
+            if (aux == NULL) {
+                if (auxSink.isRunning()) { auxSink.drop(); }
+                aux = auxScratch.data();
+            }
+            dsp::complex_t* out0 = (primaryChannel == 0) ? stream.writeBuf : aux;
+            dsp::complex_t* out1 = (primaryChannel == 0) ? aux : stream.writeBuf;
+            if (isSc8Format()) {
+                convert::sc8q7DeinterleaveX2((const int8_t*)in, out0, out1, count);
+            }
+            else {
+                convert::sc16q11DeinterleaveX2((const int16_t*)in, out0, out1, count);
+            }
+            if (aux != auxScratch.data()) { auxSink.commit(count); }
+        }
+        else if (decimator.isEnabled()) {
+            // Correction is linear, so it's applied to the fewer samples after resampling
+            convert::IqStats stats;
+            convert::IqStats* statsOut = (iqActive || agcActive || burstActive) ? &stats : NULL;
+            if (isSc8Format()) {
+                count = decimator.process((const int8_t*)in, stream.writeBuf, count, statsOut);
+            }
+            else {
+                count = decimator.process((const int16_t*)in, stream.writeBuf, count, statsOut);
+            }
+            if (iqActive) {
+                convert::correctComplex(stream.writeBuf, count, iqCal.correction());
+                iqCal.feed(stats);
+            }
+            if (agcActive) { agc.feed(stats); }
+            if (burstActive) { burstCapture.feed(stats, burstEnd); }
+        }
+        else if (iqActive || agcActive || burstActive) {
+            // The AGC or trigger alone run the corrected kernels with a neutral correction for their stats
+            convert::IqStats stats;
+            convert::IqCorrection corr = iqActive ? iqCal.correction() : convert::IqCorrection();
+            if (isSc8Format()) {
+                convert::sc8q7ToComplexCorrected((const int8_t*)in, stream.writeBuf, count, corr, stats);
+            }
+            else {
+                convert::sc16q11ToComplexCorrected((const int16_t*)in, stream.writeBuf, count, corr, stats);
+            }
+            if (iqActive) { iqCal.feed(stats); }
+            if (agcActive) { agc.feed(stats); }
+            if (burstActive) { burstCapture.feed(stats, burstEnd); }
+        }
+        else if (isSc8Format()) {
+            convert::sc8q7ToComplex((const int8_t*)in, stream.writeBuf, count);
+        }
+        else {
+            convert::sc16q11ToComplex((const int16_t*)in, stream.writeBuf, count);
+        }
+        metrics.convert.record(metricsNow() - start);
+        return count;
+    }
+
+    int channelCount() {
+        return mimo ? 2 : 1;
+    }
+
+    bladerf_channel otherChannel() {
+        return BLADERF_CHANNEL_RX(1 - primaryChannel);
+    }
+
+    bladerf_format wireFormat(bool sc8) {
+        // Without metadata sync RX never reports an overrun, and auto-tune would have nothing to learn from
+        bool meta = (metaRx || sweepMode || streamAutoTune) && !asyncRx;
+        if (sc8) {
+            return meta ? BLADERF_FORMAT_SC8_Q7_META : BLADERF_FORMAT_SC8_Q7;
+        }
+        return meta ? BLADERF_FORMAT_SC16_Q11_META : BLADERF_FORMAT_SC16_Q11;
+    }
+
+    bool isSc8Format() {
+        return format == BLADERF_FORMAT_SC8_Q7 || format == BLADERF_FORMAT_SC8_Q7_META;
+    }
+
+    bool isMetaFormat() {
+        return format == BLADERF_FORMAT_SC16_Q11_META || format == BLADERF_FORMAT_SC8_Q7_META;
+    }
+
+    // Size of one complex sample on the wire
+    size_t sampleBytes() {
+        return isSc8Format() ? 2 * sizeof(int8_t) : 2 * sizeof(int16_t);
+    }
+
+    int configureStream() {
+        if (asyncRx) {
+            // The callback converts straight out of the transfer buffers, no intermediate copy
+            int status = dev->initStream(asyncCallback, &asyncBuffers, num_buffers, format, buffer_size, num_transfers, this);
+            if (status != 0) { return status; }
+            return dev->setStreamTimeout(stream_timeout);
+        }
+        return dev->syncConfig(channel_layout, format, num_buffers, buffer_size, num_transfers, stream_timeout);
+    }
+
+    bool swapTimed(int count) {
+        // A resampled block can come out empty
+        if (count == 0) { return true; }
+        uint64_t start = metricsNow();
+        bool ok = stream.swap(count);
+        metrics.swapWait.record(metricsNow() - start);
+        metrics.samples += count;
+        return ok;
+    }
+
+    // Read one block, with metadata when enabled. count is set to the number of samples
+    // actually read (all channels) and gap to the number of samples lost per channel
+    // just before them.
+    int receive(void* buf, unsigned int& count, uint64_t& gap) {
+        int status;
+        gap = 0;
+        blockDiscontinuity = false;
+
+        if (!isMetaFormat()) {
+            uint64_t start = metricsNow();
+            status = dev->syncRx(buf, buffer_size, NULL, stream_timeout);
+            metrics.rxWait.record(metricsNow() - start);
+            if (status != 0) {
+                spdlog::error(bladerf_strerror(status));
+                countRxError(status);
+                return status;
+            }
+            count = buffer_size;
+            rxBlocks++;
+            return 0;
+        }
+
+        struct bladerf_metadata meta;
+        memset(&meta, 0, sizeof(meta));
+        meta.flags = BLADERF_META_FLAG_RX_NOW;
+        uint64_t start = metricsNow();
+        status = dev->syncRx(buf, buffer_size, &meta, stream_timeout);
+        metrics.rxWait.record(metricsNow() - start);
+        if (status != 0) {
+            spdlog::error(bladerf_strerror(status));
+            countRxError(status);
+            return status;
+        }
+        count = meta.actual_count;
+        rxBlocks++;
+
+        // Each block should start exactly where the previous one ended
+        if (haveTimestamp && meta.timestamp > nextTimestamp) {
+            gap = meta.timestamp - nextTimestamp;
+        }
+        if (gap != 0 || (meta.status & BLADERF_META_STATUS_OVERRUN)) {
+            blockDiscontinuity = true;
+            rxLostSamples += gap;
+            rxDiscontinuities++;
+            rxOverruns++;
+            spdlog::warn("bladeRF {0}: discontinuity at {1}, {2} samples lost", selectedSerial, meta.timestamp, gap);
+        }
+
+        rxTimestamp = meta.timestamp;
+        nextTimestamp = meta.timestamp + count / channelCount();
+        haveTimestamp = true;
+        return 0;
+    }
+
+    // Raw blocks go to the recorder, burst capture and network clients untouched, before any conversion.
+    // Returns where the block ended up in the burst capture window, for the trigger.
+    uint64_t recordBlock(const void* buf, unsigned int count) {
+        uint64_t burstEnd = burstActive ? burstCapture.write(buf, count) : 0;
+        if (iqServer.isRunning()) {
+            iqServer.publish(buf, count, isMetaFormat() ? (uint64_t)rxTimestamp : IQ_SERVER_NO_TIMESTAMP, blockDiscontinuity);
+        }
+        if (rawRecorder.isRunning()) {
+            rawRecorder.write(buf, count, isMetaFormat() ? (uint64_t)rxTimestamp : RAW_RECORDER_NO_TIMESTAMP);
+        }
+        return burstEnd;
+    }
+
+    bool startServer() {
+        bool ok = iqServer.start(serverHost, serverPort, (IqServer::Protocol)serverProtocol, (IqServer::SlowPolicy)serverPolicy);
+        config.aquire();
+        config.conf["instances"][name]["serverEnabled"] = ok;
+        config.release(true);
+        return ok;
+    }
+
+    void stopServer() {
+        iqServer.stop();
+        config.aquire();
+        config.conf["instances"][name]["serverEnabled"] = false;
+        config.release(true);
+    }
+
+    void startRecording() {
+        RawRecorder::Info info;
+        info.datatype = isSc8Format() ? "ci8" : "ci16_le";
+        info.sampleRate = hwSampleRate();
+        info.frequency = freq;
+        info.channels = channelCount();
+        info.hardware = json({});
+        info.hardware["serial"] = selectedSerial;
+        info.hardware["bandwidth"] = bandwidth;
+        info.hardware["format"] = isSc8Format() ? "SC8_Q7" : "SC16_Q11";
+        if (mimo) {
+            info.hardware["rx1_gain"] = rxGain[0];
+            info.hardware["rx2_gain"] = rxGain[1];
+        }
+        else {
+            info.hardware["lna"] = lna;
+            info.hardware["rxvga1"] = rxvga1;
+            info.hardware["rxvga2"] = rxvga2;
+        }
+        // A second of buffering rides out filesystem hiccups at full rate
+        rawRecorder.start(recordPath, info, sampleBytes(), 1.0);
+    }
+
+    // Keep downstream time alignment by standing in for lost samples with silence.
+    // Capped at one second so a stalled board can't flood the DSP chain. samples is
+    // per channel, in 2x RX the recorded channel gets the same span so both stay aligned.
+    bool pushZeros(uint64_t samples) {
+        if (decimator.isEnabled()) { samples = decimator.outputCount(samples); }
+        samples = std::min<uint64_t>(samples, (uint64_t)sampleRate);
+        while (samples > 0) {
+            // buffer_size counts all channels, the stream only gets one of them
+            int chunk = std::min<uint64_t>(samples, buffer_size / channelCount());
+            memset(stream.writeBuf, 0, chunk * sizeof(dsp::complex_t));
+            if (mimo) {
+                dsp::complex_t* aux = auxSink.writeSlot();
+                if (aux != NULL) {
+                    memset(aux, 0, chunk * sizeof(dsp::complex_t));
+                    auxSink.commit(chunk);
+                }
+                else if (auxSink.isRunning()) {
+                    auxSink.drop();
+                }
+            }
+            if (!swapTimed(chunk)) { return false; }
+            samples -= chunk;
+        }
+        return true;
+    }
+
+    void countRxError(int status) {
+        if (status == BLADERF_ERR_TIMEOUT) {
+            rxTimeouts++;
+        }
+        else {
+            rxOverruns++;
+            // Errors other than timeouts can come back immediately (e.g. unplugged board), don't spin on them
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+
+    // Pipeline stage 1: keep USB drained no matter what the DSP chain is doing
+    static void acquireWorker(void* ctx) {
+        bladeRFSourceModule* _this = (bladeRFSourceModule*)ctx;
+
+        threadsched::applyToCurrentThread(_this->rxSched, "bladeRF RX thread");
+
+        // When the ring is full the block is still read, into scratch, so libbladeRF never overruns
+        int16_t* scratch = _this->rxBlock;
+        int status;
+
+        unsigned int count;
+        uint64_t gap;
+
+        while (_this->acquiring) {
+            int16_t* slot = _this->rawRing.writeSlot();
+            bool full = (slot == NULL);
+            if (full) { slot = scratch; }
+
+            status = _this->receive(slot, count, gap);
+            if (status != 0) { continue; }
+            // Goes with the block through the ring, the trigger learns its power only once converted
+            uint64_t burstEnd = _this->recordBlock(slot, count);
+
+            if (gap != 0 && _this->zeroFill && !full) {
+                // Zero blocks are queued ahead of the one just read, which moves to a later slot
+                size_t blockBytes = count * _this->sampleBytes();
+                uint64_t burstStart = (burstEnd > blockBytes) ? burstEnd - blockBytes : 0;
+                memcpy(scratch, slot, blockBytes);
+                gap = std::min<uint64_t>(gap, (uint64_t)_this->hwSampleRate()) * _this->channelCount();
+                while (gap > 0 && slot != NULL) {
+                    int chunk = std::min<uint64_t>(gap, _this->buffer_size);
+                    memset(slot, 0, chunk * _this->sampleBytes());
+                    _this->rawRing.commitWrite(chunk, burstStart);
+                    gap -= chunk;
+                    slot = _this->rawRing.writeSlot();
+                }
+                full = (slot == NULL);
+                if (!full) { memcpy(slot, scratch, blockBytes); }
+            }
+
+            if (full) {
+                // Samples thrown away on the host are just as lost as a USB overrun
+                _this->rawRing.drop();
+                _this->rxOverruns++;
+                continue;
+            }
+            _this->rawRing.commitWrite(count, burstEnd);
+        }
+    }
+
+    // Pipeline stage 2: convert raw blocks and hand them to the DSP chain
+    static void convertWorker(void* ctx) {
+        bladeRFSourceModule* _this = (bladeRFSourceModule*)ctx;
+        int count;
+        uint64_t burstEnd;
+
+        while (true) {
+            int16_t* block = _this->rawRing.readSlot(count, burstEnd);
+            if (block == NULL) { break; }
+            // The conversion is done once the write buffer is filled, so the slot can be released before swapping
+            int outCount = _this->convertBlock(block, count, burstEnd);
+            _this->rawRing.commitRead();
+            if (!_this->swapTimed(outCount)) { break; }
+        }
+    }
+
+    // Applies the most recent frequency requested by tune(), older requests still
+    // waiting when it wakes up are simply superseded
+    static void retuneWorker(void* ctx) {
+        bladeRFSourceModule* _this = (bladeRFSourceModule*)ctx;
+        std::unique_lock<std::mutex> lck(_this->retuneMtx);
+        while (true) {
+            // Also wakes up regularly to turn finished correction windows into coefficients
+            _this->retuneCnd.wait_for(lck, std::chrono::milliseconds(IQ_CAL_POLL_MS), [&]{ return _this->retunePending || !_this->retuneRunning; });
+            if (!_this->retuneRunning) { break; }
+            if (!_this->retunePending) {
+                lck.unlock();
+                if (_this->iqActive) { _this->iqCal.service(); }
+                lck.lock();
+                continue;
+            }
+            double freq = _this->retuneFreq;
+            _this->retunePending = false;
+            lck.unlock();
+
+            uint64_t start = metricsNow();
+            int status = _this->applyFrequency(freq);
+            _this->metrics.retune.record(metricsNow() - start);
+            if (status == 0) {
+                _this->rawRecorder.setFrequency(freq);
+                _this->iqServer.setFrequency(freq);
+                _this->burstCapture.setFrequency(freq);
+                if (_this->iqActive) { _this->iqCal.retune(freq); }
+            }
+            else {
+                spdlog::error("Could not set frequency on bladeRF {0}", _this->selectedSerial);
+                spdlog::error(bladerf_strerror(status));
+            }
+
+            lck.lock();
+        }
+    }
+
+    // Tune every active channel, through a cached quick-tune profile when there is one
+    int applyFrequency(double freq) {
+        bladerf_frequency f = (bladerf_frequency)freq;
+        bladerf_channel channels[2] = { selectedChannel, otherChannel() };
+        for (int i = 0; i < channelCount(); i++) {
+            bladerf_channel ch = channels[i];
+            struct bladerf_quick_tune* qt = quickTune.find(ch, f);
+            if (qt != NULL) {
+                if (dev->scheduleRetune(ch, BLADERF_RETUNE_NOW, f, qt) == 0) { continue; }
+                // Stale profile, e.g. overwritten on the board. Fall back to a full tune.
+                quickTune.remove(ch, f);
+            }
+
+            int status = dev->setFrequency(ch, f);
+            if (status != 0) { return status; }
+
+            struct bladerf_quick_tune newQt;
+            if (dev->getQuickTune(ch, &newQt) == 0) {
+                quickTune.store(ch, f, newQt);
+            }
+        }
+        return 0;
+    }
+
+    // Frequency hopping. Every retune is queued in the FPGA against the RX timestamp,
+    // so hop rate is bounded by the hardware, the host only keeps the queue topped up
+    // and sorts the samples it receives into hops by their timestamp.
+    static void sweepWorker(void* ctx) {
+        bladeRFSourceModule* _this = (bladeRFSourceModule*)ctx;
+        threadsched::applyToCurrentThread(_this->rxSched, "bladeRF RX thread");
+        double rate = _this->hwSampleRate();
+        double step = (_this->sweepStep > 0) ? _this->sweepStep * 1e6 : rate * SWEEP_DEFAULT_STEP;
+        std::vector<double> hops = sweep::plan(_this->sweepStart * 1e6, _this->sweepStop * 1e6, step, _this->sweepList, SWEEP_MAX_HOPS);
+        if (hops.empty()) {
+            spdlog::error("bladeRF {0}: sweep has no frequencies to visit", _this->selectedSerial);
+            return;
+        }
+        int fftSize = 256 << _this->sweepFftId;
+        uint64_t dwell = std::max<uint64_t>(_this->sweepDwellUs * rate / 1e6, fftSize);
+        uint64_t settle = std::min<uint64_t>(_this->sweepSettleUs * rate / 1e6, dwell - fftSize);
+        int hopCount = hops.size();
+        bladerf_channel ch = _this->selectedChannel;
+
+        {
+            std::lock_guard<std::mutex> lck(_this->sweepMtx);
+            _this->sweepStitcher.init(hops, rate, step, fftSize);
+            _this->sweepDisplay = _this->sweepStitcher.spectrum;
+        }
+        _this->sweepsDone = 0;
+        _this->hopsDone = 0;
+        _this->hopsLost = 0;
+
+        // One full tune per hop leaves a quick-tune profile for each of them in the cache
+        for (double f : hops) {
+            if (!_this->acquiring) {
+                _this->endSweep(ch);
+                return;
+            }
+            int status = _this->applyFrequency(f);
+            if (status != 0) {
+                spdlog::error("bladeRF {0}: could not tune to {1} Hz for the sweep", _this->selectedSerial, f);
+                spdlog::error(bladerf_strerror(status));
+                _this->endSweep(ch);
+                return;
+            }
+        }
+        spdlog::info("bladeRF {0}: sweeping {1} hops, {2} samples dwell, {3} settling, {4} point FFT",
+                     _this->selectedSerial, hopCount, dwell, settle, fftSize);
+
+        FILE* out = NULL;
+        if (_this->sweepPath[0] != 0) {
+            out = fopen(_this->sweepPath, "a");
+            if (out == NULL) { spdlog::error("Could not open sweep output {0}", _this->sweepPath); }
+        }
+
+        int16_t* inBuf = _this->rxBlock;
+        std::vector<dsp::complex_t> samples(_this->buffer_size);
+        uint64_t origin = 0;        // Timestamp where hop anchorHop starts
+        uint64_t anchorHop = 0;
+        uint64_t scheduled = 0;     // Next hop to queue a retune for
+        uint64_t current = 0;       // Hop being accumulated
+        bool anchored = false;
+        unsigned int count;
+        uint64_t gap;
+
+        while (_this->acquiring) {
+            // The board runs ahead of the samples received by however much is buffered on the way,
+            // so the schedule is kept relative to its own clock
+            bladerf_timestamp now;
+            if (_this->dev->getRxTimestamp(&now) != 0) {
+                spdlog::error("bladeRF {0}: could not read the RX timestamp", _this->selectedSerial);
+                break;
+            }
+            if (!anchored) {
+                _this->dev->cancelScheduledRetunes(ch);
+                origin = now + (uint64_t)(rate * SWEEP_LEAD_S);
+                // The hop in progress, if any, is abandoned
+                if (scheduled != 0) { _this->hopsLost++; }
+                anchorHop = current + 1;
+                current = anchorHop;
+                scheduled = anchorHop;
+                _this->sweepStitcher.discardHop();
+                anchored = true;
+            }
+
+            // Keep the FPGA retune queue topped up
+            while (true) {
+                uint64_t when = origin + (scheduled - anchorHop) * dwell;
+                if (when >= now + SWEEP_QUEUE_AHEAD * dwell) { break; }
+                if (when < now + (uint64_t)(rate * SWEEP_MARGIN_S)) {
+                    // The schedule fell behind the board, start over from now
+                    anchored = false;
+                    break;
+                }
+                bladerf_frequency f = (bladerf_frequency)hops[scheduled % hopCount];
+                int status = _this->dev->scheduleRetune(ch, when, f, _this->quickTune.find(ch, f));
+                if (status == BLADERF_ERR_QUEUE_FULL) { break; }
+                if (status != 0) {
+                    spdlog::error("bladeRF {0}: could not schedule retune", _this->selectedSerial);
+                    spdlog::error(bladerf_strerror(status));
+                    _this->acquiring = false;
+                    break;
+                }
+                scheduled++;
+            }
+            if (!anchored || !_this->acquiring) { continue; }
+
+            if (_this->receive(inBuf, count, gap) != 0) { continue; }
+            if (gap != 0) {
+                // FFT frames can't span the hole
+                _this->sweepStitcher.discardHop();
+            }
+            if (_this->isSc8Format()) {
+                convert::sc8q7ToComplex((const int8_t*)inBuf, samples.data(), count);
+            }
+            else {
+                convert::sc16q11ToComplex(inBuf, samples.data(), count);
+            }
+
+            uint64_t t = _this->rxTimestamp;
+            int pos = 0;
+            while (pos < (int)count) {
+                if (t < origin) {
+                    int skip = std::min<uint64_t>(count - pos, origin - t);
+                    pos += skip;
+                    t += skip;
+                    continue;
+                }
+                uint64_t hop = anchorHop + (t - origin) / dwell;
+                uint64_t offset = (t - origin) % dwell;
+                if (hop != current) {
+                    _this->finishHop(current, hopCount, out);
+                    // Hops skipped entirely by an overrun
+                    if (hop > current + 1) { _this->hopsLost += hop - current - 1; }
+                    current = hop;
+                }
+                int len = std::min<uint64_t>(count - pos, dwell - offset);
+                if (offset < settle) {
+                    // Still settling after the retune at the start of the hop
+                    len = std::min<uint64_t>(len, settle - offset);
+                }
+                else if (hop < scheduled) {
+                    _this->sweepStitcher.feed(hop % hopCount, &samples[pos], len);
+                }
+                pos += len;
+                t += len;
+            }
+        }
+
+        if (out != NULL) { fclose(out); }
+        _this->endSweep(ch);
+    }
+
+    // Retunes still queued in the FPGA would fire after the stop, and the board is left on
+    // some hop: the next (warm) start has to tune again whatever freq says
+    void endSweep(bladerf_channel ch) {
+        dev->cancelScheduledRetunes(ch);
+        applied.freq = -1;
+    }
+
+    void finishHop(uint64_t hop, int hopCount, FILE* out) {
+        int idx = hop % hopCount;
+        if (sweepStitcher.finishHop(idx)) {
+            hopsDone++;
+        }
+        else {
+            hopsLost++;
+        }
+        if (idx != hopCount - 1) { return; }
+
+        // Last hop of a sweep, publish the wideband spectrum
+        {
+            std::lock_guard<std::mutex> lck(sweepMtx);
+            sweepDisplay = sweepStitcher.spectrum;
+        }
+        sweepsDone++;
+        if (out == NULL) { return; }
+
+        // Same layout as rtl_power: date, time, Hz low, Hz high, Hz step, samples, dB...
+        time_t now = time(NULL);
+        char stamp[64];
+        strftime(stamp, sizeof(stamp), "%Y-%m-%d, %H:%M:%S", localtime(&now));
+        int bins = sweepStitcher.binsPerHop();
+        double binHz = sweepStitcher.binHz();
+        for (int h = 0; h < hopCount; h++) {
+            double low = sweepStitcher.hopFrequency(h) - (bins / 2) * binHz;
+            fprintf(out, "%s, %.0f, %.0f, %.2f, %d", stamp, low, low + bins * binHz, binHz, bins);
+            for (int i = 0; i < bins; i++) {
+                fprintf(out, ", %.2f", sweepStitcher.spectrum[h * bins + i]);
+            }
+            fprintf(out, "\n");
+        }
+        fflush(out);
+    }
+
+    // Appends one JSON object per interval to the metrics file
+    static void metricsWorker(void* ctx) {
+        bladeRFSourceModule* _this = (bladeRFSourceModule*)ctx;
+        std::ofstream file(_this->metricsPath, std::ios::app);
+        if (!file.is_open()) {
+            spdlog::error("Could not open metrics file {0}", _this->metricsPath);
+            return;
+        }
+
+        RateTracker rate;
+        CpuTracker cpu;
+        std::unique_lock<std::mutex> lck(_this->metricsMtx);
+        while (_this->metricsRunning) {
+            _this->metricsCnd.wait_for(lck, std::chrono::seconds(_this->metricsInterval));
+
+            json line = _this->metrics.toJson(rate.update(_this->metrics.samples));
+            line["time"] = (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+            line["serial"] = _this->selectedSerial;
+            line["instance"] = _this->name;
+            // Process wide, to see how the load grows with the number of boards
+            line["instances_streaming"] = (int)streamingInstances;
+            line["process_cpu"] = cpu.update();
+            line["overruns"] = (uint64_t)_this->rxOverruns;
+            line["timeouts"] = (uint64_t)_this->rxTimeouts;
+            line["lost_samples"] = (uint64_t)_this->rxLostSamples;
+            line["start_ms"] = _this->startMs;
+            line["rate_change_ms"] = _this->rateChangeMs;
+            line["warm_start"] = _this->startWarm;
+            if (_this->iqServer.isRunning()) {
+                IqServer::Stats st = _this->iqServer.stats();
+                line["server_clients"] = st.clients;
+                line["server_bytes"] = st.bytesSent;
+                line["server_skipped"] = st.blocksSkipped;
+            }
+            // Instances may share the file, keep their lines whole
+            std::lock_guard<std::mutex> fileLck(metricsFileMtx);
+            file << line.dump() << std::endl;
+        }
+    }
+
+    static void asyncWorker(void* ctx) {
+        bladeRFSourceModule* _this = (bladeRFSourceModule*)ctx;
+        // libbladeRF calls the stream callback from this thread
+        threadsched::applyToCurrentThread(_this->rxSched, "bladeRF RX thread");
+
+        // Like the sync worker, carry on after errors: a failed stream is set up again from scratch
+        int status = 0;
+        while (_this->acquiring) {
+            if (status != 0) {
+                _this->dev->deinitStream();
+                status = _this->configureStream();
+                if (status != 0) {
+                    spdlog::error("Could not restart the async stream on bladeRF {0}", _this->selectedSerial);
+                    spdlog::error(bladerf_strerror(status));
+                    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                    continue;
+                }
+            }
+
+            // Blocks until the callback returns BLADERF_STREAM_SHUTDOWN or the stream fails
+            status = _this->dev->runStream(_this->channel_layout);
+            if (status == 0) { break; }
+            spdlog::error("Async stream error on bladeRF {0}", _this->selectedSerial);
+            spdlog::error(bladerf_strerror(status));
+            _this->countRxError(status);
+        }
+    }
+
+    static void* asyncCallback(struct bladerf* dev, struct bladerf_stream* stream, struct bladerf_metadata* meta,
+                                void* samples, size_t num_samples, void* user_data) {
+        bladeRFSourceModule* _this = (bladeRFSourceModule*)user_data;
+
+        _this->rxBlocks++;
+        uint64_t burstEnd = _this->recordBlock(samples, num_samples);
+        if (!_this->deliver(samples, num_samples, burstEnd)) { return BLADERF_STREAM_SHUTDOWN; }
+
+        // The samples have been consumed, so the same buffer goes straight back to libbladeRF
+        return samples;
+    }
+
+    std::string name;
+    bool enabled = true;
+    dsp::stream<dsp::complex_t> stream;
+    double sampleRate;
+    uint32_t bandwidth;
+    SourceManager::SourceHandler handler;
+    bool running = false;
+    double freq;
+    std::string selectedSerial = "";
+    std::string sourceName;
+    uint64_t claimsSeen = 0;
     int devId       = 0;
     int srId        = 0;
     int bwId        = 0;
@@ -573,18 +2973,149 @@ private:
     unsigned int            buffer_size;
     unsigned int            num_transfers;
     unsigned int            stream_timeout;
+    streamtune::Params      tunedParams;    // num_buffers / buffer_size / num_transfers before sharing with other boards
+
+    // What was last written to the open board, so a warm start only re-applies what changed
+    struct DeviceState {
+        int xbMode = -1;
+        bool asyncRx = false;
+        bool mimo = false;
+        int primaryChannel = -1;
+        double sampleRate = 0;
+        uint32_t bandwidth = 0;
+        double freq = -1;
+        float lna = -1;
+        float rxvga1 = -1;
+        float rxvga2 = -1;
+        float rxGain[2] = { -100, -100 };
+        int xb200Mode = -1;
+        bladerf_channel_layout layout = BLADERF_RX_X1;
+        bladerf_format format = BLADERF_FORMAT_SC16_Q11;
+        unsigned int numBuffers = 0;
+        unsigned int bufferSize = 0;
+        unsigned int numTransfers = 0;
+        unsigned int timeout = 0;
+    };
+    DeviceState applied;
+    bool warmRestart = false;
+    double startMs = 0;
+    double stopMs = 0;
+    double rateChangeMs = 0;
+    bool startWarm = false;
+
+    bool streamAutoTune     = true;
+    int latencyMs           = 5;
+    int manualBuffers       = 16;
+    int manualBufferSize    = 4096;
+    int manualTransfers     = 8;
+
+    // RX thread scheduling and the buffers it works in, kept across runs
+    int rxPriority          = threadsched::PRIORITY_NORMAL;
+    int rxCore              = -1;
+    bool hugePages          = false;
+    threadsched::Options rxSched;
+    SampleBufferPool bufferPool;
+    int16_t* rxBlock        = NULL;
+
+    std::atomic<uint64_t> rxBlocks = 0;
+    std::atomic<uint64_t> rxOverruns = 0;
+    std::atomic<uint64_t> rxTimeouts = 0;
+
+    RxMetrics metrics;
+    RateTracker uiRate;
+    bool metricsExport = false;
+    char metricsPath[1024] = "";
+    int metricsInterval = 5;
+    bool metricsRunning = false;
+    std::thread metricsThread;
+
+    QuickTuneCache quickTune;
+
+    bool sweepMode = false;
+    double sweepStart = 88.0;
+    double sweepStop = 108.0;
+    double sweepStep = 0.0;
+    char sweepList[1024] = "";
+    int sweepDwellUs = 1000;
+    int sweepSettleUs = 100;
+    int sweepFftId = 2;
+    char sweepPath[1024] = "";
+    sweep::Stitcher sweepStitcher;
+    std::mutex sweepMtx;
+    std::vector<float> sweepDisplay;
+    std::atomic<uint64_t> sweepsDone = 0;
+    std::atomic<uint64_t> hopsDone = 0;
+    std::atomic<uint64_t> hopsLost = 0;
+    RateTracker hopRate;
+    std::thread retuneThread;
+    std::mutex retuneMtx;
+    std::condition_variable retuneCnd;
+    bool retuneRunning = false;
+    bool retunePending = false;
+    double retuneFreq = 0;
+    std::atomic<uint64_t> retunesCoalesced = 0;
+    std::mutex metricsMtx;
+    std::condition_variable metricsCnd;
+
+    int sampleFormat = SAMPLE_FORMAT_SC16;
+    bool sc8FellBack = false;       // The open board refused SC8_Q7, it streams SC16_Q11 instead
+
+    bool mimo = false;
+    int primaryChannel = 0;
+    float rxGain[2] = { 30, 30 };
+    char auxPath[1024] = "";
+    ChannelFileSink auxSink;
+    std::vector<dsp::complex_t> auxScratch;
+    bool metaRx = false;
+    bool zeroFill = false;
+    std::atomic<uint64_t> rxLostSamples = 0;
+    std::atomic<uint64_t> rxDiscontinuities = 0;
+    std::atomic<uint64_t> rxTimestamp = 0;
+    uint64_t nextTimestamp = 0;
+    bool haveTimestamp = false;
+    bool blockDiscontinuity = false;    // Samples were lost just before the last block read
 
     std::vector<std::string> devList;
     std::string devListTxt;
     std::vector<uint32_t> sampleRateList;
     std::string sampleRateListTxt;
+
+    // Hardware rate and resampling ratio behind each entry of sampleRateList
+    struct StreamRate {
+        uint32_t hwRate;
+        int interp;
+        int decim;
+    };
+    std::vector<StreamRate> streamRates;
+    bool lowRates = false;
+    Decimator decimator;
+
+    // DC / IQ correction
+    IqCalibrator iqCal;
+    bool iqCorrect = false;
+    bool iqHardware = false;
+    bool iqActive = false;
+
+    // AGC, agcActive tells the RX thread to feed it
+    int agcMode = 0;
+    Agc agc;
+    std::atomic<bool> agcActive = false;
+
+    // Power triggered capture, burstActive tells the RX and conversion threads to feed it
+    bool burstArmed = false;
+    char burstPath[1024] = "";
+    BurstCapture::Settings burstSettings;
+    BurstCapture burstCapture;
+    std::atomic<bool> burstActive = false;
     
     std::vector<uint32_t> bandwidthList;
     std::string bandwidthTxt;
+    DeviceCaps caps;
 
     /** [Opening a device] */
-    struct bladerf *dev = NULL;
-    struct bladerf_stream *bladerfStream;
+    BladeRFDevice* dev = NULL;
+    void** asyncBuffers = NULL;
+    bool asyncRx = false;
 
     /** [struct channel_config] */
     /* The RX and TX channels are configured independently for these parameters */
@@ -598,14 +3129,30 @@ private:
     /** [struct channel_config] */
 
     std::thread workerThread;
+    std::thread acquireThread;
+    std::atomic<bool> acquiring = false;
+    bool pipeline = false;
+    int ringDepth = 32;
+    SPSCBlockRing<int16_t> rawRing;
     FileSelect fileSelect;
     std::string bitstreamPath = "";
+    bool fpgaAutoload = false;
+    RawRecorder rawRecorder;
+    char recordPath[1024] = "";
+    FpgaLoader fpgaLoader;
+    char replayPath[1024] = "";
+    replay::Options replayOptions;
+    IqServer iqServer;
+    char serverHost[256] = "127.0.0.1";
+    int serverPort = IQ_SERVER_DEFAULT_PORT;
+    int serverProtocol = IqServer::PROTOCOL_TCP;
+    int serverPolicy = IqServer::SLOW_SKIP;
 };
 
 MOD_EXPORT void _INIT_() {
     json def = json({});
     def["devices"] = json({});
-    def["device"] = "";
+    def["instances"] = json({});
     config.setPath(options::opts.root + "/bladeRF_config.json");
     config.load(def);
     config.enableAutoSave();
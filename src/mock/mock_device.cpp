@@ -0,0 +1,324 @@
+#include <mock_device.h>
+#include <algorithm>
+#include <random>
+#include <thread>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define MOCK_SERIAL_PREFIX  "mock"
+#define MOCK_TABLE_LEN      (1 << 16)
+
+namespace mock {
+    static const struct bladerf_range sampleRateRange = { 80000, 61440000, 1, 1.0f };
+    static const struct bladerf_range bandwidthRange = { 1500000, 56000000, 1, 1.0f };
+
+    static const char* env(const char* name) {
+        const char* val = getenv(name);
+        return (val != NULL && val[0] != 0) ? val : NULL;
+    }
+
+    Options optionsFromEnv() {
+        Options opts;
+        if (env("BLADERF_MOCK_DEVICES")) { opts.deviceCount = atoi(env("BLADERF_MOCK_DEVICES")); }
+        if (env("BLADERF_MOCK_TONE_HZ")) { opts.toneHz = atof(env("BLADERF_MOCK_TONE_HZ")); }
+        if (env("BLADERF_MOCK_FILE")) { opts.file = env("BLADERF_MOCK_FILE"); }
+        if (env("BLADERF_MOCK_UNPACED")) { opts.paced = false; }
+        if (env("BLADERF_MOCK_OVERRUN_EVERY")) { opts.overrunEvery = atoi(env("BLADERF_MOCK_OVERRUN_EVERY")); }
+        if (env("BLADERF_MOCK_OVERRUN_SAMPLES")) { opts.overrunSamples = atoi(env("BLADERF_MOCK_OVERRUN_SAMPLES")); }
+        if (env("BLADERF_MOCK_TIMEOUT_EVERY")) { opts.timeoutEvery = atoi(env("BLADERF_MOCK_TIMEOUT_EVERY")); }
+        if (env("BLADERF_MOCK_TUNE_US")) { opts.tuneUs = atoi(env("BLADERF_MOCK_TUNE_US")); }
+        return opts;
+    }
+
+    std::vector<std::string> listDevices() {
+        std::vector<std::string> serials;
+        int count = optionsFromEnv().deviceCount;
+        for (int i = 0; i < count; i++) {
+            char buf[32];
+            sprintf(buf, MOCK_SERIAL_PREFIX "%04d", i);
+            serials.push_back(buf);
+        }
+        return serials;
+    }
+
+    bool isMockSerial(const std::string& serial) {
+        return serial.rfind(MOCK_SERIAL_PREFIX, 0) == 0;
+    }
+
+    BladeRFDevice* create() {
+        return new MockBladeRFDevice(optionsFromEnv());
+    }
+
+    BladeRFDevice* create(const Options& options) {
+        return new MockBladeRFDevice(options);
+    }
+
+    MockBladeRFDevice::MockBladeRFDevice(const Options& options) {
+        opts = options;
+        buildTable();
+    }
+
+    MockBladeRFDevice::~MockBladeRFDevice() {
+        close();
+    }
+
+    int MockBladeRFDevice::open(const std::string& serial) {
+        if (!isMockSerial(serial)) { return BLADERF_ERR_NODEV; }
+        if (!opts.file.empty()) {
+            file.open(opts.file, std::ios::binary);
+            if (!file.is_open()) { return BLADERF_ERR_IO; }
+        }
+        isOpen = true;
+        return 0;
+    }
+
+    void MockBladeRFDevice::close() {
+        deinitStream();
+        if (file.is_open()) { file.close(); }
+        isOpen = false;
+        enabled = false;
+    }
+
+    int MockBladeRFDevice::getSampleRateRange(bladerf_channel ch, const struct bladerf_range** range) {
+        *range = &sampleRateRange;
+        return 0;
+    }
+
+    int MockBladeRFDevice::getBandwidthRange(bladerf_channel ch, const struct bladerf_range** range) {
+        *range = &bandwidthRange;
+        return 0;
+    }
+
+    int MockBladeRFDevice::setSampleRate(bladerf_channel ch, bladerf_sample_rate rate, bladerf_sample_rate* actual) {
+        sampleRate = std::clamp<double>(rate, sampleRateRange.min, sampleRateRange.max);
+        if (actual != NULL) { *actual = (bladerf_sample_rate)sampleRate; }
+        buildTable();
+        return 0;
+    }
+
+    int MockBladeRFDevice::setBandwidth(bladerf_channel ch, bladerf_bandwidth bandwidth, bladerf_bandwidth* actual) {
+        if (actual != NULL) { *actual = std::clamp<bladerf_bandwidth>(bandwidth, bandwidthRange.min, bandwidthRange.max); }
+        return 0;
+    }
+
+    int MockBladeRFDevice::setFrequency(bladerf_channel ch, bladerf_frequency frequency) {
+        if (opts.tuneUs > 0) { std::this_thread::sleep_for(std::chrono::microseconds(opts.tuneUs)); }
+        this->frequency = frequency;
+        return 0;
+    }
+
+    int MockBladeRFDevice::getQuickTune(bladerf_channel ch, struct bladerf_quick_tune* quickTune) {
+        // Only needs to round trip through scheduleRetune()
+        memset(quickTune, 0, sizeof(*quickTune));
+        quickTune->nint = (uint16_t)(frequency / 1000000);
+        quickTune->nfrac = (uint32_t)(frequency % 1000000);
+        return 0;
+    }
+
+    int MockBladeRFDevice::getRxTimestamp(bladerf_timestamp* timestamp) {
+        // The board keeps counting while the host is busy, so this runs ahead of the delivered samples
+        if (opts.paced && timing) {
+            double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+            *timestamp = std::max<uint64_t>(this->timestamp, elapsed * sampleRate);
+            return 0;
+        }
+        *timestamp = this->timestamp;
+        return 0;
+    }
+
+    // Retunes take effect immediately, the synthetic signal doesn't depend on the frequency anyway
+    int MockBladeRFDevice::scheduleRetune(bladerf_channel ch, bladerf_timestamp timestamp, bladerf_frequency frequency,
+                                          struct bladerf_quick_tune* quickTune) {
+        if (quickTune == NULL) { return setFrequency(ch, frequency); }
+        if (opts.tuneUs > 0) { std::this_thread::sleep_for(std::chrono::microseconds(opts.tuneUs / 10)); }
+        this->frequency = frequency;
+        return 0;
+    }
+
+    int MockBladeRFDevice::enableModule(bladerf_channel ch, bool enable) {
+        enabled = enable;
+        timing = false;
+        timestamp = 0;
+        blocks = 0;
+        return 0;
+    }
+
+    int MockBladeRFDevice::syncConfig(bladerf_channel_layout layout, bladerf_format format, unsigned int numBuffers,
+                                      unsigned int bufferSize, unsigned int numTransfers, unsigned int timeout) {
+        if (!isOpen || bufferSize % 1024 != 0 || numTransfers >= numBuffers) { return BLADERF_ERR_INVAL; }
+        this->format = format;
+        // Timestamps and pacing count samples per channel
+        channels = (layout == BLADERF_RX_X2) ? 2 : 1;
+        hostBufferSamples = numBuffers * bufferSize / channels;
+        return 0;
+    }
+
+    int MockBladeRFDevice::syncRx(void* samples, unsigned int numSamples, struct bladerf_metadata* meta, unsigned int timeout) {
+        if (!isOpen || hostBufferSamples == 0) { return BLADERF_ERR_INVAL; }
+
+        bool overrun = false;
+        int status = pace(numSamples / channels, timeout, overrun);
+        if (status != 0) { return status; }
+
+        fill(samples, numSamples);
+        if (meta != NULL) {
+            meta->timestamp = timestamp;
+            meta->actual_count = numSamples;
+            meta->status = overrun ? BLADERF_META_STATUS_OVERRUN : 0;
+        }
+        timestamp += numSamples / channels;
+        return 0;
+    }
+
+    int MockBladeRFDevice::initStream(bladerf_stream_cb callback, void*** buffers, size_t numBuffers, bladerf_format format,
+                                      size_t samplesPerBuffer, size_t numTransfers, void* userData) {
+        if (!isOpen || samplesPerBuffer % 1024 != 0 || numTransfers >= numBuffers) { return BLADERF_ERR_INVAL; }
+        deinitStream();
+        this->format = format;
+        streamCallback = callback;
+        streamUserData = userData;
+        streamSamples = samplesPerBuffer;
+        channels = 1;
+        hostBufferSamples = numBuffers * samplesPerBuffer;
+        for (size_t i = 0; i < numBuffers; i++) {
+            streamBuffers.push_back(new int16_t[samplesPerBuffer * 2]);
+        }
+        *buffers = streamBuffers.data();
+        return 0;
+    }
+
+    int MockBladeRFDevice::setStreamTimeout(unsigned int timeout) {
+        streamTimeout = timeout;
+        return 0;
+    }
+
+    int MockBladeRFDevice::runStream(bladerf_channel_layout layout) {
+        if (streamBuffers.empty()) { return BLADERF_ERR_INVAL; }
+        channels = (layout == BLADERF_RX_X2) ? 2 : 1;
+        hostBufferSamples = streamBuffers.size() * streamSamples / channels;
+
+        void* next = streamBuffers[0];
+        while (true) {
+            bool overrun = false;
+            int status = pace(streamSamples / channels, streamTimeout, overrun);
+            if (status != 0) { return status; }
+
+            fill(next, streamSamples);
+            struct bladerf_metadata meta;
+            memset(&meta, 0, sizeof(meta));
+            meta.timestamp = timestamp;
+            meta.actual_count = streamSamples;
+            meta.status = overrun ? BLADERF_META_STATUS_OVERRUN : 0;
+            timestamp += streamSamples / channels;
+
+            void* ret = streamCallback(NULL, NULL, &meta, next, streamSamples, streamUserData);
+            if (ret == BLADERF_STREAM_SHUTDOWN) { break; }
+            if (ret != BLADERF_STREAM_NO_DATA) { next = ret; }
+        }
+        return 0;
+    }
+
+    void MockBladeRFDevice::deinitStream() {
+        for (void* buf : streamBuffers) {
+            delete[] (int16_t*)buf;
+        }
+        streamBuffers.clear();
+        streamCallback = NULL;
+    }
+
+    // One table period holds an integer number of tone cycles so it loops cleanly
+    void MockBladeRFDevice::buildTable() {
+        table.resize(MOCK_TABLE_LEN * 2);
+        table8.resize(MOCK_TABLE_LEN * 2);
+        double bin = round(opts.toneHz / sampleRate * MOCK_TABLE_LEN);
+        std::mt19937 rng(1234);
+        std::uniform_real_distribution<float> noise(-opts.noiseAmplitude, opts.noiseAmplitude);
+        for (int i = 0; i < MOCK_TABLE_LEN; i++) {
+            double phase = 2.0 * M_PI * bin * (double)i / (double)MOCK_TABLE_LEN;
+            float re = opts.toneAmplitude * cos(phase) + noise(rng) + noise(rng);
+            float im = opts.toneAmplitude * sin(phase) + noise(rng) + noise(rng);
+            table[i * 2] = (int16_t)std::clamp<float>(roundf(re * 2048.0f), -2048, 2047);
+            table[(i * 2) + 1] = (int16_t)std::clamp<float>(roundf(im * 2048.0f), -2048, 2047);
+            table8[i * 2] = (int8_t)(table[i * 2] >> 4);
+            table8[(i * 2) + 1] = (int8_t)(table[(i * 2) + 1] >> 4);
+        }
+        tablePos = 0;
+    }
+
+    void MockBladeRFDevice::fill(void* samples, unsigned int count) {
+        bool sc8 = (format == BLADERF_FORMAT_SC8_Q7 || format == BLADERF_FORMAT_SC8_Q7_META);
+
+        // Files are expected in the wire format that was configured
+        if (file.is_open()) {
+            size_t bytes = (size_t)count * (sc8 ? 2 * sizeof(int8_t) : 2 * sizeof(int16_t));
+            char* out = (char*)samples;
+            size_t done = 0;
+            while (done < bytes) {
+                file.read(out + done, bytes - done);
+                done += file.gcount();
+                if (done < bytes) {
+                    file.clear();
+                    file.seekg(0);
+                    // An empty file would loop forever, pad with silence instead
+                    if (file.peek() == EOF) {
+                        memset(out + done, 0, bytes - done);
+                        break;
+                    }
+                }
+            }
+            return;
+        }
+
+        int16_t* out16 = (int16_t*)samples;
+        int8_t* out8 = (int8_t*)samples;
+        while (count > 0) {
+            unsigned int chunk = std::min<size_t>(count, MOCK_TABLE_LEN - tablePos);
+            if (sc8) {
+                memcpy(out8, &table8[tablePos * 2], chunk * 2 * sizeof(int8_t));
+                out8 += chunk * 2;
+            }
+            else {
+                memcpy(out16, &table[tablePos * 2], chunk * 2 * sizeof(int16_t));
+                out16 += chunk * 2;
+            }
+            count -= chunk;
+            tablePos = (tablePos + chunk) % MOCK_TABLE_LEN;
+        }
+    }
+
+    // Wait until the simulated board has produced the requested samples. If the
+    // caller fell further behind than the host buffers can hold, the excess is
+    // dropped and flagged, like libbladeRF would on a real overrun.
+    int MockBladeRFDevice::pace(unsigned int count, unsigned int timeout, bool& overrun) {
+        if (!timing) {
+            startTime = std::chrono::steady_clock::now();
+            timing = true;
+        }
+        blocks++;
+
+        if (opts.timeoutEvery > 0 && (blocks % opts.timeoutEvery) == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(timeout));
+            return BLADERF_ERR_TIMEOUT;
+        }
+
+        if (opts.overrunEvery > 0 && (blocks % opts.overrunEvery) == 0) {
+            timestamp += opts.overrunSamples;
+            overrun = true;
+        }
+
+        if (!opts.paced) { return 0; }
+
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+        double produced = elapsed * sampleRate;
+        if (produced > (double)(timestamp + hostBufferSamples + count)) {
+            timestamp = (uint64_t)produced - hostBufferSamples;
+            overrun = true;
+        }
+
+        auto ready = startTime + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>((double)(timestamp + count) / sampleRate));
+        std::this_thread::sleep_until(ready);
+        return 0;
+    }
+}
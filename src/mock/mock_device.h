@@ -0,0 +1,113 @@
+#pragma once
+#include <bladerf_device.h>
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Simulated bladeRF for running the module without hardware. Samples come from a
+// precomputed tone + noise table or a looped raw SC16_Q11 file, delivered at the
+// configured sample rate in real time (or as fast as possible), with optional
+// injected overruns and timeouts. Consumers that fall behind real time overrun
+// exactly like they would on a real board.
+namespace mock {
+    struct Options {
+        int deviceCount         = 1;
+        double toneHz           = 100000.0;     // Offset from the center frequency
+        float toneAmplitude     = 0.5f;         // Fraction of full scale
+        float noiseAmplitude    = 0.01f;
+        std::string file        = "";           // Raw interleaved SC16_Q11, looped
+        bool paced              = true;
+        int overrunEvery        = 0;            // Blocks between injected overruns, 0 = never
+        int overrunSamples      = 4096;
+        int timeoutEvery        = 0;            // Blocks between injected timeouts, 0 = never
+        int tuneUs              = 0;            // Simulated full tune time, quick tunes take a tenth
+    };
+
+    // BLADERF_MOCK_DEVICES, BLADERF_MOCK_TONE_HZ, BLADERF_MOCK_FILE, BLADERF_MOCK_UNPACED,
+    // BLADERF_MOCK_OVERRUN_EVERY, BLADERF_MOCK_OVERRUN_SAMPLES, BLADERF_MOCK_TIMEOUT_EVERY,
+    // BLADERF_MOCK_TUNE_US
+    Options optionsFromEnv();
+
+    std::vector<std::string> listDevices();
+    bool isMockSerial(const std::string& serial);
+    BladeRFDevice* create();
+    BladeRFDevice* create(const Options& options);
+
+    class MockBladeRFDevice : public BladeRFDevice {
+    public:
+        MockBladeRFDevice(const Options& options);
+        ~MockBladeRFDevice();
+
+        int open(const std::string& serial);
+        void close();
+
+        int loadFpga(const char* path) { return 0; }
+        int isFpgaConfigured() { return 1; }
+        int getFpgaSize(bladerf_fpga_size* size) { *size = BLADERF_FPGA_A4; return 0; }
+        int fpgaVersion(std::string& version) { version = "0.0.0-mock"; return 0; }
+        std::string boardName() { return "mock"; }
+
+        int getSampleRateRange(bladerf_channel ch, const struct bladerf_range** range);
+        int getBandwidthRange(bladerf_channel ch, const struct bladerf_range** range);
+        int setSampleRate(bladerf_channel ch, bladerf_sample_rate rate, bladerf_sample_rate* actual);
+        int setBandwidth(bladerf_channel ch, bladerf_bandwidth bandwidth, bladerf_bandwidth* actual);
+        int setFrequency(bladerf_channel ch, bladerf_frequency frequency);
+        int getQuickTune(bladerf_channel ch, struct bladerf_quick_tune* quickTune);
+        int scheduleRetune(bladerf_channel ch, bladerf_timestamp timestamp, bladerf_frequency frequency,
+                           struct bladerf_quick_tune* quickTune);
+        int cancelScheduledRetunes(bladerf_channel ch) { return 0; }
+        int getRxTimestamp(bladerf_timestamp* timestamp);
+        int setGainStage(bladerf_channel ch, const char* stage, bladerf_gain gain) { return 0; }
+        int setGain(bladerf_channel ch, bladerf_gain gain) { return 0; }
+        int setGainMode(bladerf_channel ch, bladerf_gain_mode mode) { return 0; }
+        int enableModule(bladerf_channel ch, bool enable);
+        // The synthetic signal has no analog impairments to correct
+        int setCorrection(bladerf_channel ch, bladerf_correction corr, bladerf_correction_value value) { return BLADERF_ERR_UNSUPPORTED; }
+
+        int expansionAttach(bladerf_xb xb) { return 0; }
+        int xb200SetPath(bladerf_channel ch, bladerf_xb200_path path) { return 0; }
+        int xb200SetFilterbank(bladerf_channel ch, bladerf_xb200_filter filter) { return 0; }
+
+        int syncConfig(bladerf_channel_layout layout, bladerf_format format, unsigned int numBuffers,
+                       unsigned int bufferSize, unsigned int numTransfers, unsigned int timeout);
+        int syncRx(void* samples, unsigned int numSamples, struct bladerf_metadata* meta, unsigned int timeout);
+
+        int initStream(bladerf_stream_cb callback, void*** buffers, size_t numBuffers, bladerf_format format,
+                       size_t samplesPerBuffer, size_t numTransfers, void* userData);
+        int setStreamTimeout(unsigned int timeout);
+        int runStream(bladerf_channel_layout layout);
+        void deinitStream();
+
+    private:
+        void buildTable();
+        void fill(void* samples, unsigned int count);
+        int pace(unsigned int count, unsigned int timeout, bool& overrun);
+
+        Options opts;
+        bool isOpen = false;
+        bool enabled = false;
+
+        double sampleRate = 1000000.0;
+        bladerf_frequency frequency = 100000000;
+        bladerf_format format = BLADERF_FORMAT_SC16_Q11;
+        unsigned int hostBufferSamples = 0;
+        unsigned int channels = 1;
+
+        std::vector<int16_t> table;
+        std::vector<int8_t> table8;
+        size_t tablePos = 0;
+        std::ifstream file;
+
+        bool timing = false;
+        std::chrono::steady_clock::time_point startTime;
+        uint64_t timestamp = 0;
+        uint64_t blocks = 0;
+
+        bladerf_stream_cb streamCallback = NULL;
+        void* streamUserData = NULL;
+        std::vector<void*> streamBuffers;
+        size_t streamSamples = 0;
+        unsigned int streamTimeout = 1000;
+    };
+}
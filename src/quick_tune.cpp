@@ -0,0 +1,37 @@
+#include <quick_tune.h>
+
+// The bladeRF 2.0 keeps quick-tune profiles in FPGA memory, which has room for 256 of them
+#define MAX_ENTRIES 256
+
+uint64_t QuickTuneCache::key(bladerf_channel ch, bladerf_frequency freq) {
+    // Frequencies fit in 40 bits (< 1 THz)
+    return ((uint64_t)ch << 40) | (freq & ((1ULL << 40) - 1));
+}
+
+struct bladerf_quick_tune* QuickTuneCache::find(bladerf_channel ch, bladerf_frequency freq) {
+    auto it = entries.find(key(ch, freq));
+    if (it == entries.end()) {
+        misses++;
+        return NULL;
+    }
+    hits++;
+    return &it->second;
+}
+
+void QuickTuneCache::store(bladerf_channel ch, bladerf_frequency freq, const struct bladerf_quick_tune& qt) {
+    if (entries.size() >= MAX_ENTRIES) {
+        // Older profiles have been overwritten on the board, start over
+        entries.clear();
+    }
+    entries[key(ch, freq)] = qt;
+}
+
+void QuickTuneCache::remove(bladerf_channel ch, bladerf_frequency freq) {
+    entries.erase(key(ch, freq));
+}
+
+void QuickTuneCache::clear() {
+    entries.clear();
+    hits = 0;
+    misses = 0;
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <libbladeRF.h>
+#include <stdint.h>
+#include <map>
+#include <atomic>
+
+// Quick-tune parameters captured with bladerf_get_quick_tune after a full tune,
+// so returning to a frequency can skip the PLL/VCO search entirely.
+// The entries are only valid for the board (and FPGA image) they were read from:
+// clear() whenever the device is reopened. Not thread safe, owned by the retune path.
+class QuickTuneCache {
+public:
+    // Returns NULL when the frequency has not been visited on this channel yet
+    struct bladerf_quick_tune* find(bladerf_channel ch, bladerf_frequency freq);
+    void store(bladerf_channel ch, bladerf_frequency freq, const struct bladerf_quick_tune& qt);
+    void remove(bladerf_channel ch, bladerf_frequency freq);
+    void clear();
+
+    int size() { return entries.size(); }
+
+    std::atomic<uint64_t> hits = 0;
+    std::atomic<uint64_t> misses = 0;
+
+private:
+    static uint64_t key(bladerf_channel ch, bladerf_frequency freq);
+
+    std::map<uint64_t, struct bladerf_quick_tune> entries;
+};
@@ -0,0 +1,221 @@
+#include <raw_recorder.h>
+#include <spdlog/spdlog.h>
+#include <fstream>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+// O_DIRECT needs buffers, offsets and sizes aligned to the logical block size, a page covers every disk
+#define RECORDER_ALIGN          4096
+#define RECORDER_CHUNK_BYTES    (8 * 1024 * 1024)
+
+RawRecorder::~RawRecorder() {
+    stop();
+}
+
+bool RawRecorder::start(const std::string& basePath, const Info& info, int sampleBytes, double bufferSeconds) {
+    if (enabled) { return true; }
+    this->basePath = basePath;
+    this->info = info;
+    this->sampleBytes = sampleBytes;
+
+    std::string dataPath = basePath + ".sigmf-data";
+#ifdef _WIN32
+    fd = _open(dataPath.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, 0644);
+    direct = false;
+#else
+    int flags = O_WRONLY | O_CREAT | O_TRUNC;
+#ifdef O_DIRECT
+    fd = open(dataPath.c_str(), flags | O_DIRECT, 0644);
+    direct = (fd >= 0);
+    // Some filesystems (tmpfs, network mounts) refuse O_DIRECT
+    if (fd < 0) { fd = open(dataPath.c_str(), flags, 0644); }
+#else
+    fd = open(dataPath.c_str(), flags, 0644);
+    direct = false;
+#endif
+#endif
+    if (fd < 0) {
+        spdlog::error("Could not open {0} for recording", dataPath);
+        return false;
+    }
+
+    double bytesPerSecond = info.sampleRate * info.channels * sampleBytes;
+    int depth = std::max<int>(4, (bytesPerSecond * bufferSeconds) / RECORDER_CHUNK_BYTES);
+    chunkBytes = RECORDER_CHUNK_BYTES;
+    ring.init(depth, chunkBytes, RECORDER_ALIGN);
+    chunk = ring.writeSlot();
+    chunkFill = 0;
+
+    frequency = info.frequency;
+    samplesQueued = 0;
+    nextTimestamp = RAW_RECORDER_NO_TIMESTAMP;
+    newSegment = true;
+    captures = json::array();
+    written = 0;
+    dropped = 0;
+    failed = false;
+
+    writerThread = std::thread(writer, this);
+    enabled = true;
+    spdlog::info("Recording to {0} ({1} MB buffered{2})", dataPath, (depth * (size_t)chunkBytes) >> 20, direct ? ", O_DIRECT" : "");
+    return true;
+}
+
+void RawRecorder::stop() {
+    if (!enabled) { return; }
+
+    // Wait out a block the RX thread may be in the middle of copying
+    enabled = false;
+    while (producerActive) { std::this_thread::yield(); }
+
+    // The last chunk is partial, so it can't go through O_DIRECT
+    if (chunkFill > 0 && chunk != NULL) {
+        ring.commitWrite(chunkFill);
+    }
+    ring.stop();
+    writerThread.join();
+
+    // Anything committed after the writer saw the stop, including the partial chunk
+    int count;
+    uint8_t* block;
+    while (ring.fill() > 0 && (block = ring.readSlot(count)) != NULL) {
+#if !defined(_WIN32) && defined(O_DIRECT)
+        if (direct && (count % RECORDER_ALIGN) != 0) {
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_DIRECT);
+            direct = false;
+        }
+#endif
+#ifdef _WIN32
+        int n = _write(fd, block, count);
+#else
+        ssize_t n = ::write(fd, block, count);
+#endif
+        if (n > 0) { written += n; }
+        ring.commitRead();
+    }
+
+#ifdef _WIN32
+    _close(fd);
+#else
+    close(fd);
+#endif
+    fd = -1;
+    ring.free();
+    chunk = NULL;
+
+    writeMeta();
+    spdlog::info("Recorded {0} bytes to {1}.sigmf-data, {2} blocks dropped", (uint64_t)written, basePath, (uint64_t)dropped);
+}
+
+void RawRecorder::write(const void* data, int count, uint64_t timestamp) {
+    producerActive = true;
+    if (!enabled) {
+        producerActive = false;
+        return;
+    }
+
+    size_t bytes = (size_t)count * sampleBytes;
+    int chunksNeeded = (chunkFill + bytes) / chunkBytes;
+    // The current chunk is already taken, every chunk this block completes needs a free one after it
+    if (chunk == NULL || failed || ring.fill() + chunksNeeded > ring.depth() - 1) {
+        dropped++;
+        newSegment = true;
+        producerActive = false;
+        return;
+    }
+
+    uint64_t perChannel = count / info.channels;
+    double freq = frequency;
+    if (newSegment || freq != segmentFreq || (timestamp != RAW_RECORDER_NO_TIMESTAMP && timestamp != nextTimestamp)) {
+        segmentFreq = freq;
+        addCapture(timestamp);
+        newSegment = false;
+    }
+    if (timestamp != RAW_RECORDER_NO_TIMESTAMP) { nextTimestamp = timestamp + perChannel; }
+    samplesQueued += perChannel;
+
+    const uint8_t* in = (const uint8_t*)data;
+    while (bytes > 0) {
+        size_t n = std::min<size_t>(bytes, chunkBytes - chunkFill);
+        memcpy(chunk + chunkFill, in, n);
+        chunkFill += n;
+        in += n;
+        bytes -= n;
+        if (chunkFill == chunkBytes) {
+            ring.commitWrite(chunkBytes);
+            chunk = ring.writeSlot();
+            chunkFill = 0;
+        }
+    }
+
+    producerActive = false;
+}
+
+void RawRecorder::addCapture(uint64_t timestamp) {
+    json cap = json({});
+    cap["core:sample_start"] = samplesQueued;
+    cap["core:frequency"] = segmentFreq;
+    if (samplesQueued == 0) {
+        char buf[64];
+        time_t now = time(NULL);
+        strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+        cap["core:datetime"] = std::string(buf);
+    }
+    if (timestamp != RAW_RECORDER_NO_TIMESTAMP) {
+        cap["bladerf:timestamp"] = timestamp;
+    }
+    captures.push_back(cap);
+}
+
+void RawRecorder::writeMeta() {
+    json meta = json({});
+    meta["global"]["core:datatype"] = info.datatype;
+    meta["global"]["core:sample_rate"] = info.sampleRate;
+    meta["global"]["core:version"] = "1.0.0";
+    meta["global"]["core:num_channels"] = info.channels;
+    meta["global"]["core:recorder"] = "sdrpp bladerf_source";
+    meta["global"]["core:hw"] = "bladeRF";
+    for (auto& item : info.hardware.items()) {
+        meta["global"]["bladerf:" + item.key()] = item.value();
+    }
+    meta["global"]["bladerf:dropped_blocks"] = (uint64_t)dropped;
+    meta["captures"] = captures;
+    meta["annotations"] = json::array();
+
+    std::ofstream file(basePath + ".sigmf-meta");
+    if (!file.is_open()) {
+        spdlog::error("Could not write {0}.sigmf-meta", basePath);
+        return;
+    }
+    file << meta.dump(4) << std::endl;
+}
+
+void RawRecorder::writer(RawRecorder* _this) {
+    int count;
+    while (true) {
+        // Only full chunks come through here while recording, the partial tail is written by stop()
+        if (_this->ring.fill() == 0 && !_this->enabled) { break; }
+        uint8_t* block = _this->ring.readSlot(count);
+        if (block == NULL) { break; }
+        if (count != _this->chunkBytes) { break; }
+#ifdef _WIN32
+        int n = _write(_this->fd, block, count);
+#else
+        ssize_t n = ::write(_this->fd, block, count);
+#endif
+        if (n != count) {
+            spdlog::error("Recording write failed, stopping");
+            _this->failed = true;
+            _this->ring.commitRead();
+            break;
+        }
+        _this->written += n;
+        _this->ring.commitRead();
+    }
+}
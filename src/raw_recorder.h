@@ -0,0 +1,76 @@
+#pragma once
+#include <spsc_ring.h>
+#include <config.h>
+#include <atomic>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define RAW_RECORDER_NO_TIMESTAMP   UINT64_MAX
+
+// Records the raw sample blocks exactly as libbladeRF delivers them, no conversion,
+// as a SigMF recording (<base>.sigmf-data + <base>.sigmf-meta).
+//
+// The RX thread copies each block into large page aligned chunks, a writer thread
+// writes full chunks sequentially, with O_DIRECT where available so the page cache
+// doesn't have to absorb hundreds of MB/s. The RX side never blocks: when every
+// chunk is waiting on the disk the block is dropped, counted, and a new SigMF
+// capture segment starts so sample indices stay consistent with timestamps.
+class RawRecorder {
+public:
+    struct Info {
+        std::string datatype;       // SigMF type, "ci16_le" or "ci8"
+        double sampleRate;
+        double frequency;
+        int channels;
+        json hardware;              // Gains and such, stored under "bladerf:" in the global object
+    };
+
+    ~RawRecorder();
+
+    // bufferSeconds of data at the given rate is preallocated
+    bool start(const std::string& basePath, const Info& info, int sampleBytes, double bufferSeconds);
+    void stop();
+    bool isRunning() { return enabled; }
+
+    // RX thread only. count is in samples of all channels; timestamp is the hardware
+    // timestamp of the first sample or RAW_RECORDER_NO_TIMESTAMP.
+    void write(const void* data, int count, uint64_t timestamp);
+
+    // Any thread, takes effect with the next block
+    void setFrequency(double freq) { frequency = freq; }
+
+    uint64_t bytesWritten() { return written; }
+    uint64_t droppedBlocks() { return dropped; }
+
+private:
+    void addCapture(uint64_t timestamp);
+    void writeMeta();
+    static void writer(RawRecorder* _this);
+
+    SPSCBlockRing<uint8_t> ring;
+    int chunkBytes = 0;
+    uint8_t* chunk = NULL;
+    int chunkFill = 0;
+
+    int fd = -1;
+    bool direct = false;
+    std::thread writerThread;
+    std::atomic<bool> enabled = false;
+    std::atomic<bool> producerActive = false;
+    std::atomic<bool> failed = false;
+
+    std::string basePath;
+    Info info;
+    int sampleBytes = 4;
+    std::atomic<double> frequency = 0.0;
+    double segmentFreq = 0.0;
+    uint64_t samplesQueued = 0;     // Per channel
+    uint64_t nextTimestamp = RAW_RECORDER_NO_TIMESTAMP;
+    bool newSegment = true;
+    json captures;
+
+    std::atomic<uint64_t> written = 0;
+    std::atomic<uint64_t> dropped = 0;
+};
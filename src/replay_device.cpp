@@ -0,0 +1,413 @@
+#include <replay_device.h>
+#include <config.h>
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <fstream>
+#include <thread>
+#include <string.h>
+#include <math.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define REPLAY_SERIAL_PREFIX    "replay:"
+
+namespace replay {
+    static const struct bladerf_range sampleRateRange = { 160000, 61440000, 1, 1.0f };
+    static const struct bladerf_range bandwidthRange = { 1500000, 56000000, 1, 1.0f };
+
+    static bool endsWith(const std::string& str, const std::string& suffix) {
+        return str.size() >= suffix.size() && str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+
+    bool isReplaySerial(const std::string& serial) {
+        return serial.rfind(REPLAY_SERIAL_PREFIX, 0) == 0;
+    }
+
+    std::string serialFor(const std::string& path) {
+        return REPLAY_SERIAL_PREFIX + path;
+    }
+
+    std::string pathFor(const std::string& serial) {
+        return isReplaySerial(serial) ? serial.substr(strlen(REPLAY_SERIAL_PREFIX)) : "";
+    }
+
+    BladeRFDevice* create(const std::string& serial, const Options& options) {
+        return new ReplayBladeRFDevice(options);
+    }
+
+    MappedFile::~MappedFile() {
+        close();
+    }
+
+#ifdef _WIN32
+    bool MappedFile::open(const std::string& path) {
+        close();
+        HANDLE fh = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                                FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+        if (fh == INVALID_HANDLE_VALUE) { return false; }
+        LARGE_INTEGER sz;
+        if (!GetFileSizeEx(fh, &sz) || sz.QuadPart == 0) {
+            CloseHandle(fh);
+            return false;
+        }
+        HANDLE mh = CreateFileMappingA(fh, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mh == NULL) {
+            CloseHandle(fh);
+            return false;
+        }
+        void* view = MapViewOfFile(mh, FILE_MAP_READ, 0, 0, 0);
+        if (view == NULL) {
+            CloseHandle(mh);
+            CloseHandle(fh);
+            return false;
+        }
+        fileHandle = fh;
+        mapHandle = mh;
+        base = (const uint8_t*)view;
+        length = (size_t)sz.QuadPart;
+        return true;
+    }
+
+    void MappedFile::close() {
+        if (base != NULL) { UnmapViewOfFile(base); }
+        if (mapHandle != NULL) { CloseHandle((HANDLE)mapHandle); }
+        if (fileHandle != NULL) { CloseHandle((HANDLE)fileHandle); }
+        base = NULL;
+        length = 0;
+        mapHandle = NULL;
+        fileHandle = NULL;
+    }
+#else
+    bool MappedFile::open(const std::string& path) {
+        close();
+        int f = ::open(path.c_str(), O_RDONLY);
+        if (f < 0) { return false; }
+        struct stat st;
+        if (fstat(f, &st) != 0 || st.st_size == 0) {
+            ::close(f);
+            return false;
+        }
+        void* view = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, f, 0);
+        if (view == MAP_FAILED) {
+            ::close(f);
+            return false;
+        }
+        // Playback is one long sequential read, let the kernel read ahead aggressively
+        madvise(view, st.st_size, MADV_SEQUENTIAL);
+        fd = f;
+        base = (const uint8_t*)view;
+        length = st.st_size;
+        return true;
+    }
+
+    void MappedFile::close() {
+        if (base != NULL) { munmap((void*)base, length); }
+        if (fd >= 0) { ::close(fd); }
+        base = NULL;
+        length = 0;
+        fd = -1;
+    }
+#endif
+
+    ReplayBladeRFDevice::ReplayBladeRFDevice(const Options& options) {
+        opts = options;
+    }
+
+    ReplayBladeRFDevice::~ReplayBladeRFDevice() {
+        close();
+    }
+
+    int ReplayBladeRFDevice::open(const std::string& serial) {
+        if (!isReplaySerial(serial)) { return BLADERF_ERR_NODEV; }
+        std::string path = pathFor(serial);
+
+        // Either half of a SigMF pair selects the recording, anything else is raw SC16_Q11
+        fileSc8 = false;
+        fileChannels = 1;
+        fileSampleRate = 0;
+        fileFrequency = 0;
+        if (endsWith(path, ".sigmf-meta") || endsWith(path, ".sigmf-data")) {
+            std::string base = path.substr(0, path.size() - strlen(".sigmf-meta"));
+            path = base + ".sigmf-data";
+
+            json meta;
+            try {
+                std::ifstream metaFile(base + ".sigmf-meta");
+                meta = json::parse(metaFile);
+            }
+            catch (std::exception& e) {
+                spdlog::error("Could not read {0}.sigmf-meta: {1}", base, e.what());
+                return BLADERF_ERR_IO;
+            }
+
+            std::string datatype = meta["global"].contains("core:datatype") ? meta["global"]["core:datatype"].get<std::string>() : "";
+            if (datatype == "ci8") {
+                fileSc8 = true;
+            }
+            else if (datatype != "ci16_le") {
+                spdlog::error("Cannot replay SigMF datatype '{0}', only ci16_le and ci8 are supported", datatype);
+                return BLADERF_ERR_UNSUPPORTED;
+            }
+            if (meta["global"].contains("core:num_channels")) { fileChannels = meta["global"]["core:num_channels"]; }
+            if (meta["global"].contains("core:sample_rate")) { fileSampleRate = meta["global"]["core:sample_rate"]; }
+            if (meta.contains("captures") && meta["captures"].size() > 0 && meta["captures"][0].contains("core:frequency")) {
+                fileFrequency = meta["captures"][0]["core:frequency"];
+            }
+            if (fileChannels < 1 || fileChannels > 2) { return BLADERF_ERR_UNSUPPORTED; }
+        }
+
+        if (!file.open(path)) {
+            spdlog::error("Could not map {0}", path);
+            return BLADERF_ERR_IO;
+        }
+        frameBytes = fileChannels * 2 * (fileSc8 ? sizeof(int8_t) : sizeof(int16_t));
+        totalFrames = file.size() / frameBytes;
+        if (totalFrames == 0) {
+            file.close();
+            return BLADERF_ERR_IO;
+        }
+        position = 0;
+        exhausted = false;
+        isOpen = true;
+        spdlog::info("Replaying {0}: {1} samples, {2} channel(s), {3}", path, totalFrames, fileChannels, fileSc8 ? "ci8" : "ci16_le");
+        if (fileSampleRate > 0) {
+            spdlog::info("Recorded at {0} S/s, {1} Hz", fileSampleRate, fileFrequency);
+        }
+        return 0;
+    }
+
+    void ReplayBladeRFDevice::close() {
+        deinitStream();
+        file.close();
+        isOpen = false;
+    }
+
+    int ReplayBladeRFDevice::getSampleRateRange(bladerf_channel ch, const struct bladerf_range** range) {
+        *range = &sampleRateRange;
+        return 0;
+    }
+
+    int ReplayBladeRFDevice::getBandwidthRange(bladerf_channel ch, const struct bladerf_range** range) {
+        *range = &bandwidthRange;
+        return 0;
+    }
+
+    // Any rate is accepted, it only sets the playback speed
+    int ReplayBladeRFDevice::setSampleRate(bladerf_channel ch, bladerf_sample_rate rate, bladerf_sample_rate* actual) {
+        sampleRate = rate;
+        if (actual != NULL) { *actual = rate; }
+        if (fileSampleRate > 0 && fabs(fileSampleRate - rate) > 1.0) {
+            spdlog::warn("Replaying a {0} S/s recording at {1} S/s", fileSampleRate, (double)rate);
+        }
+        return 0;
+    }
+
+    int ReplayBladeRFDevice::setBandwidth(bladerf_channel ch, bladerf_bandwidth bandwidth, bladerf_bandwidth* actual) {
+        if (actual != NULL) { *actual = bandwidth; }
+        return 0;
+    }
+
+    int ReplayBladeRFDevice::getQuickTune(bladerf_channel ch, struct bladerf_quick_tune* quickTune) {
+        memset(quickTune, 0, sizeof(*quickTune));
+        return 0;
+    }
+
+    int ReplayBladeRFDevice::getRxTimestamp(bladerf_timestamp* timestamp) {
+        if (opts.paced && timing) {
+            double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+            *timestamp = std::max<uint64_t>(this->timestamp, elapsed * sampleRate);
+            return 0;
+        }
+        *timestamp = this->timestamp;
+        return 0;
+    }
+
+    // Enabling the RX module restarts the timestamp counter, the file position carries on
+    int ReplayBladeRFDevice::enableModule(bladerf_channel ch, bool enable) {
+        timing = false;
+        timestamp = 0;
+        return 0;
+    }
+
+    // The recording is delivered as it was stored. A ci8 file can feed an SC16_Q11 stream,
+    // the other way round is refused so the module falls back to SC16_Q11 on its own.
+    int ReplayBladeRFDevice::checkFormat(bladerf_channel_layout layout, bladerf_format format) {
+        unsigned int channels = (layout == BLADERF_RX_X2) ? 2 : 1;
+        if (channels != fileChannels) {
+            spdlog::error("Recording has {0} channel(s), the stream wants {1}", fileChannels, channels);
+            return BLADERF_ERR_UNSUPPORTED;
+        }
+        bool sc8 = (format == BLADERF_FORMAT_SC8_Q7 || format == BLADERF_FORMAT_SC8_Q7_META);
+        if (sc8 && !fileSc8) { return BLADERF_ERR_UNSUPPORTED; }
+        expand = (fileSc8 && !sc8);
+        return 0;
+    }
+
+    int ReplayBladeRFDevice::syncConfig(bladerf_channel_layout layout, bladerf_format format, unsigned int numBuffers,
+                                        unsigned int bufferSize, unsigned int numTransfers, unsigned int timeout) {
+        if (!isOpen || bufferSize % 1024 != 0 || numTransfers >= numBuffers) { return BLADERF_ERR_INVAL; }
+        int status = checkFormat(layout, format);
+        if (status != 0) { return status; }
+        hostBufferFrames = numBuffers * bufferSize / fileChannels;
+        return 0;
+    }
+
+    int ReplayBladeRFDevice::syncRx(void* samples, unsigned int numSamples, struct bladerf_metadata* meta, unsigned int timeout) {
+        if (!isOpen || hostBufferFrames == 0) { return BLADERF_ERR_INVAL; }
+        unsigned int frames = numSamples / fileChannels;
+
+        bool overrun = false;
+        int status = pace(frames, timeout, overrun);
+        if (status != 0) { return status; }
+
+        copyFrames(samples, frames);
+        if (meta != NULL) {
+            meta->timestamp = timestamp;
+            meta->actual_count = numSamples;
+            meta->status = overrun ? BLADERF_META_STATUS_OVERRUN : 0;
+        }
+        timestamp += frames;
+        return 0;
+    }
+
+    int ReplayBladeRFDevice::initStream(bladerf_stream_cb callback, void*** buffers, size_t numBuffers, bladerf_format format,
+                                        size_t samplesPerBuffer, size_t numTransfers, void* userData) {
+        if (!isOpen || samplesPerBuffer % 1024 != 0 || numTransfers >= numBuffers) { return BLADERF_ERR_INVAL; }
+        deinitStream();
+        int status = checkFormat(fileChannels == 2 ? BLADERF_RX_X2 : BLADERF_RX_X1, format);
+        if (status != 0) { return status; }
+        streamCallback = callback;
+        streamUserData = userData;
+        streamSamples = samplesPerBuffer;
+        hostBufferFrames = numBuffers * samplesPerBuffer / fileChannels;
+        // Only used for blocks that wrap around the end of the file or need expanding
+        for (size_t i = 0; i < numBuffers; i++) {
+            streamBuffers.push_back(new int16_t[samplesPerBuffer * 2]);
+        }
+        *buffers = streamBuffers.data();
+        return 0;
+    }
+
+    int ReplayBladeRFDevice::setStreamTimeout(unsigned int timeout) {
+        streamTimeout = timeout;
+        return 0;
+    }
+
+    int ReplayBladeRFDevice::runStream(bladerf_channel_layout layout) {
+        if (streamBuffers.empty()) { return BLADERF_ERR_INVAL; }
+        if ((layout == BLADERF_RX_X2 ? 2 : 1) != fileChannels) { return BLADERF_ERR_UNSUPPORTED; }
+        unsigned int frames = streamSamples / fileChannels;
+
+        size_t nextBuffer = 0;
+        while (true) {
+            bool overrun = false;
+            int status = pace(frames, streamTimeout, overrun);
+            if (status != 0) { return status; }
+
+            // Zero copy whenever the block lies in one piece in the mapping
+            void* block = (void*)mappedFrames(frames);
+            if (block == NULL) {
+                block = streamBuffers[nextBuffer];
+                nextBuffer = (nextBuffer + 1) % streamBuffers.size();
+                copyFrames(block, frames);
+            }
+
+            struct bladerf_metadata meta;
+            memset(&meta, 0, sizeof(meta));
+            meta.timestamp = timestamp;
+            meta.actual_count = streamSamples;
+            meta.status = overrun ? BLADERF_META_STATUS_OVERRUN : 0;
+            timestamp += frames;
+
+            // The returned buffer is ignored, blocks from the mapping can't be handed back for filling
+            void* ret = streamCallback(NULL, NULL, &meta, block, streamSamples, streamUserData);
+            if (ret == BLADERF_STREAM_SHUTDOWN) { break; }
+        }
+        return 0;
+    }
+
+    void ReplayBladeRFDevice::deinitStream() {
+        for (void* buf : streamBuffers) {
+            delete[] (int16_t*)buf;
+        }
+        streamBuffers.clear();
+        streamCallback = NULL;
+    }
+
+    // Pointer to the next frames in the mapping, NULL if they wrap or need expanding
+    const void* ReplayBladeRFDevice::mappedFrames(unsigned int frames) {
+        if (expand || exhausted || position + frames > totalFrames) { return NULL; }
+        const void* ptr = file.data() + position * frameBytes;
+        position += frames;
+        if (position == totalFrames) {
+            if (opts.loop) { position = 0; }
+            else { exhausted = true; }
+        }
+        return ptr;
+    }
+
+    // Copy frames out of the mapping, looping or padding the end of the recording with silence
+    void ReplayBladeRFDevice::copyFrames(void* out, unsigned int frames) {
+        size_t outFrameBytes = expand ? fileChannels * 2 * sizeof(int16_t) : frameBytes;
+        uint8_t* dst = (uint8_t*)out;
+        unsigned int done = 0;
+        while (done < frames && !exhausted) {
+            unsigned int chunk = std::min<uint64_t>(frames - done, totalFrames - position);
+            const uint8_t* src = file.data() + position * frameBytes;
+            if (expand) {
+                // Q7 -> Q11, same scaling the SC8 kernels apply
+                int16_t* dst16 = (int16_t*)dst;
+                const int8_t* src8 = (const int8_t*)src;
+                for (size_t i = 0; i < (size_t)chunk * fileChannels * 2; i++) {
+                    dst16[i] = (int16_t)src8[i] << 4;
+                }
+            }
+            else {
+                memcpy(dst, src, chunk * frameBytes);
+            }
+            dst += chunk * outFrameBytes;
+            done += chunk;
+            position += chunk;
+
+            if (position == totalFrames) {
+                if (!opts.loop) {
+                    exhausted = true;
+                    break;
+                }
+                position = 0;
+            }
+        }
+        if (done < frames) { memset(dst, 0, (frames - done) * outFrameBytes); }
+    }
+
+    // Wait until the virtual board has produced the requested frames. A consumer that falls
+    // further behind than the host buffers skips ahead in the file and sees an overrun.
+    int ReplayBladeRFDevice::pace(unsigned int frames, unsigned int timeout, bool& overrun) {
+        if (!timing) {
+            startTime = std::chrono::steady_clock::now();
+            timing = true;
+        }
+        if (!opts.paced) { return 0; }
+
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+        double produced = elapsed * sampleRate;
+        if (produced > (double)(timestamp + hostBufferFrames + frames)) {
+            uint64_t skip = (uint64_t)produced - hostBufferFrames - timestamp;
+            timestamp += skip;
+            position = opts.loop ? (position + skip) % totalFrames : std::min<uint64_t>(position + skip, totalFrames);
+            if (position == totalFrames) { exhausted = true; }
+            overrun = true;
+        }
+
+        auto ready = startTime + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>((double)(timestamp + frames) / sampleRate));
+        std::this_thread::sleep_until(ready);
+        return 0;
+    }
+}
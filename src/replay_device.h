@@ -0,0 +1,126 @@
+#pragma once
+#include <bladerf_device.h>
+#include <chrono>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Plays back a recording through the normal device path, so every streaming mode,
+// the conversion kernels and the raw recorder run exactly as they do on hardware.
+// Accepts a raw interleaved SC16_Q11 file or a SigMF recording (ci16_le or ci8, as
+// written by RawRecorder). The file is memory mapped: the async interface hands out
+// pointers straight into the mapping, the sync interface does the one copy
+// libbladeRF would do anyway. Tuning and gain calls are accepted and ignored.
+namespace replay {
+    struct Options {
+        bool paced  = true;     // Deliver at the configured sample rate, otherwise as fast as possible
+        bool loop   = true;     // Start over at the end of the file, otherwise deliver silence from then on
+    };
+
+    bool isReplaySerial(const std::string& serial);
+    std::string serialFor(const std::string& path);
+    std::string pathFor(const std::string& serial);
+
+    BladeRFDevice* create(const std::string& serial, const Options& options);
+
+    // Read only view of a whole file, pages are faulted in from the page cache on access
+    class MappedFile {
+    public:
+        ~MappedFile();
+
+        bool open(const std::string& path);
+        void close();
+
+        const uint8_t* data() { return base; }
+        size_t size() { return length; }
+
+    private:
+        const uint8_t* base = NULL;
+        size_t length = 0;
+#ifdef _WIN32
+        void* fileHandle = NULL;
+        void* mapHandle = NULL;
+#else
+        int fd = -1;
+#endif
+    };
+
+    class ReplayBladeRFDevice : public BladeRFDevice {
+    public:
+        ReplayBladeRFDevice(const Options& options);
+        ~ReplayBladeRFDevice();
+
+        int open(const std::string& serial);
+        void close();
+
+        int loadFpga(const char* path) { return 0; }
+        int isFpgaConfigured() { return 1; }
+        int getFpgaSize(bladerf_fpga_size* size) { *size = BLADERF_FPGA_UNKNOWN; return 0; }
+        int fpgaVersion(std::string& version) { version = "replay"; return 0; }
+        std::string boardName() { return "replay"; }
+
+        int getSampleRateRange(bladerf_channel ch, const struct bladerf_range** range);
+        int getBandwidthRange(bladerf_channel ch, const struct bladerf_range** range);
+        int setSampleRate(bladerf_channel ch, bladerf_sample_rate rate, bladerf_sample_rate* actual);
+        int setBandwidth(bladerf_channel ch, bladerf_bandwidth bandwidth, bladerf_bandwidth* actual);
+        int setFrequency(bladerf_channel ch, bladerf_frequency frequency) { return 0; }
+        int getQuickTune(bladerf_channel ch, struct bladerf_quick_tune* quickTune);
+        int scheduleRetune(bladerf_channel ch, bladerf_timestamp timestamp, bladerf_frequency frequency,
+                           struct bladerf_quick_tune* quickTune) { return 0; }
+        int cancelScheduledRetunes(bladerf_channel ch) { return 0; }
+        int getRxTimestamp(bladerf_timestamp* timestamp);
+        int setGainStage(bladerf_channel ch, const char* stage, bladerf_gain gain) { return 0; }
+        int setGain(bladerf_channel ch, bladerf_gain gain) { return 0; }
+        int setGainMode(bladerf_channel ch, bladerf_gain_mode mode) { return 0; }
+        int enableModule(bladerf_channel ch, bool enable);
+        int setCorrection(bladerf_channel ch, bladerf_correction corr, bladerf_correction_value value) { return BLADERF_ERR_UNSUPPORTED; }
+
+        int expansionAttach(bladerf_xb xb) { return 0; }
+        int xb200SetPath(bladerf_channel ch, bladerf_xb200_path path) { return 0; }
+        int xb200SetFilterbank(bladerf_channel ch, bladerf_xb200_filter filter) { return 0; }
+
+        int syncConfig(bladerf_channel_layout layout, bladerf_format format, unsigned int numBuffers,
+                       unsigned int bufferSize, unsigned int numTransfers, unsigned int timeout);
+        int syncRx(void* samples, unsigned int numSamples, struct bladerf_metadata* meta, unsigned int timeout);
+
+        int initStream(bladerf_stream_cb callback, void*** buffers, size_t numBuffers, bladerf_format format,
+                       size_t samplesPerBuffer, size_t numTransfers, void* userData);
+        int setStreamTimeout(unsigned int timeout);
+        int runStream(bladerf_channel_layout layout);
+        void deinitStream();
+
+    private:
+        int checkFormat(bladerf_channel_layout layout, bladerf_format format);
+        void copyFrames(void* out, unsigned int frames);
+        const void* mappedFrames(unsigned int frames);
+        int pace(unsigned int frames, unsigned int timeout, bool& overrun);
+
+        Options opts;
+        MappedFile file;
+        bool isOpen = false;
+
+        // File layout, a frame holds one sample of every recorded channel
+        bool fileSc8 = false;
+        unsigned int fileChannels = 1;
+        size_t frameBytes = 4;
+        uint64_t totalFrames = 0;
+        uint64_t position = 0;
+        bool exhausted = false;
+        double fileSampleRate = 0;     // From the SigMF metadata, 0 when unknown
+        double fileFrequency = 0;
+
+        double sampleRate = 1000000.0;
+        bool expand = false;            // ci8 file read as SC16_Q11
+        unsigned int hostBufferFrames = 0;
+
+        bool timing = false;
+        std::chrono::steady_clock::time_point startTime;
+        uint64_t timestamp = 0;
+
+        bladerf_stream_cb streamCallback = NULL;
+        void* streamUserData = NULL;
+        std::vector<void*> streamBuffers;
+        size_t streamSamples = 0;
+        unsigned int streamTimeout = 1000;
+    };
+}
@@ -0,0 +1,117 @@
+#include <rx_metrics.h>
+#include <algorithm>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/resource.h>
+#endif
+
+void LatencyHistogram::record(uint64_t ns) {
+    int bucket = 0;
+    for (uint64_t v = ns; v > 1 && bucket < METRICS_HIST_BUCKETS - 1; v >>= 1) { bucket++; }
+    buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    _count.fetch_add(1, std::memory_order_relaxed);
+    _totalNs.fetch_add(ns, std::memory_order_relaxed);
+
+    uint64_t max = _maxNs.load(std::memory_order_relaxed);
+    while (ns > max && !_maxNs.compare_exchange_weak(max, ns, std::memory_order_relaxed));
+}
+
+void LatencyHistogram::reset() {
+    for (int i = 0; i < METRICS_HIST_BUCKETS; i++) {
+        buckets[i] = 0;
+    }
+    _count = 0;
+    _totalNs = 0;
+    _maxNs = 0;
+}
+
+double LatencyHistogram::meanNs() {
+    uint64_t n = count();
+    if (n == 0) { return 0.0; }
+    return (double)totalNs() / (double)n;
+}
+
+uint64_t LatencyHistogram::quantileNs(double q) {
+    uint64_t n = count();
+    if (n == 0) { return 0; }
+    uint64_t target = (uint64_t)(q * (double)n);
+    uint64_t seen = 0;
+    for (int i = 0; i < METRICS_HIST_BUCKETS; i++) {
+        seen += buckets[i].load(std::memory_order_relaxed);
+        if (seen > target) { return std::min<uint64_t>(2ULL << i, maxNs()); }
+    }
+    return maxNs();
+}
+
+json LatencyHistogram::toJson() {
+    json j;
+    j["count"] = count();
+    j["mean_ns"] = meanNs();
+    j["p50_ns"] = quantileNs(0.5);
+    j["p99_ns"] = quantileNs(0.99);
+    j["max_ns"] = maxNs();
+    return j;
+}
+
+void RxMetrics::reset() {
+    rxWait.reset();
+    convert.reset();
+    swapWait.reset();
+    retune.reset();
+    samples = 0;
+}
+
+double RxMetrics::convertNsPerSample() {
+    uint64_t n = samples.load(std::memory_order_relaxed);
+    if (n == 0) { return 0.0; }
+    return (double)convert.totalNs() / (double)n;
+}
+
+json RxMetrics::toJson(double samplesPerSec) {
+    json j;
+    j["samples"] = samples.load(std::memory_order_relaxed);
+    j["samples_per_sec"] = samplesPerSec;
+    j["convert_ns_per_sample"] = convertNsPerSample();
+    j["rx_wait"] = rxWait.toJson();
+    j["convert"] = convert.toJson();
+    j["swap_wait"] = swapWait.toJson();
+    j["retune"] = retune.toJson();
+    return j;
+}
+
+double RateTracker::update(uint64_t samples) {
+    auto now = std::chrono::steady_clock::now();
+    double elapsed = std::chrono::duration<double>(now - lastTime).count();
+    if (elapsed < 1.0 && samples >= lastSamples) { return rate; }
+    rate = (samples >= lastSamples) ? (double)(samples - lastSamples) / elapsed : 0.0;
+    lastSamples = samples;
+    lastTime = now;
+    return rate;
+}
+
+uint64_t processCpuNs() {
+#ifdef _WIN32
+    FILETIME created, exited, kernel, user;
+    if (!GetProcessTimes(GetCurrentProcess(), &created, &exited, &kernel, &user)) { return 0; }
+    uint64_t k = ((uint64_t)kernel.dwHighDateTime << 32) | kernel.dwLowDateTime;
+    uint64_t u = ((uint64_t)user.dwHighDateTime << 32) | user.dwLowDateTime;
+    return (k + u) * 100;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) { return 0; }
+    return ((uint64_t)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000000ULL) +
+           ((uint64_t)(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1000ULL);
+#endif
+}
+
+double CpuTracker::update() {
+    auto now = std::chrono::steady_clock::now();
+    double elapsed = std::chrono::duration<double>(now - lastTime).count();
+    if (elapsed < 1.0) { return load; }
+    uint64_t cpu = processCpuNs();
+    load = (cpu >= lastCpu) ? (double)(cpu - lastCpu) / (elapsed * 1e9) : 0.0;
+    lastCpu = cpu;
+    lastTime = now;
+    return load;
+}
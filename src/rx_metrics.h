@@ -0,0 +1,73 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <stdint.h>
+#include <config.h>
+
+#define METRICS_HIST_BUCKETS    40
+
+// Fixed size histogram of durations, bucket n holding samples in [2^n, 2^(n+1)) ns.
+// Recording is a couple of relaxed atomic adds, safe from any thread.
+class LatencyHistogram {
+public:
+    void record(uint64_t ns);
+    void reset();
+
+    uint64_t count() { return _count.load(std::memory_order_relaxed); }
+    uint64_t totalNs() { return _totalNs.load(std::memory_order_relaxed); }
+    uint64_t maxNs() { return _maxNs.load(std::memory_order_relaxed); }
+    double meanNs();
+
+    // Upper bound of the bucket containing the given quantile (0..1)
+    uint64_t quantileNs(double q);
+
+    json toJson();
+
+private:
+    std::atomic<uint64_t> buckets[METRICS_HIST_BUCKETS] = {};
+    std::atomic<uint64_t> _count = 0;
+    std::atomic<uint64_t> _totalNs = 0;
+    std::atomic<uint64_t> _maxNs = 0;
+};
+
+struct RxMetrics {
+    LatencyHistogram rxWait;        // Blocked in bladerf_sync_rx
+    LatencyHistogram convert;       // Per block sample conversion
+    LatencyHistogram swapWait;      // Blocked in stream.swap
+    LatencyHistogram retune;        // bladerf_set_frequency from tune()
+    std::atomic<uint64_t> samples = 0;
+
+    void reset();
+
+    double convertNsPerSample();
+    json toJson(double samplesPerSec);
+};
+
+// Turns the running sample counter into a rate. Each reader keeps its own.
+class RateTracker {
+public:
+    double update(uint64_t samples);
+    double rate = 0.0;
+
+private:
+    uint64_t lastSamples = 0;
+    std::chrono::steady_clock::time_point lastTime = std::chrono::steady_clock::now();
+};
+
+// CPU time used by all threads of the process so far
+uint64_t processCpuNs();
+
+// Turns processCpuNs() into a load, 1.0 being one core fully busy. Each reader keeps its own.
+class CpuTracker {
+public:
+    double update();
+    double load = 0.0;
+
+private:
+    uint64_t lastCpu = processCpuNs();
+    std::chrono::steady_clock::time_point lastTime = std::chrono::steady_clock::now();
+};
+
+inline uint64_t metricsNow() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
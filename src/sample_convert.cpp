@@ -0,0 +1,876 @@
+#include <sample_convert.h>
+#include <spdlog/spdlog.h>
+#include <string.h>
+#include <algorithm>
+#include <limits>
+#include <math.h>
+#include <stdlib.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define CONVERT_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define TARGET_SSE2
+#define TARGET_AVX2
+#define TARGET_AVX512
+#else
+#define TARGET_SSE2     __attribute__((target("sse2")))
+#define TARGET_AVX2     __attribute__((target("avx2")))
+#define TARGET_AVX512   __attribute__((target("avx512f,avx2")))
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64) || defined(__ARM_NEON)
+#define CONVERT_NEON
+#include <arm_neon.h>
+#endif
+
+#define SC16Q11_SCALE   (1.0f / 4096.0f)
+#define SC8Q7_SCALE     (1.0f / 256.0f)
+
+// Vector iterations between moving the int32 lane sums of the corrected kernels into
+// int64, keeps even a four lane total of 12 bit products below INT32_MAX
+#define CORRECTED_FLUSH_EVERY   32
+// Largest magnitude a group of CORRECTED_FLUSH_EVERY iterations may hold for its lane sums
+// to be right. Beyond it (replayed files can hold any int16) the group's stats are redone
+// by the scalar code, real boards never get there.
+#define CORRECTED_FAST_PEAK     2048
+
+namespace convert {
+    void sc16q11ToComplexScalar(const int16_t* in, dsp::complex_t* out, int count) {
+        for (int i = 0; i < count; i++) {
+            out[i].q = (float)in[i * 2] / (float)4096;
+            out[i].i = (float)in[(i * 2) + 1] / (float)4096;
+        }
+    }
+
+    void sc8q7ToComplexScalar(const int8_t* in, dsp::complex_t* out, int count) {
+        for (int i = 0; i < count; i++) {
+            out[i].q = (float)in[i * 2] / (float)256;
+            out[i].i = (float)in[(i * 2) + 1] / (float)256;
+        }
+    }
+
+    void sc16q11DeinterleaveX2Scalar(const int16_t* in, dsp::complex_t* out0, dsp::complex_t* out1, int count) {
+        for (int i = 0; i < count; i++) {
+            out0[i].q = (float)in[i * 4] / (float)4096;
+            out0[i].i = (float)in[(i * 4) + 1] / (float)4096;
+            out1[i].q = (float)in[(i * 4) + 2] / (float)4096;
+            out1[i].i = (float)in[(i * 4) + 3] / (float)4096;
+        }
+    }
+
+    void sc8q7DeinterleaveX2(const int8_t* in, dsp::complex_t* out0, dsp::complex_t* out1, int count) {
+        for (int i = 0; i < count; i++) {
+            out0[i].q = (float)in[i * 4] / (float)256;
+            out0[i].i = (float)in[(i * 4) + 1] / (float)256;
+            out1[i].q = (float)in[(i * 4) + 2] / (float)256;
+            out1[i].i = (float)in[(i * 4) + 3] / (float)256;
+        }
+    }
+
+    // The first word of each pair is .q, the second .i, as in the plain kernels
+    template <class T, int SHIFT>
+    static inline void toComplexCorrected(const T* in, dsp::complex_t* out, int count, const IqCorrection& corr, IqStats& stats) {
+        IqStats st;
+        for (int i = 0; i < count; i++) {
+            int32_t q = (int32_t)in[i * 2] << SHIFT;
+            int32_t iv = (int32_t)in[(i * 2) + 1] << SHIFT;
+            st.sumI += iv;
+            st.sumQ += q;
+            st.sumII += iv * iv;
+            st.sumQQ += q * q;
+            st.sumIQ += iv * q;
+            st.peak = std::max<int32_t>(st.peak, std::max<int32_t>(abs(iv), abs(q)));
+            float ci = ((float)iv * SC16Q11_SCALE) - corr.dcI;
+            float cq = ((float)q * SC16Q11_SCALE) - corr.dcQ;
+            out[i].i = ci;
+            out[i].q = (corr.gain * cq) + (corr.phase * ci);
+        }
+        st.count = count;
+        stats.add(st);
+    }
+
+    void sc16q11ToComplexCorrectedScalar(const int16_t* in, dsp::complex_t* out, int count, const IqCorrection& corr, IqStats& stats) {
+        toComplexCorrected<int16_t, 0>(in, out, count, corr, stats);
+    }
+
+    // The 8 bit path only carries the lower rates, it stays scalar
+    void sc8q7ToComplexCorrected(const int8_t* in, dsp::complex_t* out, int count, const IqCorrection& corr, IqStats& stats) {
+        toComplexCorrected<int8_t, 4>(in, out, count, corr, stats);
+    }
+
+    void correctComplex(dsp::complex_t* data, int count, const IqCorrection& corr) {
+        for (int i = 0; i < count; i++) {
+            float ci = data[i].i - corr.dcI;
+            float cq = data[i].q - corr.dcQ;
+            data[i].i = ci;
+            data[i].q = (corr.gain * cq) + (corr.phase * ci);
+        }
+    }
+
+    void firInt16x2Scalar(const int16_t* taps, const int16_t* x0, const int16_t* x1, int count, int32_t* acc0, int32_t* acc1) {
+        int32_t a0 = 0;
+        int32_t a1 = 0;
+        for (int i = 0; i < count; i++) {
+            a0 += (int32_t)taps[i] * (int32_t)x0[i];
+            a1 += (int32_t)taps[i] * (int32_t)x1[i];
+        }
+        *acc0 = a0;
+        *acc1 = a1;
+    }
+
+#ifdef CONVERT_X86
+    // In each 32 bit lane the low word goes to .q and the high word to .i,
+    // so the pair is swapped before widening to match complex_t {i, q}
+    TARGET_SSE2 static void sc16q11ToComplexSSE2(const int16_t* in, dsp::complex_t* out, int count) {
+        const __m128 scale = _mm_set1_ps(SC16Q11_SCALE);
+        float* o = (float*)out;
+        int i = 0;
+        for (; i + 4 <= count; i += 4) {
+            __m128i v = _mm_loadu_si128((const __m128i*)&in[i * 2]);
+            __m128i first = _mm_srai_epi32(_mm_slli_epi32(v, 16), 16);
+            __m128i second = _mm_srai_epi32(v, 16);
+            __m128i lo = _mm_unpacklo_epi32(second, first);
+            __m128i hi = _mm_unpackhi_epi32(second, first);
+            _mm_storeu_ps(&o[i * 2], _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+            _mm_storeu_ps(&o[(i * 2) + 4], _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+        }
+        sc16q11ToComplexScalar(&in[i * 2], &out[i], count - i);
+    }
+
+    TARGET_AVX2 static void sc16q11ToComplexAVX2(const int16_t* in, dsp::complex_t* out, int count) {
+        const __m256 scale = _mm256_set1_ps(SC16Q11_SCALE);
+        const __m128i swap = _mm_setr_epi8(2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13);
+        float* o = (float*)out;
+        int i = 0;
+        for (; i + 8 <= count; i += 8) {
+            __m128i v0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)&in[i * 2]), swap);
+            __m128i v1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)&in[(i * 2) + 8]), swap);
+            __m256 f0 = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(v0));
+            __m256 f1 = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(v1));
+            _mm256_storeu_ps(&o[i * 2], _mm256_mul_ps(f0, scale));
+            _mm256_storeu_ps(&o[(i * 2) + 8], _mm256_mul_ps(f1, scale));
+        }
+        sc16q11ToComplexScalar(&in[i * 2], &out[i], count - i);
+    }
+
+    TARGET_AVX512 static void sc16q11ToComplexAVX512(const int16_t* in, dsp::complex_t* out, int count) {
+        const __m512 scale = _mm512_set1_ps(SC16Q11_SCALE);
+        const __m256i swap = _mm256_setr_epi8(2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13,
+                                              2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13);
+        float* o = (float*)out;
+        int i = 0;
+        for (; i + 16 <= count; i += 16) {
+            __m256i v0 = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)&in[i * 2]), swap);
+            __m256i v1 = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)&in[(i * 2) + 16]), swap);
+            __m512 f0 = _mm512_cvtepi32_ps(_mm512_cvtepi16_epi32(v0));
+            __m512 f1 = _mm512_cvtepi32_ps(_mm512_cvtepi16_epi32(v1));
+            _mm512_storeu_ps(&o[i * 2], _mm512_mul_ps(f0, scale));
+            _mm512_storeu_ps(&o[(i * 2) + 16], _mm512_mul_ps(f1, scale));
+        }
+        sc16q11ToComplexAVX2(&in[i * 2], &out[i], count - i);
+    }
+
+    // Four SC16 pairs (one per 32 bit lane) to eight floats
+    TARGET_SSE2 static inline void sse2StorePairs(__m128i v, float* o, __m128 scale) {
+        __m128i first = _mm_srai_epi32(_mm_slli_epi32(v, 16), 16);
+        __m128i second = _mm_srai_epi32(v, 16);
+        _mm_storeu_ps(o, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi32(second, first)), scale));
+        _mm_storeu_ps(&o[4], _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi32(second, first)), scale));
+    }
+
+    TARGET_SSE2 static void sc16q11DeinterleaveX2SSE2(const int16_t* in, dsp::complex_t* out0, dsp::complex_t* out1, int count) {
+        const __m128 scale = _mm_set1_ps(SC16Q11_SCALE);
+        float* o0 = (float*)out0;
+        float* o1 = (float*)out1;
+        int i = 0;
+        for (; i + 4 <= count; i += 4) {
+            // Lanes alternate channels, gather each channel into one 64 bit half then split
+            __m128i v0 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&in[i * 4]), _MM_SHUFFLE(3, 1, 2, 0));
+            __m128i v1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&in[(i * 4) + 8]), _MM_SHUFFLE(3, 1, 2, 0));
+            sse2StorePairs(_mm_unpacklo_epi64(v0, v1), &o0[i * 2], scale);
+            sse2StorePairs(_mm_unpackhi_epi64(v0, v1), &o1[i * 2], scale);
+        }
+        sc16q11DeinterleaveX2Scalar(&in[i * 4], &out0[i], &out1[i], count - i);
+    }
+
+    TARGET_AVX2 static void sc16q11DeinterleaveX2AVX2(const int16_t* in, dsp::complex_t* out0, dsp::complex_t* out1, int count) {
+        const __m256 scale = _mm256_set1_ps(SC16Q11_SCALE);
+        const __m256i gather = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+        const __m256i swap = _mm256_setr_epi8(2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13,
+                                              2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13);
+        float* o0 = (float*)out0;
+        float* o1 = (float*)out1;
+        int i = 0;
+        for (; i + 8 <= count; i += 8) {
+            // Each load becomes [4 x ch0 | 4 x ch1], then the halves of both loads are regrouped per channel
+            __m256i v0 = _mm256_permutevar8x32_epi32(_mm256_loadu_si256((const __m256i*)&in[i * 4]), gather);
+            __m256i v1 = _mm256_permutevar8x32_epi32(_mm256_loadu_si256((const __m256i*)&in[(i * 4) + 16]), gather);
+            __m256i c0 = _mm256_shuffle_epi8(_mm256_permute2x128_si256(v0, v1, 0x20), swap);
+            __m256i c1 = _mm256_shuffle_epi8(_mm256_permute2x128_si256(v0, v1, 0x31), swap);
+            _mm256_storeu_ps(&o0[i * 2], _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm256_castsi256_si128(c0))), scale));
+            _mm256_storeu_ps(&o0[(i * 2) + 8], _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm256_extracti128_si256(c0, 1))), scale));
+            _mm256_storeu_ps(&o1[i * 2], _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm256_castsi256_si128(c1))), scale));
+            _mm256_storeu_ps(&o1[(i * 2) + 8], _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm256_extracti128_si256(c1, 1))), scale));
+        }
+        sc16q11DeinterleaveX2Scalar(&in[i * 4], &out0[i], &out1[i], count - i);
+    }
+
+    TARGET_SSE2 static void sc8q7ToComplexSSE2(const int8_t* in, dsp::complex_t* out, int count) {
+        const __m128 scale = _mm_set1_ps(SC8Q7_SCALE);
+        float* o = (float*)out;
+        int i = 0;
+        for (; i + 4 <= count; i += 4) {
+            // Put each byte in the top of a 16 bit lane, then proceed as for SC16 with an extra shift
+            __m128i b = _mm_loadl_epi64((const __m128i*)&in[i * 2]);
+            __m128i v = _mm_unpacklo_epi8(_mm_setzero_si128(), b);
+            __m128i first = _mm_srai_epi32(_mm_slli_epi32(v, 16), 24);
+            __m128i second = _mm_srai_epi32(v, 24);
+            __m128i lo = _mm_unpacklo_epi32(second, first);
+            __m128i hi = _mm_unpackhi_epi32(second, first);
+            _mm_storeu_ps(&o[i * 2], _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+            _mm_storeu_ps(&o[(i * 2) + 4], _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+        }
+        sc8q7ToComplexScalar(&in[i * 2], &out[i], count - i);
+    }
+
+    TARGET_AVX2 static void sc8q7ToComplexAVX2(const int8_t* in, dsp::complex_t* out, int count) {
+        const __m256 scale = _mm256_set1_ps(SC8Q7_SCALE);
+        const __m128i swap = _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+        float* o = (float*)out;
+        int i = 0;
+        for (; i + 8 <= count; i += 8) {
+            __m128i v = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)&in[i * 2]), swap);
+            __m256 f0 = _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(v));
+            __m256 f1 = _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(_mm_srli_si128(v, 8)));
+            _mm256_storeu_ps(&o[i * 2], _mm256_mul_ps(f0, scale));
+            _mm256_storeu_ps(&o[(i * 2) + 8], _mm256_mul_ps(f1, scale));
+        }
+        sc8q7ToComplexScalar(&in[i * 2], &out[i], count - i);
+    }
+
+    TARGET_AVX512 static void sc8q7ToComplexAVX512(const int8_t* in, dsp::complex_t* out, int count) {
+        const __m512 scale = _mm512_set1_ps(SC8Q7_SCALE);
+        const __m128i swap = _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+        float* o = (float*)out;
+        int i = 0;
+        for (; i + 16 <= count; i += 16) {
+            __m128i v0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)&in[i * 2]), swap);
+            __m128i v1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)&in[(i * 2) + 16]), swap);
+            __m512 f0 = _mm512_cvtepi32_ps(_mm512_cvtepi8_epi32(v0));
+            __m512 f1 = _mm512_cvtepi32_ps(_mm512_cvtepi8_epi32(v1));
+            _mm512_storeu_ps(&o[i * 2], _mm512_mul_ps(f0, scale));
+            _mm512_storeu_ps(&o[(i * 2) + 16], _mm512_mul_ps(f1, scale));
+        }
+        sc8q7ToComplexAVX2(&in[i * 2], &out[i], count - i);
+    }
+
+    TARGET_SSE2 static inline int32_t sse2HorizontalSum(__m128i v) {
+        v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+        v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+        return _mm_cvtsi128_si32(v);
+    }
+
+    TARGET_SSE2 static inline int32_t sse2HorizontalMax16(__m128i v) {
+        v = _mm_max_epi16(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+        v = _mm_max_epi16(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+        v = _mm_max_epi16(v, _mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1)));
+        return (int16_t)_mm_extract_epi16(v, 0);
+    }
+
+    // pmaddwd multiplies eight int16 pairs and adds adjacent products into four int32 lanes
+    TARGET_SSE2 static void firInt16x2SSE2(const int16_t* taps, const int16_t* x0, const int16_t* x1, int count, int32_t* acc0, int32_t* acc1) {
+        __m128i s0 = _mm_setzero_si128();
+        __m128i s1 = _mm_setzero_si128();
+        int i = 0;
+        for (; i + 8 <= count; i += 8) {
+            __m128i t = _mm_loadu_si128((const __m128i*)&taps[i]);
+            s0 = _mm_add_epi32(s0, _mm_madd_epi16(t, _mm_loadu_si128((const __m128i*)&x0[i])));
+            s1 = _mm_add_epi32(s1, _mm_madd_epi16(t, _mm_loadu_si128((const __m128i*)&x1[i])));
+        }
+        int32_t t0, t1;
+        firInt16x2Scalar(&taps[i], &x0[i], &x1[i], count - i, &t0, &t1);
+        *acc0 = sse2HorizontalSum(s0) + t0;
+        *acc1 = sse2HorizontalSum(s1) + t1;
+    }
+
+    TARGET_AVX2 static void firInt16x2AVX2(const int16_t* taps, const int16_t* x0, const int16_t* x1, int count, int32_t* acc0, int32_t* acc1) {
+        __m256i s0 = _mm256_setzero_si256();
+        __m256i s1 = _mm256_setzero_si256();
+        int i = 0;
+        for (; i + 16 <= count; i += 16) {
+            __m256i t = _mm256_loadu_si256((const __m256i*)&taps[i]);
+            s0 = _mm256_add_epi32(s0, _mm256_madd_epi16(t, _mm256_loadu_si256((const __m256i*)&x0[i])));
+            s1 = _mm256_add_epi32(s1, _mm256_madd_epi16(t, _mm256_loadu_si256((const __m256i*)&x1[i])));
+        }
+        int32_t t0, t1;
+        firInt16x2SSE2(&taps[i], &x0[i], &x1[i], count - i, &t0, &t1);
+        __m128i h0 = _mm_add_epi32(_mm256_castsi256_si128(s0), _mm256_extracti128_si256(s0, 1));
+        __m128i h1 = _mm_add_epi32(_mm256_castsi256_si128(s1), _mm256_extracti128_si256(s1, 1));
+        *acc0 = sse2HorizontalSum(h0) + t0;
+        *acc1 = sse2HorizontalSum(h1) + t1;
+    }
+
+    TARGET_SSE2 static void sc16q11ToComplexCorrectedSSE2(const int16_t* in, dsp::complex_t* out, int count, const IqCorrection& corr, IqStats& stats) {
+        const __m128 scale = _mm_set1_ps(SC16Q11_SCALE);
+        const __m128 dcI = _mm_set1_ps(corr.dcI);
+        const __m128 dcQ = _mm_set1_ps(corr.dcQ);
+        const __m128 gain = _mm_set1_ps(corr.gain);
+        const __m128 phase = _mm_set1_ps(corr.phase);
+        const __m128i maskFirst = _mm_set1_epi32(0x0000FFFF);
+        const __m128i maskSecond = _mm_set1_epi32((int)0xFFFF0000);
+        float* o = (float*)out;
+        IqStats st;
+        int i = 0;
+        while (i + 4 <= count) {
+            int start = i;
+            // Saturating negation, so -32768 shows as out of range instead of wrapping
+            __m128i peak = _mm_setzero_si128();
+            __m128i sI = _mm_setzero_si128(), sQ = _mm_setzero_si128();
+            __m128i sII = _mm_setzero_si128(), sQQ = _mm_setzero_si128(), sIQ = _mm_setzero_si128();
+            for (int n = 0; n < CORRECTED_FLUSH_EVERY && i + 4 <= count; n++, i += 4) {
+                __m128i v = _mm_loadu_si128((const __m128i*)&in[i * 2]);
+                __m128i first = _mm_srai_epi32(_mm_slli_epi32(v, 16), 16);
+                __m128i second = _mm_srai_epi32(v, 16);
+
+                // pmaddwd against a masked copy keeps only the wanted product of each pair
+                __m128i swapped = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1)), _MM_SHUFFLE(2, 3, 0, 1));
+                sI = _mm_add_epi32(sI, second);
+                sQ = _mm_add_epi32(sQ, first);
+                sII = _mm_add_epi32(sII, _mm_madd_epi16(v, _mm_and_si128(v, maskSecond)));
+                sQQ = _mm_add_epi32(sQQ, _mm_madd_epi16(v, _mm_and_si128(v, maskFirst)));
+                sIQ = _mm_add_epi32(sIQ, _mm_madd_epi16(v, _mm_and_si128(swapped, maskFirst)));
+                peak = _mm_max_epi16(peak, _mm_max_epi16(v, _mm_subs_epi16(_mm_setzero_si128(), v)));
+
+                __m128 ci = _mm_sub_ps(_mm_mul_ps(_mm_cvtepi32_ps(second), scale), dcI);
+                __m128 cq = _mm_sub_ps(_mm_mul_ps(_mm_cvtepi32_ps(first), scale), dcQ);
+                cq = _mm_add_ps(_mm_mul_ps(gain, cq), _mm_mul_ps(phase, ci));
+                _mm_storeu_ps(&o[i * 2], _mm_unpacklo_ps(ci, cq));
+                _mm_storeu_ps(&o[(i * 2) + 4], _mm_unpackhi_ps(ci, cq));
+            }
+            int32_t groupPeak = sse2HorizontalMax16(peak);
+            if (groupPeak > CORRECTED_FAST_PEAK) {
+                sc16q11ToComplexCorrectedScalar(&in[start * 2], &out[start], i - start, corr, st);
+                continue;
+            }
+            st.sumI += sse2HorizontalSum(sI);
+            st.sumQ += sse2HorizontalSum(sQ);
+            st.sumII += (uint32_t)sse2HorizontalSum(sII);
+            st.sumQQ += (uint32_t)sse2HorizontalSum(sQQ);
+            st.sumIQ += sse2HorizontalSum(sIQ);
+            st.peak = std::max<int32_t>(st.peak, groupPeak);
+            st.count += i - start;
+        }
+        stats.add(st);
+        sc16q11ToComplexCorrectedScalar(&in[i * 2], &out[i], count - i, corr, stats);
+    }
+
+    TARGET_AVX2 static void sc16q11ToComplexCorrectedAVX2(const int16_t* in, dsp::complex_t* out, int count, const IqCorrection& corr, IqStats& stats) {
+        const __m256 scale = _mm256_set1_ps(SC16Q11_SCALE);
+        const __m256 dcI = _mm256_set1_ps(corr.dcI);
+        const __m256 dcQ = _mm256_set1_ps(corr.dcQ);
+        const __m256 gain = _mm256_set1_ps(corr.gain);
+        const __m256 phase = _mm256_set1_ps(corr.phase);
+        const __m256i maskFirst = _mm256_set1_epi32(0x0000FFFF);
+        const __m256i maskSecond = _mm256_set1_epi32((int)0xFFFF0000);
+        float* o = (float*)out;
+        IqStats st;
+        int i = 0;
+        while (i + 8 <= count) {
+            int start = i;
+            // Not abs, which leaves -32768 negative
+            __m256i peak = _mm256_setzero_si256();
+            __m256i sI = _mm256_setzero_si256(), sQ = _mm256_setzero_si256();
+            __m256i sII = _mm256_setzero_si256(), sQQ = _mm256_setzero_si256(), sIQ = _mm256_setzero_si256();
+            for (int n = 0; n < CORRECTED_FLUSH_EVERY && i + 8 <= count; n++, i += 8) {
+                __m256i v = _mm256_loadu_si256((const __m256i*)&in[i * 2]);
+                __m256i first = _mm256_srai_epi32(_mm256_slli_epi32(v, 16), 16);
+                __m256i second = _mm256_srai_epi32(v, 16);
+
+                __m256i swapped = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1)), _MM_SHUFFLE(2, 3, 0, 1));
+                sI = _mm256_add_epi32(sI, second);
+                sQ = _mm256_add_epi32(sQ, first);
+                sII = _mm256_add_epi32(sII, _mm256_madd_epi16(v, _mm256_and_si256(v, maskSecond)));
+                sQQ = _mm256_add_epi32(sQQ, _mm256_madd_epi16(v, _mm256_and_si256(v, maskFirst)));
+                sIQ = _mm256_add_epi32(sIQ, _mm256_madd_epi16(v, _mm256_and_si256(swapped, maskFirst)));
+                peak = _mm256_max_epi16(peak, _mm256_max_epi16(v, _mm256_subs_epi16(_mm256_setzero_si256(), v)));
+
+                __m256 ci = _mm256_sub_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(second), scale), dcI);
+                __m256 cq = _mm256_sub_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(first), scale), dcQ);
+                cq = _mm256_add_ps(_mm256_mul_ps(gain, cq), _mm256_mul_ps(phase, ci));
+                // unpack works within 128 bit halves, the permutes put the samples back in order
+                __m256 lo = _mm256_unpacklo_ps(ci, cq);
+                __m256 hi = _mm256_unpackhi_ps(ci, cq);
+                _mm256_storeu_ps(&o[i * 2], _mm256_permute2f128_ps(lo, hi, 0x20));
+                _mm256_storeu_ps(&o[(i * 2) + 8], _mm256_permute2f128_ps(lo, hi, 0x31));
+            }
+            int32_t groupPeak = sse2HorizontalMax16(_mm_max_epi16(_mm256_castsi256_si128(peak), _mm256_extracti128_si256(peak, 1)));
+            if (groupPeak > CORRECTED_FAST_PEAK) {
+                sc16q11ToComplexCorrectedScalar(&in[start * 2], &out[start], i - start, corr, st);
+                continue;
+            }
+            // Lane sums of squares may exceed INT32_MAX once halves are combined, so widen first
+            st.sumI += sse2HorizontalSum(_mm_add_epi32(_mm256_castsi256_si128(sI), _mm256_extracti128_si256(sI, 1)));
+            st.sumQ += sse2HorizontalSum(_mm_add_epi32(_mm256_castsi256_si128(sQ), _mm256_extracti128_si256(sQ, 1)));
+            st.sumII += (uint32_t)sse2HorizontalSum(_mm256_castsi256_si128(sII)) + (int64_t)(uint32_t)sse2HorizontalSum(_mm256_extracti128_si256(sII, 1));
+            st.sumQQ += (uint32_t)sse2HorizontalSum(_mm256_castsi256_si128(sQQ)) + (int64_t)(uint32_t)sse2HorizontalSum(_mm256_extracti128_si256(sQQ, 1));
+            st.sumIQ += (int64_t)sse2HorizontalSum(_mm256_castsi256_si128(sIQ)) + (int64_t)sse2HorizontalSum(_mm256_extracti128_si256(sIQ, 1));
+            st.peak = std::max<int32_t>(st.peak, groupPeak);
+            st.count += i - start;
+        }
+        stats.add(st);
+        sc16q11ToComplexCorrectedScalar(&in[i * 2], &out[i], count - i, corr, stats);
+    }
+
+    static bool cpuHasSSE2() {
+#if defined(__x86_64__) || defined(_M_X64)
+        return true;
+#elif defined(_MSC_VER)
+        int regs[4];
+        __cpuid(regs, 1);
+        return (regs[3] >> 26) & 1;
+#else
+        return __builtin_cpu_supports("sse2");
+#endif
+    }
+
+#ifdef _MSC_VER
+    // AVX state must be enabled by the OS as well as reported by the CPU
+    static bool osSavesState(unsigned long long mask) {
+        int regs[4];
+        __cpuid(regs, 1);
+        if (!((regs[2] >> 27) & 1)) { return false; }
+        return (_xgetbv(0) & mask) == mask;
+    }
+#endif
+
+    static bool cpuHasAVX2() {
+#ifdef _MSC_VER
+        int regs[4];
+        __cpuidex(regs, 7, 0);
+        return ((regs[1] >> 5) & 1) && osSavesState(0x6);
+#else
+        return __builtin_cpu_supports("avx2");
+#endif
+    }
+
+    static bool cpuHasAVX512() {
+#ifdef _MSC_VER
+        int regs[4];
+        __cpuidex(regs, 7, 0);
+        return ((regs[1] >> 16) & 1) && cpuHasAVX2() && osSavesState(0xE6);
+#else
+        return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx2");
+#endif
+    }
+#endif
+
+#ifdef CONVERT_NEON
+    static void sc16q11ToComplexNEON(const int16_t* in, dsp::complex_t* out, int count) {
+        const float32x4_t scale = vdupq_n_f32(SC16Q11_SCALE);
+        float* o = (float*)out;
+        int i = 0;
+        for (; i + 8 <= count; i += 8) {
+            // val[0] holds the first word of each pair (.q), val[1] the second (.i)
+            int16x8x2_t v = vld2q_s16(&in[i * 2]);
+            float32x4x2_t lo, hi;
+            lo.val[0] = vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v.val[1]))), scale);
+            lo.val[1] = vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v.val[0]))), scale);
+            hi.val[0] = vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v.val[1]))), scale);
+            hi.val[1] = vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v.val[0]))), scale);
+            vst2q_f32(&o[i * 2], lo);
+            vst2q_f32(&o[(i * 2) + 8], hi);
+        }
+        sc16q11ToComplexScalar(&in[i * 2], &out[i], count - i);
+    }
+
+    static void sc8q7ToComplexNEON(const int8_t* in, dsp::complex_t* out, int count) {
+        const float32x4_t scale = vdupq_n_f32(SC8Q7_SCALE);
+        float* o = (float*)out;
+        int i = 0;
+        for (; i + 8 <= count; i += 8) {
+            int8x8x2_t v = vld2_s8(&in[i * 2]);
+            int16x8_t first = vmovl_s8(v.val[0]);
+            int16x8_t second = vmovl_s8(v.val[1]);
+            float32x4x2_t lo, hi;
+            lo.val[0] = vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(second))), scale);
+            lo.val[1] = vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(first))), scale);
+            hi.val[0] = vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(second))), scale);
+            hi.val[1] = vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(first))), scale);
+            vst2q_f32(&o[i * 2], lo);
+            vst2q_f32(&o[(i * 2) + 8], hi);
+        }
+        sc8q7ToComplexScalar(&in[i * 2], &out[i], count - i);
+    }
+#endif
+
+#ifdef CONVERT_NEON
+    static inline int32_t neonHorizontalSum(int32x4_t v) {
+#ifdef __aarch64__
+        return vaddvq_s32(v);
+#else
+        int32x2_t h = vadd_s32(vget_low_s32(v), vget_high_s32(v));
+        return vget_lane_s32(vpadd_s32(h, h), 0);
+#endif
+    }
+
+    static void firInt16x2NEON(const int16_t* taps, const int16_t* x0, const int16_t* x1, int count, int32_t* acc0, int32_t* acc1) {
+        int32x4_t s0 = vdupq_n_s32(0);
+        int32x4_t s1 = vdupq_n_s32(0);
+        int i = 0;
+        for (; i + 8 <= count; i += 8) {
+            int16x8_t t = vld1q_s16(&taps[i]);
+            int16x8_t v0 = vld1q_s16(&x0[i]);
+            int16x8_t v1 = vld1q_s16(&x1[i]);
+            s0 = vmlal_s16(s0, vget_low_s16(t), vget_low_s16(v0));
+            s0 = vmlal_s16(s0, vget_high_s16(t), vget_high_s16(v0));
+            s1 = vmlal_s16(s1, vget_low_s16(t), vget_low_s16(v1));
+            s1 = vmlal_s16(s1, vget_high_s16(t), vget_high_s16(v1));
+        }
+        int32_t t0, t1;
+        firInt16x2Scalar(&taps[i], &x0[i], &x1[i], count - i, &t0, &t1);
+        *acc0 = neonHorizontalSum(s0) + t0;
+        *acc1 = neonHorizontalSum(s1) + t1;
+    }
+
+    static inline int32_t neonHorizontalMax16(int16x8_t v) {
+#ifdef __aarch64__
+        return vmaxvq_s16(v);
+#else
+        int16x4_t h = vmax_s16(vget_low_s16(v), vget_high_s16(v));
+        h = vpmax_s16(h, h);
+        h = vpmax_s16(h, h);
+        return vget_lane_s16(h, 0);
+#endif
+    }
+
+    static void sc16q11ToComplexCorrectedNEON(const int16_t* in, dsp::complex_t* out, int count, const IqCorrection& corr, IqStats& stats) {
+        const float32x4_t scale = vdupq_n_f32(SC16Q11_SCALE);
+        const float32x4_t dcI = vdupq_n_f32(corr.dcI);
+        const float32x4_t dcQ = vdupq_n_f32(corr.dcQ);
+        const float32x4_t gain = vdupq_n_f32(corr.gain);
+        const float32x4_t phase = vdupq_n_f32(corr.phase);
+        float* o = (float*)out;
+        IqStats st;
+        int i = 0;
+        while (i + 8 <= count) {
+            int start = i;
+            // Saturating abs, so -32768 shows as out of range instead of wrapping
+            int16x8_t peak = vdupq_n_s16(0);
+            int32x4_t sI = vdupq_n_s32(0), sQ = vdupq_n_s32(0);
+            int32x4_t sII = vdupq_n_s32(0), sQQ = vdupq_n_s32(0), sIQ = vdupq_n_s32(0);
+            for (int n = 0; n < CORRECTED_FLUSH_EVERY && i + 8 <= count; n++, i += 8) {
+                // val[0] holds the first word of each pair (.q), val[1] the second (.i)
+                int16x8x2_t v = vld2q_s16(&in[i * 2]);
+                sI = vpadalq_s16(sI, v.val[1]);
+                sQ = vpadalq_s16(sQ, v.val[0]);
+                sII = vmlal_s16(vmlal_s16(sII, vget_low_s16(v.val[1]), vget_low_s16(v.val[1])), vget_high_s16(v.val[1]), vget_high_s16(v.val[1]));
+                sQQ = vmlal_s16(vmlal_s16(sQQ, vget_low_s16(v.val[0]), vget_low_s16(v.val[0])), vget_high_s16(v.val[0]), vget_high_s16(v.val[0]));
+                sIQ = vmlal_s16(vmlal_s16(sIQ, vget_low_s16(v.val[1]), vget_low_s16(v.val[0])), vget_high_s16(v.val[1]), vget_high_s16(v.val[0]));
+                peak = vmaxq_s16(peak, vmaxq_s16(vqabsq_s16(v.val[0]), vqabsq_s16(v.val[1])));
+
+                float32x4x2_t lo, hi;
+                lo.val[0] = vsubq_f32(vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v.val[1]))), scale), dcI);
+                hi.val[0] = vsubq_f32(vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v.val[1]))), scale), dcI);
+                lo.val[1] = vsubq_f32(vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v.val[0]))), scale), dcQ);
+                hi.val[1] = vsubq_f32(vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v.val[0]))), scale), dcQ);
+                lo.val[1] = vaddq_f32(vmulq_f32(gain, lo.val[1]), vmulq_f32(phase, lo.val[0]));
+                hi.val[1] = vaddq_f32(vmulq_f32(gain, hi.val[1]), vmulq_f32(phase, hi.val[0]));
+                vst2q_f32(&o[i * 2], lo);
+                vst2q_f32(&o[(i * 2) + 8], hi);
+            }
+            int32_t groupPeak = neonHorizontalMax16(peak);
+            if (groupPeak > CORRECTED_FAST_PEAK) {
+                sc16q11ToComplexCorrectedScalar(&in[start * 2], &out[start], i - start, corr, st);
+                continue;
+            }
+            st.sumI += neonHorizontalSum(sI);
+            st.sumQ += neonHorizontalSum(sQ);
+            st.sumII += (uint32_t)neonHorizontalSum(sII);
+            st.sumQQ += (uint32_t)neonHorizontalSum(sQQ);
+            st.sumIQ += neonHorizontalSum(sIQ);
+            st.peak = std::max<int32_t>(st.peak, groupPeak);
+            st.count += i - start;
+        }
+        stats.add(st);
+        sc16q11ToComplexCorrectedScalar(&in[i * 2], &out[i], count - i, corr, stats);
+    }
+
+    static void sc16q11DeinterleaveX2NEON(const int16_t* in, dsp::complex_t* out0, dsp::complex_t* out1, int count) {
+        const float32x4_t scale = vdupq_n_f32(SC16Q11_SCALE);
+        float* o0 = (float*)out0;
+        float* o1 = (float*)out1;
+        int i = 0;
+        for (; i + 8 <= count; i += 8) {
+            // val[0]/val[1] are the two words of channel 0, val[2]/val[3] those of channel 1
+            int16x8x4_t v = vld4q_s16(&in[i * 4]);
+            float32x4x2_t lo0, hi0, lo1, hi1;
+            lo0.val[0] = vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v.val[1]))), scale);
+            lo0.val[1] = vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v.val[0]))), scale);
+            hi0.val[0] = vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v.val[1]))), scale);
+            hi0.val[1] = vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v.val[0]))), scale);
+            lo1.val[0] = vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v.val[3]))), scale);
+            lo1.val[1] = vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v.val[2]))), scale);
+            hi1.val[0] = vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v.val[3]))), scale);
+            hi1.val[1] = vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v.val[2]))), scale);
+            vst2q_f32(&o0[i * 2], lo0);
+            vst2q_f32(&o0[(i * 2) + 8], hi0);
+            vst2q_f32(&o1[i * 2], lo1);
+            vst2q_f32(&o1[(i * 2) + 8], hi1);
+        }
+        sc16q11DeinterleaveX2Scalar(&in[i * 4], &out0[i], &out1[i], count - i);
+    }
+#endif
+
+    // Run a candidate against the reference on every edge of the input range,
+    // with an odd length so the scalar tail is exercised as well
+    template <class T>
+    static bool matchesReference(void (*kernel)(const T*, dsp::complex_t*, int), void (*reference)(const T*, dsp::complex_t*, int)) {
+        const int count = 67;
+        T in[count * 2];
+        dsp::complex_t ref[count];
+        dsp::complex_t out[count];
+        for (int i = 0; i < count * 2; i++) {
+            in[i] = (T)((i * 7919) ^ (i << 9));
+        }
+        in[0] = std::numeric_limits<T>::min(); in[1] = std::numeric_limits<T>::max(); in[2] = -1; in[3] = 1;
+        reference(in, ref, count);
+        kernel(in, out, count);
+        return memcmp(ref, out, sizeof(ref)) == 0;
+    }
+
+    template <class T>
+    static bool matchesReference(void (*kernel)(const T*, dsp::complex_t*, dsp::complex_t*, int),
+                                 void (*reference)(const T*, dsp::complex_t*, dsp::complex_t*, int)) {
+        const int count = 67;
+        T in[count * 4];
+        dsp::complex_t ref[count * 2];
+        dsp::complex_t out[count * 2];
+        for (int i = 0; i < count * 4; i++) {
+            in[i] = (T)((i * 7919) ^ (i << 9));
+        }
+        in[0] = std::numeric_limits<T>::min(); in[1] = std::numeric_limits<T>::max(); in[2] = -1; in[3] = 1;
+        reference(in, ref, &ref[count], count);
+        kernel(in, out, &out[count], count);
+        return memcmp(ref, out, sizeof(ref)) == 0;
+    }
+
+    static bool matchesReference(firInt16x2Kernel_t kernel, firInt16x2Kernel_t reference) {
+        const int count = 67;
+        int16_t taps[count];
+        int16_t x0[count];
+        int16_t x1[count];
+        for (int i = 0; i < count; i++) {
+            taps[i] = (int16_t)(((i * 7919) ^ (i << 9)) & 0x3FFF) - 0x2000;
+            x0[i] = (int16_t)(((i * 104729) & 0xFFF) - 2048);
+            x1[i] = (int16_t)(2047 - ((i * 7919) & 0xFFF));
+        }
+        int32_t ref0, ref1, out0, out1;
+        reference(taps, x0, x1, count, &ref0, &ref1);
+        kernel(taps, x0, x1, count, &out0, &out1);
+        return ref0 == out0 && ref1 == out1;
+    }
+
+    // Float results may differ in the last bit depending on instruction selection, the stats must be exact
+    static bool matchesReference(sc16CorrectedKernel_t kernel, sc16CorrectedKernel_t reference) {
+        const int count = 1027;
+        static int16_t in[count * 2];
+        static dsp::complex_t ref[count];
+        static dsp::complex_t out[count];
+        for (int i = 0; i < count * 2; i++) {
+            in[i] = (int16_t)(((i * 7919) ^ (i << 9)) & 0x7FF) - 1024;
+        }
+        // The extremes sit in a single vector mid-block so a wrong peak reduction shows
+        in[0] = -1; in[1] = 1; in[1030] = -2048; in[1031] = 2047;
+        IqCorrection corr;
+        corr.dcI = 0.01f; corr.dcQ = -0.02f; corr.gain = 1.05f; corr.phase = -0.03f;
+        IqStats refStats, outStats;
+        reference(in, ref, count, corr, refStats);
+        kernel(in, out, count, corr, outStats);
+        if (refStats.sumI != outStats.sumI || refStats.sumQ != outStats.sumQ || refStats.sumII != outStats.sumII ||
+            refStats.sumQQ != outStats.sumQQ || refStats.sumIQ != outStats.sumIQ || refStats.peak != outStats.peak ||
+            refStats.count != outStats.count) {
+            return false;
+        }
+        for (int i = 0; i < count; i++) {
+            if (fabsf(ref[i].i - out[i].i) > 1e-6f || fabsf(ref[i].q - out[i].q) > 1e-6f) { return false; }
+        }
+        return true;
+    }
+
+    template <class T, class K>
+    static Kernel<K> resolve(Kernel<K>* candidates, int n, K reference, const char* format) {
+        for (int i = 0; i < n; i++) {
+            if (matchesReference<T>(candidates[i].kernel, reference)) {
+                return candidates[i];
+            }
+            spdlog::warn("{0} conversion kernel '{1}' does not match the reference, skipping", format, candidates[i].name);
+        }
+        return { reference, "scalar" };
+    }
+
+    int sc16q11Kernels(Kernel<sc16Kernel_t>* out) {
+        int n = 0;
+#ifdef CONVERT_X86
+        if (cpuHasAVX512()) { out[n++] = { sc16q11ToComplexAVX512, "avx512" }; }
+        if (cpuHasAVX2()) { out[n++] = { sc16q11ToComplexAVX2, "avx2" }; }
+        if (cpuHasSSE2()) { out[n++] = { sc16q11ToComplexSSE2, "sse2" }; }
+#endif
+#ifdef CONVERT_NEON
+        out[n++] = { sc16q11ToComplexNEON, "neon" };
+#endif
+        return n;
+    }
+
+    static Kernel<sc16Kernel_t> resolveSc16() {
+        Kernel<sc16Kernel_t> candidates[maxKernels];
+        int n = sc16q11Kernels(candidates);
+        return resolve<int16_t>(candidates, n, sc16q11ToComplexScalar, "SC16");
+    }
+
+    int sc8q7Kernels(Kernel<sc8Kernel_t>* out) {
+        int n = 0;
+#ifdef CONVERT_X86
+        if (cpuHasAVX512()) { out[n++] = { sc8q7ToComplexAVX512, "avx512" }; }
+        if (cpuHasAVX2()) { out[n++] = { sc8q7ToComplexAVX2, "avx2" }; }
+        if (cpuHasSSE2()) { out[n++] = { sc8q7ToComplexSSE2, "sse2" }; }
+#endif
+#ifdef CONVERT_NEON
+        out[n++] = { sc8q7ToComplexNEON, "neon" };
+#endif
+        return n;
+    }
+
+    static Kernel<sc8Kernel_t> resolveSc8() {
+        Kernel<sc8Kernel_t> candidates[maxKernels];
+        int n = sc8q7Kernels(candidates);
+        return resolve<int8_t>(candidates, n, sc8q7ToComplexScalar, "SC8");
+    }
+
+    int sc16q11X2Kernels(Kernel<sc16x2Kernel_t>* out) {
+        int n = 0;
+#ifdef CONVERT_X86
+        if (cpuHasAVX2()) { out[n++] = { sc16q11DeinterleaveX2AVX2, "avx2" }; }
+        if (cpuHasSSE2()) { out[n++] = { sc16q11DeinterleaveX2SSE2, "sse2" }; }
+#endif
+#ifdef CONVERT_NEON
+        out[n++] = { sc16q11DeinterleaveX2NEON, "neon" };
+#endif
+        return n;
+    }
+
+    static Kernel<sc16x2Kernel_t> resolveSc16X2() {
+        Kernel<sc16x2Kernel_t> candidates[maxKernels];
+        int n = sc16q11X2Kernels(candidates);
+        return resolve<int16_t>(candidates, n, sc16q11DeinterleaveX2Scalar, "SC16 X2");
+    }
+
+    int sc16q11CorrectedKernels(Kernel<sc16CorrectedKernel_t>* out) {
+        int n = 0;
+#ifdef CONVERT_X86
+        if (cpuHasAVX2()) { out[n++] = { sc16q11ToComplexCorrectedAVX2, "avx2" }; }
+        if (cpuHasSSE2()) { out[n++] = { sc16q11ToComplexCorrectedSSE2, "sse2" }; }
+#endif
+#ifdef CONVERT_NEON
+        out[n++] = { sc16q11ToComplexCorrectedNEON, "neon" };
+#endif
+        return n;
+    }
+
+    static Kernel<sc16CorrectedKernel_t> resolveSc16Corrected() {
+        Kernel<sc16CorrectedKernel_t> candidates[maxKernels];
+        int n = sc16q11CorrectedKernels(candidates);
+        for (int i = 0; i < n; i++) {
+            if (matchesReference(candidates[i].kernel, sc16q11ToComplexCorrectedScalar)) { return candidates[i]; }
+            spdlog::warn("SC16 corrected conversion kernel '{0}' does not match the reference, skipping", candidates[i].name);
+        }
+        return { sc16q11ToComplexCorrectedScalar, "scalar" };
+    }
+
+    int firInt16x2Kernels(Kernel<firInt16x2Kernel_t>* out) {
+        int n = 0;
+#ifdef CONVERT_X86
+        if (cpuHasAVX2()) { out[n++] = { firInt16x2AVX2, "avx2" }; }
+        if (cpuHasSSE2()) { out[n++] = { firInt16x2SSE2, "sse2" }; }
+#endif
+#ifdef CONVERT_NEON
+        out[n++] = { firInt16x2NEON, "neon" };
+#endif
+        return n;
+    }
+
+    static Kernel<firInt16x2Kernel_t> resolveFir() {
+        Kernel<firInt16x2Kernel_t> candidates[maxKernels];
+        int n = firInt16x2Kernels(candidates);
+        for (int i = 0; i < n; i++) {
+            if (matchesReference(candidates[i].kernel, firInt16x2Scalar)) { return candidates[i]; }
+            spdlog::warn("FIR kernel '{0}' does not match the reference, skipping", candidates[i].name);
+        }
+        return { firInt16x2Scalar, "scalar" };
+    }
+
+    static const Kernel<sc16Kernel_t>& sc16Dispatch() {
+        static const Kernel<sc16Kernel_t> dispatch = resolveSc16();
+        return dispatch;
+    }
+
+    static const Kernel<sc8Kernel_t>& sc8Dispatch() {
+        static const Kernel<sc8Kernel_t> dispatch = resolveSc8();
+        return dispatch;
+    }
+
+    static const Kernel<sc16x2Kernel_t>& sc16X2Dispatch() {
+        static const Kernel<sc16x2Kernel_t> dispatch = resolveSc16X2();
+        return dispatch;
+    }
+
+    static const Kernel<sc16CorrectedKernel_t>& sc16CorrectedDispatch() {
+        static const Kernel<sc16CorrectedKernel_t> dispatch = resolveSc16Corrected();
+        return dispatch;
+    }
+
+    static const Kernel<firInt16x2Kernel_t>& firDispatch() {
+        static const Kernel<firInt16x2Kernel_t> dispatch = resolveFir();
+        return dispatch;
+    }
+
+    void sc16q11ToComplex(const int16_t* in, dsp::complex_t* out, int count) {
+        sc16Dispatch().kernel(in, out, count);
+    }
+
+    const char* sc16q11KernelName() {
+        return sc16Dispatch().name;
+    }
+
+    void sc8q7ToComplex(const int8_t* in, dsp::complex_t* out, int count) {
+        sc8Dispatch().kernel(in, out, count);
+    }
+
+    const char* sc8q7KernelName() {
+        return sc8Dispatch().name;
+    }
+
+    void sc16q11DeinterleaveX2(const int16_t* in, dsp::complex_t* out0, dsp::complex_t* out1, int count) {
+        sc16X2Dispatch().kernel(in, out0, out1, count);
+    }
+
+    const char* sc16q11X2KernelName() {
+        return sc16X2Dispatch().name;
+    }
+
+    void sc16q11ToComplexCorrected(const int16_t* in, dsp::complex_t* out, int count, const IqCorrection& corr, IqStats& stats) {
+        sc16CorrectedDispatch().kernel(in, out, count, corr, stats);
+    }
+
+    const char* sc16q11CorrectedKernelName() {
+        return sc16CorrectedDispatch().name;
+    }
+
+    firInt16x2Kernel_t firInt16x2Kernel() {
+        return firDispatch().kernel;
+    }
+
+    const char* firInt16x2KernelName() {
+        return firDispatch().name;
+    }
+}
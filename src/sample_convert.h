@@ -0,0 +1,97 @@
+#pragma once
+#include <stdint.h>
+#include <dsp/types.h>
+
+// SC16_Q11 / SC8_Q7 -> dsp::complex_t conversion kernels.
+//
+// The bladeRF delivers interleaved 16 bit samples with 12 bits of magnitude
+// (Q11, full scale = 2048). The original worker loop wrote the first word of
+// each pair into .q and the second into .i and scaled by 1/4096; every kernel
+// here reproduces that bit for bit, the scalar version being the reference.
+// 8 bit samples (Q7, full scale = 128) follow the same ordering and are scaled
+// by 1/256 so both formats reach the DSP chain at the same level.
+namespace convert {
+    // DC offset and IQ imbalance correction, applied while converting:
+    //   i' = i - dcI
+    //   q' = gain * (q - dcQ) + phase * i'
+    struct IqCorrection {
+        float dcI   = 0.0f;
+        float dcQ   = 0.0f;
+        float gain  = 1.0f;
+        float phase = 0.0f;
+    };
+
+    // Exact first and second moments of the uncorrected samples, in Q11 units
+    // (SC8 samples count as Q7 << 4), to estimate the correction from
+    struct IqStats {
+        int64_t sumI    = 0;
+        int64_t sumQ    = 0;
+        int64_t sumII   = 0;
+        int64_t sumQQ   = 0;
+        int64_t sumIQ   = 0;
+        int32_t peak    = 0;    // Largest magnitude of either component
+        uint64_t count  = 0;
+
+        void add(const IqStats& b) {
+            sumI += b.sumI; sumQ += b.sumQ; sumII += b.sumII; sumQQ += b.sumQQ; sumIQ += b.sumIQ; count += b.count;
+            if (b.peak > peak) { peak = b.peak; }
+        }
+    };
+
+    typedef void (*sc16Kernel_t)(const int16_t* in, dsp::complex_t* out, int count);
+    typedef void (*sc8Kernel_t)(const int8_t* in, dsp::complex_t* out, int count);
+    typedef void (*sc16x2Kernel_t)(const int16_t* in, dsp::complex_t* out0, dsp::complex_t* out1, int count);
+    typedef void (*sc16CorrectedKernel_t)(const int16_t* in, dsp::complex_t* out, int count, const IqCorrection& corr, IqStats& stats);
+    typedef void (*firInt16x2Kernel_t)(const int16_t* taps, const int16_t* x0, const int16_t* x1, int count, int32_t* acc0, int32_t* acc1);
+
+    template <class K>
+    struct Kernel {
+        K kernel;
+        const char* name;
+    };
+
+    // Reference implementation, identical to the original worker loop
+    void sc16q11ToComplexScalar(const int16_t* in, dsp::complex_t* out, int count);
+
+    // Dispatched to the fastest kernel supported by the running CPU
+    void sc16q11ToComplex(const int16_t* in, dsp::complex_t* out, int count);
+
+    // Name of the kernel selected by the dispatcher ("scalar", "sse2", "avx2", "avx512", "neon")
+    const char* sc16q11KernelName();
+
+    void sc8q7ToComplexScalar(const int8_t* in, dsp::complex_t* out, int count);
+    void sc8q7ToComplex(const int8_t* in, dsp::complex_t* out, int count);
+    const char* sc8q7KernelName();
+
+    // BLADERF_RX_X2 streams alternate one sample of each channel. count is per channel,
+    // so the input holds 2 * count interleaved samples.
+    void sc16q11DeinterleaveX2Scalar(const int16_t* in, dsp::complex_t* out0, dsp::complex_t* out1, int count);
+    void sc16q11DeinterleaveX2(const int16_t* in, dsp::complex_t* out0, dsp::complex_t* out1, int count);
+    const char* sc16q11X2KernelName();
+    void sc8q7DeinterleaveX2(const int8_t* in, dsp::complex_t* out0, dsp::complex_t* out1, int count);
+
+    // Conversion with IqCorrection applied, gathering IqStats of the input in the same pass.
+    // stats is added to, not reset.
+    void sc16q11ToComplexCorrectedScalar(const int16_t* in, dsp::complex_t* out, int count, const IqCorrection& corr, IqStats& stats);
+    void sc16q11ToComplexCorrected(const int16_t* in, dsp::complex_t* out, int count, const IqCorrection& corr, IqStats& stats);
+    const char* sc16q11CorrectedKernelName();
+    void sc8q7ToComplexCorrected(const int8_t* in, dsp::complex_t* out, int count, const IqCorrection& corr, IqStats& stats);
+    // For samples that are already complex_t (resampled output), at full scale 1.0
+    void correctComplex(dsp::complex_t* data, int count, const IqCorrection& corr);
+
+    // Two int16 dot products against the same taps (the two rails of a complex FIR),
+    // accumulated in 32 bits. Callers keep the sum of |taps| * full scale below 2^31.
+    void firInt16x2Scalar(const int16_t* taps, const int16_t* x0, const int16_t* x1, int count, int32_t* acc0, int32_t* acc1);
+    // The dispatched kernel itself, for loops that call it once per output sample
+    firInt16x2Kernel_t firInt16x2Kernel();
+    const char* firInt16x2KernelName();
+
+    // Every SIMD kernel compiled in and supported by the running CPU, preferred first, whether the
+    // dispatcher picked it or not. They write at most maxKernels entries and return the count.
+    const int maxKernels = 4;
+    int sc16q11Kernels(Kernel<sc16Kernel_t>* out);
+    int sc8q7Kernels(Kernel<sc8Kernel_t>* out);
+    int sc16q11X2Kernels(Kernel<sc16x2Kernel_t>* out);
+    int sc16q11CorrectedKernels(Kernel<sc16CorrectedKernel_t>* out);
+    int firInt16x2Kernels(Kernel<firInt16x2Kernel_t>* out);
+}
@@ -0,0 +1,85 @@
+#include <sample_pool.h>
+#include <aligned_alloc.h>
+#include <spdlog/spdlog.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+#define POOL_PAGE_SIZE      4096
+#define POOL_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+SampleBufferPool::~SampleBufferPool() {
+    clear();
+}
+
+void* SampleBufferPool::get(Slot slot, size_t bytes) {
+    Block& block = blocks[slot];
+    if (block.ptr != NULL && block.bytes >= bytes && block.huge == hugePages) { return block.ptr; }
+    release(block);
+    block = allocate(bytes, hugePages);
+    return block.ptr;
+}
+
+void SampleBufferPool::clear() {
+    for (int i = 0; i < SLOT_COUNT; i++) { release(blocks[i]); }
+}
+
+size_t SampleBufferPool::bytesHeld() {
+    size_t total = 0;
+    for (int i = 0; i < SLOT_COUNT; i++) { total += blocks[i].bytes; }
+    return total;
+}
+
+int SampleBufferPool::hugeSlots() {
+    int n = 0;
+    for (int i = 0; i < SLOT_COUNT; i++) { n += blocks[i].hugeBacked; }
+    return n;
+}
+
+SampleBufferPool::Block SampleBufferPool::allocate(size_t bytes, bool huge) {
+    Block block;
+    block.huge = huge;
+    if (huge) {
+        size_t rounded = (bytes + POOL_HUGE_PAGE_SIZE - 1) / POOL_HUGE_PAGE_SIZE * POOL_HUGE_PAGE_SIZE;
+#if defined(__linux__) && defined(MAP_HUGETLB)
+        // Reserved huge pages first, they are guaranteed to be huge
+        void* ptr = mmap(NULL, rounded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (ptr != MAP_FAILED) {
+            block.ptr = ptr;
+            block.bytes = rounded;
+            block.mapped = true;
+            block.hugeBacked = true;
+            return block;
+        }
+#endif
+        // Otherwise ask for transparent huge pages on a huge page aligned block
+        block.ptr = alignedAlloc(rounded, POOL_HUGE_PAGE_SIZE);
+        if (block.ptr != NULL) {
+            block.bytes = rounded;
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+            madvise(block.ptr, rounded, MADV_HUGEPAGE);
+#endif
+            spdlog::info("No reserved huge pages for a {0} byte sample buffer, using transparent huge pages where available", bytes);
+            return block;
+        }
+    }
+
+    size_t rounded = (bytes + POOL_PAGE_SIZE - 1) / POOL_PAGE_SIZE * POOL_PAGE_SIZE;
+    block.ptr = alignedAlloc(rounded, POOL_PAGE_SIZE);
+    block.bytes = (block.ptr != NULL) ? rounded : 0;
+    return block;
+}
+
+void SampleBufferPool::release(Block& block) {
+    if (block.ptr != NULL) {
+#ifndef _WIN32
+        if (block.mapped) {
+            munmap(block.ptr, block.bytes);
+            block = Block();
+            return;
+        }
+#endif
+        alignedFree(block.ptr);
+    }
+    block = Block();
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <stddef.h>
+
+// Sample buffers that outlive a single run. start() asks for what it needs and gets
+// the previous allocation back when it is large enough, so stop/start cycles don't
+// go through the heap and nothing is allocated on the RX thread. Buffers are page
+// aligned, and backed by huge pages when asked for and the OS has them, which takes
+// TLB misses out of the conversion of multi-MB blocks.
+class SampleBufferPool {
+public:
+    enum Slot {
+        SLOT_RX_BLOCK,      // One raw block as read from libbladeRF
+        SLOT_RAW_RING,      // Arena of the decoupled pipeline's ring
+        SLOT_BURST_RING,    // Pre-trigger window of the burst capture
+        SLOT_COUNT
+    };
+
+    ~SampleBufferPool();
+
+    // Contents are not preserved when the slot has to grow
+    void* get(Slot slot, size_t bytes);
+
+    // Takes effect from the next get(), buffers of the other kind are reallocated then
+    void setHugePages(bool enabled) { hugePages = enabled; }
+    void clear();
+
+    size_t bytesHeld();
+    // Slots currently backed by explicit huge pages
+    int hugeSlots();
+
+private:
+    struct Block {
+        void* ptr = NULL;
+        size_t bytes = 0;
+        bool huge = false;      // Requested with huge pages, whether or not they were granted
+        bool mapped = false;    // Came from mmap instead of alignedAlloc
+        bool hugeBacked = false;
+    };
+
+    static Block allocate(size_t bytes, bool huge);
+    static void release(Block& block);
+
+    Block blocks[SLOT_COUNT];
+    bool hugePages = false;
+};
@@ -0,0 +1,142 @@
+#pragma once
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <stdint.h>
+#include <aligned_alloc.h>
+
+// Lock-free single producer / single consumer ring of fixed size sample blocks.
+// All memory is allocated by init(), the data path never allocates or locks.
+// The mutex and condition variable are only touched when the consumer has
+// actually gone to sleep on an empty ring.
+template <class T>
+class SPSCBlockRing {
+public:
+    ~SPSCBlockRing() {
+        free();
+    }
+
+    // Every slot starts on an alignment boundary, T must be a plain data type
+    void init(int depth, int blockSize, size_t alignment = 64) {
+        free();
+        init(depth, blockSize, (T*)alignedAlloc(arenaBytes(depth, blockSize, alignment), alignment), alignment);
+        ownsArena = true;
+    }
+
+    // Same on memory owned by the caller, at least arenaBytes() long and aligned to alignment
+    void init(int depth, int blockSize, T* memory, size_t alignment) {
+        free();
+        _depth = depth;
+        _blockSize = blockSize;
+        stride = arenaBytes(1, blockSize, alignment) / sizeof(T);
+        arena = memory;
+        ownsArena = false;
+        counts = new int[depth];
+        tags = new uint64_t[depth];
+        reset();
+    }
+
+    static size_t arenaBytes(int depth, int blockSize, size_t alignment = 64) {
+        return ((blockSize * sizeof(T)) + alignment - 1) / alignment * alignment * depth;
+    }
+
+    void free() {
+        if (arena != NULL && ownsArena) { alignedFree(arena); }
+        if (counts != NULL) { delete[] counts; }
+        if (tags != NULL) { delete[] tags; }
+        arena = NULL;
+        counts = NULL;
+        tags = NULL;
+        _depth = 0;
+        _blockSize = 0;
+    }
+
+    void reset() {
+        writeIdx = 0;
+        readIdx = 0;
+        highWater = 0;
+        dropped = 0;
+        stopped = false;
+    }
+
+    // Producer side. Returns NULL when the ring is full.
+    T* writeSlot() {
+        uint64_t w = writeIdx.load(std::memory_order_relaxed);
+        if (w - readIdx.load(std::memory_order_acquire) >= (uint64_t)_depth) { return NULL; }
+        return &arena[(size_t)(w % _depth) * stride];
+    }
+
+    // tag travels with the block, for the producer to tell the consumer where it came from
+    void commitWrite(int count, uint64_t tag = 0) {
+        uint64_t w = writeIdx.load(std::memory_order_relaxed);
+        counts[w % _depth] = count;
+        tags[w % _depth] = tag;
+        writeIdx.store(w + 1, std::memory_order_seq_cst);
+
+        uint64_t fill = (w + 1) - readIdx.load(std::memory_order_relaxed);
+        if (fill > highWater.load(std::memory_order_relaxed)) { highWater.store(fill, std::memory_order_relaxed); }
+
+        if (waiting.load(std::memory_order_seq_cst)) {
+            std::lock_guard<std::mutex> lck(waitMtx);
+            waitCnd.notify_one();
+        }
+    }
+
+    // Count a block the producer had to throw away because the ring was full
+    void drop() {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Consumer side. Blocks until a block is available, returns NULL once stopped.
+    T* readSlot(int& count) {
+        uint64_t r = readIdx.load(std::memory_order_relaxed);
+        if (writeIdx.load(std::memory_order_acquire) == r) {
+            std::unique_lock<std::mutex> lck(waitMtx);
+            waiting.store(true, std::memory_order_seq_cst);
+            waitCnd.wait(lck, [&]{ return writeIdx.load(std::memory_order_seq_cst) != r || stopped; });
+            waiting.store(false, std::memory_order_relaxed);
+            if (stopped) { return NULL; }
+        }
+        count = counts[r % _depth];
+        return &arena[(size_t)(r % _depth) * stride];
+    }
+
+    T* readSlot(int& count, uint64_t& tag) {
+        T* slot = readSlot(count);
+        if (slot != NULL) { tag = tags[readIdx.load(std::memory_order_relaxed) % _depth]; }
+        return slot;
+    }
+
+    void commitRead() {
+        readIdx.store(readIdx.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    void stop() {
+        std::lock_guard<std::mutex> lck(waitMtx);
+        stopped = true;
+        waitCnd.notify_all();
+    }
+
+    int depth() { return _depth; }
+    int blockSize() { return _blockSize; }
+    int fill() { return (int)(writeIdx.load(std::memory_order_relaxed) - readIdx.load(std::memory_order_relaxed)); }
+
+    std::atomic<uint64_t> highWater = 0;
+    std::atomic<uint64_t> dropped = 0;
+
+private:
+    T* arena = NULL;
+    bool ownsArena = false;
+    int* counts = NULL;
+    uint64_t* tags = NULL;
+    int _depth = 0;
+    int _blockSize = 0;
+    size_t stride = 0;
+
+    std::atomic<uint64_t> writeIdx = 0;
+    std::atomic<uint64_t> readIdx = 0;
+    std::atomic<bool> waiting = false;
+    bool stopped = false;
+    std::mutex waitMtx;
+    std::condition_variable waitCnd;
+};
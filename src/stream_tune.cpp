@@ -0,0 +1,96 @@
+#include <stream_tune.h>
+#include <algorithm>
+#include <math.h>
+
+// buffer_size must be a multiple of 1024 samples, and has to fit in a dsp::stream buffer
+#define MIN_BUFFER_SIZE     1024
+#define MAX_BUFFER_SIZE     (512 * 1024)
+#define MIN_BUFFERS         4
+#define MAX_BUFFERS         256
+#define MAX_TRANSFERS       32
+
+// Total host side buffering that should be available to absorb scheduling jitter
+#define JITTER_BUDGET_MS    100.0
+
+// Shared by every board the process streams from. A rack of boards at high rates
+// would otherwise pin hundreds of MB and saturate the host controllers' transfer slots.
+#define SHARED_BUFFER_SAMPLES   (32 * 1024 * 1024)
+#define SHARED_TRANSFERS        128
+
+// A run must have been long enough for its counters to mean anything
+#define MIN_BLOCKS_TO_ADAPT 256
+
+namespace streamtune {
+    Params sanitize(const Params& params) {
+        Params p = params;
+        p.bufferSize = std::clamp<unsigned int>((p.bufferSize / 1024) * 1024, MIN_BUFFER_SIZE, MAX_BUFFER_SIZE);
+        p.numBuffers = std::clamp<unsigned int>(p.numBuffers, MIN_BUFFERS, MAX_BUFFERS);
+        // libbladeRF needs at least one buffer that is not owned by a transfer
+        p.numTransfers = std::clamp<unsigned int>(p.numTransfers, 1, std::min<unsigned int>(MAX_TRANSFERS, p.numBuffers - 1));
+        return p;
+    }
+
+    Params initial(double sampleRate, double latencyMs) {
+        Params p;
+
+        // One buffer is the smallest unit delivered to the host, so it bounds the latency
+        p.bufferSize = (unsigned int)((sampleRate * latencyMs / 1000.0) / 1024.0) * 1024;
+        p.bufferSize = std::clamp<unsigned int>(p.bufferSize, MIN_BUFFER_SIZE, MAX_BUFFER_SIZE);
+
+        double bufferMs = 1000.0 * (double)p.bufferSize / sampleRate;
+        p.numBuffers = (unsigned int)ceil(JITTER_BUDGET_MS / bufferMs);
+
+        // Keep half the buffers in flight on the bus, the other half for the host
+        p.numTransfers = p.numBuffers / 2;
+
+        return sanitize(p);
+    }
+
+    Params adapt(const Params& prev, double sampleRate, double latencyMs, const RunStats& stats) {
+        Params p = sanitize(prev);
+        if (stats.blocks < MIN_BLOCKS_TO_ADAPT) { return p; }
+
+        if (stats.overruns > 0) {
+            // Lost samples: add buffering first, only grow the buffers (and the latency) as a last resort
+            if (p.numBuffers < MAX_BUFFERS) {
+                p.numBuffers *= 2;
+                p.numTransfers = std::max<unsigned int>(p.numTransfers, p.numBuffers / 2);
+            }
+            else {
+                p.bufferSize *= 2;
+            }
+        }
+        else if (stats.timeouts > 0) {
+            // timeoutMs() leaves seconds for a buffer to fill, so a timeout means the board stopped
+            // delivering (unplugged, reset), not that the buffers are too large: nothing to learn
+            return p;
+        }
+        else {
+            // Clean run, drift back toward the latency target if a previous run had to grow the buffers
+            Params target = initial(sampleRate, latencyMs);
+            if (p.bufferSize > target.bufferSize) {
+                p.bufferSize /= 2;
+            }
+        }
+
+        return sanitize(p);
+    }
+
+    Params share(const Params& params, int streams) {
+        Params p = sanitize(params);
+        if (streams <= 1) { return p; }
+
+        // Give up buffers before buffer size, the latter sets the latency
+        unsigned int maxSamples = SHARED_BUFFER_SAMPLES / streams;
+        if ((uint64_t)p.numBuffers * p.bufferSize > maxSamples) {
+            p.numBuffers = std::max<unsigned int>(maxSamples / p.bufferSize, MIN_BUFFERS);
+        }
+        p.numTransfers = std::min<unsigned int>(p.numTransfers, std::max<unsigned int>(SHARED_TRANSFERS / streams, 1));
+        return sanitize(p);
+    }
+
+    unsigned int timeoutMs(const Params& params, double sampleRate) {
+        double bufferMs = 1000.0 * (double)params.bufferSize / sampleRate;
+        return std::max<unsigned int>(3500, (unsigned int)(bufferMs * 4.0));
+    }
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <stdint.h>
+
+// Sizing of the libbladeRF streaming buffers (num_buffers / buffer_size / num_transfers).
+// initial() derives a starting point from the sample rate and a latency budget,
+// adapt() refines a previous choice from what was measured during the last run.
+namespace streamtune {
+    struct Params {
+        unsigned int numBuffers;
+        unsigned int bufferSize;
+        unsigned int numTransfers;
+    };
+
+    struct RunStats {
+        uint64_t blocks;
+        uint64_t overruns;
+        uint64_t timeouts;
+    };
+
+    Params initial(double sampleRate, double latencyMs);
+    Params adapt(const Params& prev, double sampleRate, double latencyMs, const RunStats& stats);
+
+    // Force a set of parameters into what libbladeRF accepts
+    Params sanitize(const Params& params);
+
+    // Scale params down so that streams boards streaming at once stay within one
+    // process wide budget of buffer memory and in flight USB transfers
+    Params share(const Params& params, int streams);
+
+    // Sync/async timeout long enough to cover several buffers at this rate
+    unsigned int timeoutMs(const Params& params, double sampleRate);
+}
@@ -0,0 +1,112 @@
+#include <sweep.h>
+#include <algorithm>
+#include <sstream>
+#include <math.h>
+
+namespace sweep {
+    std::vector<double> plan(double startHz, double stopHz, double stepHz, const std::string& list, int maxHops) {
+        std::vector<double> hops;
+
+        if (!list.empty()) {
+            std::string norm = list;
+            std::replace(norm.begin(), norm.end(), ',', ' ');
+            std::stringstream ss(norm);
+            double mhz;
+            while (ss >> mhz && (int)hops.size() < maxHops) {
+                hops.push_back(mhz * 1e6);
+            }
+            return hops;
+        }
+
+        if (stepHz <= 0 || stopHz < startHz) { return hops; }
+        // The first and last hop are centered so their usable band covers start and stop
+        for (double f = startHz + (stepHz / 2.0); f - (stepHz / 2.0) < stopHz && (int)hops.size() < maxHops; f += stepHz) {
+            hops.push_back(f);
+        }
+        return hops;
+    }
+
+    void fft(std::complex<float>* data, int n) {
+        // Bit reversal permutation
+        for (int i = 1, j = 0; i < n; i++) {
+            int bit = n >> 1;
+            for (; j & bit; bit >>= 1) { j ^= bit; }
+            j ^= bit;
+            if (i < j) { std::swap(data[i], data[j]); }
+        }
+
+        for (int len = 2; len <= n; len <<= 1) {
+            double ang = -2.0 * M_PI / len;
+            std::complex<float> wl((float)cos(ang), (float)sin(ang));
+            for (int i = 0; i < n; i += len) {
+                std::complex<float> w(1.0f, 0.0f);
+                for (int k = 0; k < len / 2; k++) {
+                    std::complex<float> u = data[i + k];
+                    std::complex<float> v = data[i + k + (len / 2)] * w;
+                    data[i + k] = u + v;
+                    data[i + k + (len / 2)] = u - v;
+                    w *= wl;
+                }
+            }
+        }
+    }
+
+    void Stitcher::init(const std::vector<double>& hops, double sampleRate, double usableHz, int fftSize) {
+        this->hops = hops;
+        this->sampleRate = sampleRate;
+        this->fftSize = fftSize;
+        usableBins = std::clamp<int>(round(fftSize * std::min<double>(usableHz, sampleRate) / sampleRate), 1, fftSize);
+
+        // Blackman-Harris, low enough sidelobes for the hop edges not to leak into each other
+        window.resize(fftSize);
+        for (int i = 0; i < fftSize; i++) {
+            double x = 2.0 * M_PI * (double)i / (double)(fftSize - 1);
+            window[i] = 0.35875 - 0.48829 * cos(x) + 0.14128 * cos(2 * x) - 0.01168 * cos(3 * x);
+        }
+        frame.resize(fftSize);
+        power.assign(fftSize, 0.0f);
+        spectrum.assign(hops.size() * usableBins, -200.0f);
+        discardHop();
+    }
+
+    void Stitcher::feed(int hop, const dsp::complex_t* samples, int count) {
+        if (hop != currentHop) {
+            discardHop();
+            currentHop = hop;
+        }
+        for (int i = 0; i < count; i++) {
+            frame[framePos] = std::complex<float>(samples[i].i * window[framePos], samples[i].q * window[framePos]);
+            if (++framePos < fftSize) { continue; }
+            fft(frame.data(), fftSize);
+            for (int b = 0; b < fftSize; b++) {
+                power[b] += std::norm(frame[b]);
+            }
+            frames++;
+            framePos = 0;
+        }
+    }
+
+    bool Stitcher::finishHop(int hop) {
+        if (hop != currentHop || frames == 0) {
+            discardHop();
+            return false;
+        }
+
+        // FFT output is DC first, the kept bins are centered on DC
+        float scale = 1.0f / ((float)frames * (float)fftSize * (float)fftSize);
+        float* out = &spectrum[hop * usableBins];
+        for (int i = 0; i < usableBins; i++) {
+            int bin = (i - (usableBins / 2) + fftSize) % fftSize;
+            out[i] = 10.0f * log10f(std::max<float>(power[bin] * scale, 1e-20f));
+        }
+        discardHop();
+        return true;
+    }
+
+    void Stitcher::discardHop() {
+        std::fill(power.begin(), power.end(), 0.0f);
+        framePos = 0;
+        frames = 0;
+        currentHop = -1;
+    }
+}
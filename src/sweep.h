@@ -0,0 +1,57 @@
+#pragma once
+#include <dsp/types.h>
+#include <stdint.h>
+#include <complex>
+#include <string>
+#include <vector>
+
+// Frequency hopping sweep: hop planning and stitching of per-hop power spectra
+// into one wideband spectrum. Hops are laid out on the RX timestamp axis, hop k
+// occupying [k * dwell, (k + 1) * dwell) samples after the sweep origin, so
+// every received sample can be attributed to a hop without asking the host
+// when the retune actually happened.
+namespace sweep {
+    // Center frequencies to visit. A non empty list (MHz, comma or space separated)
+    // takes precedence over the start/stop/step range. At most maxHops are returned.
+    std::vector<double> plan(double startHz, double stopHz, double stepHz, const std::string& list, int maxHops);
+
+    // In place radix-2 FFT, n must be a power of two
+    void fft(std::complex<float>* data, int n);
+
+    class Stitcher {
+    public:
+        // usableHz is the width kept around the center of each hop (normally the hop step)
+        void init(const std::vector<double>& hops, double sampleRate, double usableHz, int fftSize);
+
+        // Accumulate samples of a hop, after its settling time
+        void feed(int hop, const dsp::complex_t* samples, int count);
+
+        // Average what was accumulated for the hop and place it in the spectrum.
+        // Returns false when not even one FFT frame was collected.
+        bool finishHop(int hop);
+
+        // Drop a partially accumulated hop (e.g. after an overrun)
+        void discardHop();
+
+        int hopCount() { return hops.size(); }
+        int binsPerHop() { return usableBins; }
+        double binHz() { return sampleRate / fftSize; }
+        double hopFrequency(int hop) { return hops[hop]; }
+
+        // hopCount() * binsPerHop() values in dB, hop after hop
+        std::vector<float> spectrum;
+
+    private:
+        std::vector<double> hops;
+        double sampleRate = 0;
+        int fftSize = 0;
+        int usableBins = 0;
+
+        std::vector<float> window;
+        std::vector<std::complex<float>> frame;
+        std::vector<float> power;
+        int framePos = 0;
+        int frames = 0;
+        int currentHop = -1;
+    };
+}
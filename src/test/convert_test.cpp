@@ -0,0 +1,221 @@
+#include <sample_convert.h>
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <vector>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+// Checks every SIMD conversion kernel the running CPU supports against its scalar reference,
+// not only the one the dispatcher picked:
+//   - every length from 0 to 63, so each kernel's scalar tail is taken at every offset,
+//     plus a few longer blocks that run the vector loops many times
+//   - the extremes of the input type at the start, the end and scattered in between
+//   - inputs and outputs off their natural alignment by one sample
+//   - nothing written past count
+// SC16, SC8 and X2 must be bit exact. The corrected kernels may differ from the reference
+// in the last bit of a float, their stats must be exact, over the whole int16 range too.
+// Exits with 1 on any mismatch.
+//
+// bladerf_convert_test [--verbose]
+
+#define TEST_MAX_TAIL       63
+#define TEST_GUARD          16          // Samples checked past count for stray writes
+#define TEST_SEED           0x5D5Du
+#define TEST_FLOAT_EPSILON  1e-6f
+
+static const int longCounts[] = { 64, 65, 127, 1027, 4099 };
+
+struct TestState {
+    bool verbose = false;
+    int checks = 0;
+    int failures = 0;
+};
+
+static std::vector<int> testCounts() {
+    std::vector<int> counts;
+    for (int i = 0; i <= TEST_MAX_TAIL; i++) { counts.push_back(i); }
+    for (int c : longCounts) { counts.push_back(c); }
+    return counts;
+}
+
+// Random words in [lo, hi] with the extremes at both ends and every 37th word
+template <class T>
+static void fillInput(std::mt19937& rng, T* in, int n, int lo, int hi) {
+    std::uniform_int_distribution<int> dist(lo, hi);
+    const int edges[] = { lo, hi, -1, 0, 1 };
+    for (int i = 0; i < n; i++) { in[i] = (T)dist(rng); }
+    for (int i = 0; i < n; i += 37) { in[i] = (T)edges[(i / 37) % 5]; }
+    for (int i = 0; i < std::min(n, 5); i++) {
+        in[i] = (T)edges[i];
+        in[n - 1 - i] = (T)edges[4 - i];
+    }
+}
+
+// Both buffers get the same junk first, so a stray write past count shows as a difference
+static void fillGuard(dsp::complex_t* a, dsp::complex_t* b, int n) {
+    memset(a, 0x5A, n * sizeof(dsp::complex_t));
+    memset(b, 0x5A, n * sizeof(dsp::complex_t));
+}
+
+static void report(TestState& st, bool ok, const char* format, const char* name, int count) {
+    st.checks++;
+    if (!ok) {
+        st.failures++;
+        printf("FAIL  %-16s %-7s count %d\n", format, name, count);
+    }
+    else if (st.verbose) {
+        printf("ok    %-16s %-7s count %d\n", format, name, count);
+    }
+}
+
+template <class T>
+static void testSingle(TestState& st, std::mt19937& rng, const char* format, const convert::Kernel<void (*)(const T*, dsp::complex_t*, int)>& k,
+                       void (*reference)(const T*, dsp::complex_t*, int)) {
+    for (int count : testCounts()) {
+        // One extra sample in front so the kernel sees pointers off their natural alignment
+        std::vector<T> in(count * 2 + 2);
+        std::vector<dsp::complex_t> ref(count + TEST_GUARD + 1);
+        std::vector<dsp::complex_t> out(count + TEST_GUARD + 1);
+        fillInput(rng, &in[2], count * 2, std::numeric_limits<T>::min(), std::numeric_limits<T>::max());
+        for (int offset = 0; offset < 2; offset++) {
+            fillGuard(ref.data(), out.data(), (int)ref.size());
+            if (offset) { memmove(&in[2], &in[1], count * 2 * sizeof(T)); }
+            const T* src = offset ? &in[1] : &in[2];
+            reference(src, &ref[offset], count);
+            k.kernel(src, &out[offset], count);
+            report(st, memcmp(ref.data(), out.data(), ref.size() * sizeof(dsp::complex_t)) == 0, format, k.name, count);
+        }
+    }
+}
+
+static void testX2(TestState& st, std::mt19937& rng, const convert::Kernel<convert::sc16x2Kernel_t>& k) {
+    for (int count : testCounts()) {
+        std::vector<int16_t> in(count * 4 + 2);
+        std::vector<dsp::complex_t> ref(2 * (count + TEST_GUARD) + 1);
+        std::vector<dsp::complex_t> out(2 * (count + TEST_GUARD) + 1);
+        fillInput(rng, &in[2], count * 4, -32768, 32767);
+        for (int offset = 0; offset < 2; offset++) {
+            fillGuard(ref.data(), out.data(), (int)ref.size());
+            if (offset) { memmove(&in[2], &in[1], count * 4 * sizeof(int16_t)); }
+            const int16_t* src = offset ? &in[1] : &in[2];
+            int second = offset + count + TEST_GUARD;
+            convert::sc16q11DeinterleaveX2Scalar(src, &ref[offset], &ref[second], count);
+            k.kernel(src, &out[offset], &out[second], count);
+            report(st, memcmp(ref.data(), out.data(), ref.size() * sizeof(dsp::complex_t)) == 0, "SC16 X2", k.name, count);
+        }
+    }
+}
+
+static bool sameStats(const convert::IqStats& a, const convert::IqStats& b) {
+    return a.sumI == b.sumI && a.sumQ == b.sumQ && a.sumII == b.sumII && a.sumQQ == b.sumQQ &&
+           a.sumIQ == b.sumIQ && a.peak == b.peak && a.count == b.count;
+}
+
+// Real boards deliver Q11, replayed files any int16: both, and Q11 blocks with a single
+// full range outlier, so fast and redone groups of the SIMD kernels meet in one block
+static void testCorrected(TestState& st, std::mt19937& rng, const convert::Kernel<convert::sc16CorrectedKernel_t>& k) {
+    convert::IqCorrection corr;
+    corr.dcI = 0.01f; corr.dcQ = -0.02f; corr.gain = 1.05f; corr.phase = -0.03f;
+    const char* formats[] = { "SC16 corr Q11", "SC16 corr full", "SC16 corr mixed" };
+    for (int range = 0; range < 3; range++) {
+        for (int count : testCounts()) {
+            std::vector<int16_t> in(count * 2 + 2);
+            std::vector<dsp::complex_t> ref(count + TEST_GUARD + 1);
+            std::vector<dsp::complex_t> out(count + TEST_GUARD + 1);
+            if (range == 1) { fillInput(rng, &in[2], count * 2, -32768, 32767); }
+            else { fillInput(rng, &in[2], count * 2, -2048, 2047); }
+            if (range == 2 && count > 0) { in[2 + count] = -32768; }
+            for (int offset = 0; offset < 2; offset++) {
+                fillGuard(ref.data(), out.data(), (int)ref.size());
+                if (offset) { memmove(&in[2], &in[1], count * 2 * sizeof(int16_t)); }
+                const int16_t* src = offset ? &in[1] : &in[2];
+                // Stats are added to, start from something other than zero
+                convert::IqStats refStats, outStats;
+                refStats.sumI = outStats.sumI = 12345;
+                refStats.peak = outStats.peak = 100;
+                refStats.count = outStats.count = 7;
+                convert::sc16q11ToComplexCorrectedScalar(src, &ref[offset], count, corr, refStats);
+                k.kernel(src, &out[offset], count, corr, outStats);
+                bool ok = sameStats(refStats, outStats);
+                for (int i = 0; i < (int)ref.size(); i++) {
+                    bool inside = i >= offset && i < offset + count;
+                    // Relative, full range samples reach 8 and more
+                    float tol = TEST_FLOAT_EPSILON * std::max<float>(1.0f, std::max<float>(fabsf(ref[i].i), fabsf(ref[i].q)));
+                    if (inside && (fabsf(ref[i].i - out[i].i) > tol || fabsf(ref[i].q - out[i].q) > tol)) { ok = false; }
+                    if (!inside && memcmp(&ref[i], &out[i], sizeof(dsp::complex_t))) { ok = false; }
+                }
+                report(st, ok, formats[range], k.name, count);
+            }
+        }
+    }
+}
+
+// Taps are kept within what callers guarantee: sum of |taps| * 2048 below 2^31
+static void testFir(TestState& st, std::mt19937& rng, const convert::Kernel<convert::firInt16x2Kernel_t>& k) {
+    for (int count : testCounts()) {
+        int bound = std::min<int>(32767, (int)(((1u << 31) - 1) / 2048 / std::max(count, 1)));
+        std::vector<int16_t> taps(count + 1);
+        std::vector<int16_t> x0(count + 1);
+        std::vector<int16_t> x1(count + 1);
+        fillInput(rng, &taps[1], count, -bound, bound);
+        fillInput(rng, &x0[1], count, -2048, 2047);
+        fillInput(rng, &x1[1], count, -2048, 2047);
+        for (int offset = 0; offset < 2; offset++) {
+            int base = 1 - offset;
+            if (offset) {
+                memmove(&taps[0], &taps[1], count * sizeof(int16_t));
+                memmove(&x0[0], &x0[1], count * sizeof(int16_t));
+                memmove(&x1[0], &x1[1], count * sizeof(int16_t));
+            }
+            int32_t ref0, ref1, out0, out1;
+            convert::firInt16x2Scalar(&taps[base], &x0[base], &x1[base], count, &ref0, &ref1);
+            k.kernel(&taps[base], &x0[base], &x1[base], count, &out0, &out1);
+            report(st, ref0 == out0 && ref1 == out1, "FIR int16 x2", k.name, count);
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    TestState st;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--verbose")) { st.verbose = true; }
+        else {
+            fprintf(stderr, "usage: %s [--verbose]\n", argv[0]);
+            return 2;
+        }
+    }
+    std::mt19937 rng(TEST_SEED);
+    int kernels = 0;
+
+    convert::Kernel<convert::sc16Kernel_t> sc16[convert::maxKernels];
+    int n = convert::sc16q11Kernels(sc16);
+    for (int i = 0; i < n; i++) { testSingle<int16_t>(st, rng, "SC16", sc16[i], convert::sc16q11ToComplexScalar); }
+    kernels += n;
+
+    convert::Kernel<convert::sc8Kernel_t> sc8[convert::maxKernels];
+    n = convert::sc8q7Kernels(sc8);
+    for (int i = 0; i < n; i++) { testSingle<int8_t>(st, rng, "SC8", sc8[i], convert::sc8q7ToComplexScalar); }
+    kernels += n;
+
+    convert::Kernel<convert::sc16x2Kernel_t> x2[convert::maxKernels];
+    n = convert::sc16q11X2Kernels(x2);
+    for (int i = 0; i < n; i++) { testX2(st, rng, x2[i]); }
+    kernels += n;
+
+    convert::Kernel<convert::sc16CorrectedKernel_t> corrected[convert::maxKernels];
+    n = convert::sc16q11CorrectedKernels(corrected);
+    for (int i = 0; i < n; i++) { testCorrected(st, rng, corrected[i]); }
+    kernels += n;
+
+    convert::Kernel<convert::firInt16x2Kernel_t> fir[convert::maxKernels];
+    n = convert::firInt16x2Kernels(fir);
+    for (int i = 0; i < n; i++) { testFir(st, rng, fir[i]); }
+    kernels += n;
+
+    printf("%d kernels, %d checks, %d failed (dispatched: sc16 %s, sc8 %s, x2 %s, corrected %s, fir %s)\n",
+           kernels, st.checks, st.failures, convert::sc16q11KernelName(), convert::sc8q7KernelName(),
+           convert::sc16q11X2KernelName(), convert::sc16q11CorrectedKernelName(), convert::firInt16x2KernelName());
+    return st.failures ? 1 : 0;
+}
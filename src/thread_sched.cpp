@@ -0,0 +1,94 @@
+#include <thread_sched.h>
+#include <spdlog/spdlog.h>
+#include <thread>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <errno.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+// Below the kernel's own threads (50) and what audio servers usually take
+#define SCHED_RT_PRIORITY   40
+#define SCHED_HIGH_NICE     -10
+
+namespace threadsched {
+    static bool setAffinity(int core, const char* what) {
+        if (core < 0) { return true; }
+        if (core >= coreCount()) {
+            spdlog::warn("{0}: core {1} does not exist, not pinning", what, core);
+            return false;
+        }
+#if defined(_WIN32)
+        if (SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << core) == 0) {
+            spdlog::warn("{0}: could not pin to core {1} ({2})", what, core, (int)GetLastError());
+            return false;
+        }
+        return true;
+#elif defined(__linux__)
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(core, &set);
+        int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (err != 0) {
+            spdlog::warn("{0}: could not pin to core {1} ({2})", what, core, strerror(err));
+            return false;
+        }
+        return true;
+#else
+        // macOS only takes affinity hints, not worth pretending
+        spdlog::warn("{0}: core pinning is not supported on this OS", what);
+        return false;
+#endif
+    }
+
+    static bool setPriority(Priority priority, const char* what) {
+        if (priority == PRIORITY_NORMAL) { return true; }
+#ifdef _WIN32
+        int level = (priority == PRIORITY_REALTIME) ? THREAD_PRIORITY_TIME_CRITICAL : THREAD_PRIORITY_HIGHEST;
+        if (!SetThreadPriority(GetCurrentThread(), level)) {
+            spdlog::warn("{0}: could not raise thread priority ({1})", what, (int)GetLastError());
+            return false;
+        }
+        return true;
+#else
+        if (priority == PRIORITY_REALTIME) {
+            struct sched_param param;
+            memset(&param, 0, sizeof(param));
+            param.sched_priority = SCHED_RT_PRIORITY;
+            int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+            if (err == 0) { return true; }
+            spdlog::warn("{0}: SCHED_FIFO refused ({1}), trying a raised nice level instead", what, strerror(err));
+        }
+#ifdef __linux__
+        // Linux applies nice per thread when given the thread id
+        if (setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), SCHED_HIGH_NICE) != 0) {
+            spdlog::warn("{0}: could not raise nice level ({1})", what, strerror(errno));
+            return false;
+        }
+        return true;
+#else
+        spdlog::warn("{0}: raising the priority of a single thread is not supported on this OS", what);
+        return false;
+#endif
+#endif
+    }
+
+    bool applyToCurrentThread(const Options& opts, const char* what) {
+        bool ok = setAffinity(opts.core, what);
+        ok &= setPriority(opts.priority, what);
+        return ok;
+    }
+
+    int coreCount() {
+        int n = std::thread::hardware_concurrency();
+        return (n > 0) ? n : 1;
+    }
+}
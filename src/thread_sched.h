@@ -0,0 +1,22 @@
+#pragma once
+
+// Scheduling for the thread that keeps USB drained. Left at the defaults it competes
+// with the GUI and DSP threads and a late wakeup turns into an overrun.
+namespace threadsched {
+    enum Priority {
+        PRIORITY_NORMAL,
+        PRIORITY_HIGH,          // Raised within the normal scheduler (nice / above normal)
+        PRIORITY_REALTIME       // SCHED_FIFO / time critical
+    };
+
+    struct Options {
+        Priority priority = PRIORITY_NORMAL;
+        int core = -1;          // -1 lets the OS place the thread
+    };
+
+    // Applies to the calling thread. What the OS refuses (e.g. SCHED_FIFO without
+    // CAP_SYS_NICE or an rtprio limit) is logged and skipped, returns false then.
+    bool applyToCurrentThread(const Options& opts, const char* what);
+
+    int coreCount();
+}